@@ -0,0 +1,205 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "TypeAlias.hpp"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace Shusaku
+{
+	// 1 回の探索の間だけ使うメモリを、まとめて確保・解放するための領域 (アリーナ)
+	// 作成時に上限 capacity バイトの領域を予約し、そこから前詰めで切り出して使う (個別の解放はしない)
+	// 領域は、使える環境ではラージページで確保する (TLB ミスを減らすため)
+	// 上限に達したら確保に失敗する (nullptr を返す) ので、呼び出し側はそこで展開を止めること
+	// アリーナの破棄・Reset で全てまとめて解放され、デストラクタは呼ばれないので、置けるのはトリビアルに破棄できる型のみ
+	class Arena final
+	{
+	public:
+
+		// スレッドごとに切り出す、まとまった領域の大きさ (バイト)
+		static constexpr autosize DefaultChunkSize = static_cast<autosize>(64) << 10;
+
+		// 各スレッドが、アリーナから切り出したチャンクの中で前詰めに確保していくためのもの
+		// スレッドごとに 1 つずつ持つことで、確保のたびにスレッド間で競合しないようにする
+		// (アリーナは探索ごとに作られるので、thread_local ではなく、各ワーカーのローカル変数として持つ)
+		class Cursor final
+		{
+		public:
+
+			inline explicit Cursor(Arena& arena) : arena(&arena) {}
+
+			// size バイト (align の倍数のアドレス) を確保する
+			// アリーナの上限に達したら、nullptr を返す
+			inline void* Allocate(autosize size, autosize align = alignof(std::max_align_t))
+			{
+				uint8* aligned = AlignUp(current, align);
+				if (aligned == nullptr || aligned + size > end)
+				{
+					// チャンクを使い切ったので、新しいチャンクを切り出す (大きな確保は、それ専用のチャンクにする)
+					const autosize ChunkSize = std::max(arena->chunkSize, size + align);
+					uint8* chunk = static_cast<uint8*>(arena->AllocateChunk(ChunkSize));
+					if (chunk == nullptr) return nullptr;
+
+					if (size + align <= arena->chunkSize)
+					{
+						current = chunk;
+						end = chunk + ChunkSize;
+					}
+					aligned = AlignUp(chunk, align);
+					if (size + align > arena->chunkSize) return aligned;
+				}
+
+				current = aligned + size;
+				return aligned;
+			}
+
+			// T を 1 つ構築して返す (上限に達したら nullptr)
+			template <typename T, typename... Args>
+			inline T* Create(Args&&... args)
+			{
+				static_assert(std::is_trivially_destructible_v<T>, "Arena cannot call destructors.");
+				void* p = Allocate(sizeof(T), alignof(T));
+				return p ? new (p) T(std::forward<Args>(args)...) : nullptr;
+			}
+
+			// T を count 個、値初期化して返す (上限に達したら nullptr)
+			template <typename T>
+			inline T* CreateArray(autosize count)
+			{
+				static_assert(std::is_trivially_destructible_v<T>, "Arena cannot call destructors.");
+				void* p = Allocate(sizeof(T) * count, alignof(T));
+				if (p == nullptr) return nullptr;
+
+				T* array = static_cast<T*>(p);
+				for (autosize i = 0; i < count; ++i)
+					new (array + i) T();
+				return array;
+			}
+
+		private:
+
+			static inline uint8* AlignUp(uint8* p, autosize align)
+			{
+				if (p == nullptr) return nullptr;
+				const uintptr_t Address = reinterpret_cast<uintptr_t>(p);
+				return p + ((align - (Address & (align - 1))) & (align - 1));
+			}
+
+			Arena* arena;
+			uint8* current = nullptr;
+			uint8* end = nullptr;
+		};
+
+		inline explicit Arena(autosize capacity, autosize chunkSize = DefaultChunkSize)
+			: chunkSize(chunkSize)
+		{
+			Reserve(capacity);
+		}
+
+		inline ~Arena() { Release(); }
+
+		Arena(const Arena&) = delete;
+		Arena& operator=(const Arena&) = delete;
+
+		inline autosize GetCapacity() const { return capacity; }
+		inline autosize GetUsedSize() const { return std::min(used.load(std::memory_order_relaxed), capacity); }
+		inline bool IsUsingLargePages() const { return usingLargePages; }
+
+		// 全ての確保をまとめて取り消す (領域自体は保持して、再利用する)
+		// 使用中の Cursor が無いときに呼ぶこと
+		inline void Reset() { used.store(0, std::memory_order_relaxed); }
+
+	private:
+
+		// アリーナから size バイトのチャンクを切り出す (上限に達したら nullptr)
+		// 複数のスレッドから同時に呼ばれるので、使用量を atomic に進める
+		inline void* AllocateChunk(autosize size)
+		{
+			const autosize Offset = used.fetch_add(size, std::memory_order_relaxed);
+			if (base == nullptr || Offset + size > capacity) return nullptr;
+			return base + Offset;
+		}
+
+		// capacity バイトの領域を予約する
+		// ラージページが使えなければ、通常のページで確保する
+		inline void Reserve(autosize requestedCapacity)
+		{
+			if (requestedCapacity == 0) return;
+
+#ifdef _WIN32
+			// ラージページは、ユーザーに「メモリ内のページのロック」権限が無いと確保できない
+			const autosize LargePageSize = GetLargePageMinimum();
+			if (LargePageSize > 0 && requestedCapacity >= LargePageSize)
+			{
+				const autosize Size = (requestedCapacity + LargePageSize - 1) / LargePageSize * LargePageSize;
+				base = static_cast<uint8*>(VirtualAlloc(nullptr, Size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE));
+				if (base != nullptr)
+				{
+					capacity = Size;
+					usingLargePages = true;
+					return;
+				}
+			}
+			base = static_cast<uint8*>(VirtualAlloc(nullptr, requestedCapacity, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+			capacity = base ? requestedCapacity : 0;
+#else
+			// 事前に確保された HugeTLB のページがあれば使い、無ければ通常のページに Transparent Huge Pages を要求する
+			// HugeTLB は、足りないまま触れると SIGBUS になるので、MAP_NORESERVE を付けずに確保時点で失敗させる
+			// 通常のページは、触れたページにだけ物理メモリが割り当てられるので、上限いっぱいに予約しても構わない
+			constexpr autosize HugePageSize = static_cast<autosize>(2) << 20;
+#ifdef MAP_HUGETLB
+			if (requestedCapacity >= HugePageSize)
+			{
+				const autosize Size = (requestedCapacity + HugePageSize - 1) / HugePageSize * HugePageSize;
+				void* p = mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+				if (p != MAP_FAILED)
+				{
+					base = static_cast<uint8*>(p);
+					capacity = Size;
+					usingLargePages = true;
+					return;
+				}
+			}
+#endif
+			void* p = mmap(nullptr, requestedCapacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+			if (p == MAP_FAILED) return;
+			base = static_cast<uint8*>(p);
+			capacity = requestedCapacity;
+#ifdef MADV_HUGEPAGE
+			if (requestedCapacity >= HugePageSize)
+				usingLargePages = madvise(base, capacity, MADV_HUGEPAGE) == 0;
+#endif
+#endif
+		}
+
+		inline void Release()
+		{
+			if (base == nullptr) return;
+#ifdef _WIN32
+			VirtualFree(base, 0, MEM_RELEASE);
+#else
+			munmap(base, capacity);
+#endif
+			base = nullptr;
+			capacity = 0;
+		}
+
+		uint8* base = nullptr;
+		autosize capacity = 0;
+		autosize chunkSize;
+		std::atomic<autosize> used = 0;
+		bool usingLargePages = false;
+	};
+}
@@ -1,10 +1,17 @@
 ﻿#pragma once
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <vector>
 #include "TypeAlias.hpp"
+#include "MacroDefine.hpp"
 #include "BoardSizeEnum.hpp"
 #include "StoneEnum.hpp"
 #include "PosStone.hpp"
+#include "Pattern3x3.hpp"
+#include "Zobrist.hpp"
+#include "Symmetry.hpp"
 
 namespace Shusaku
 {
@@ -18,6 +25,10 @@ namespace Shusaku
 		inline static Board Create9x9() { return Board(BoardSize::_9x9); }
 		inline static Board Create13x13() { return Board(BoardSize::_13x13); }
 		inline static Board Create19x19() { return Board(BoardSize::_19x19); }
+		inline static Board Create(BoardSize boardSize) { return Board(boardSize); }
+
+		// 盤面の交点数の最大値 (19x19)
+		static constexpr uint16 MaxPositionsCount = 19 * 19;
 
 		// 左上角が (1, 1), 右下角が (size, size) の座標系で石を取得する
 		inline Stone GetStone(uint8 x, uint8 y) const
@@ -28,87 +39,83 @@ namespace Shusaku
 		// 左上角が (1, 1), 右下角が (size, size) の座標系で石を置く
 		// 石を置けるなら true を、置けないなら false を返す
 		// 石を置ける時、棋譜にも追加する (黒白交互であるかは気にしない)
-		// 2手前までの盤面を保存し、同形反復になるなら着手できない. ただし、長手数のコウ・同形反復は、チェックしない
+		// 直前の着手でコウになった点には、取り返す手番の側は打てない (同形反復). ただし、長手数のコウ・同形反復は、チェックしない
+		// 打てるかどうかは、差分で更新している合法手の表 (IsLegal を参照) で判定するので、試しに置いて戻すことはしない
 		// コンピュータ同士の自動対戦を行うときは、手数の上限を設けるよう、強く推奨する
 		inline bool PutStone(uint8 x, uint8 y, Stone stone)
 		{
-			// 空き点でなかったら、着手できない
-			if (Get(x - 1, y - 1) != Stone::Empty)
-				return false;
-
-			// 試しに着手してみる! この後この着手が無効となったら、元に戻す
-			Set(x - 1, y - 1, stone);
-
-			// 周囲の座標を取得 (2-4個)
-			uset<Pos> surroundings = GetSurroundingPositions({ x, y });
+			TRACE_SCOPE_DETAIL("Board::PutStone");
 
-			// 相手の石に囲まれているか?
-			bool surrounded = CheckSurrounded({ x, y });
+			// 空き点でない・着手禁止点・コウなら、着手できない
+			if (!IsLegal(x, y, stone))
+				return false;
 
-			// 相手の石を取ることが出来るか?
-			bool canTake = false;  // 最終フラグ
-			uset<Pos> takenStones;
-			takenStones.reserve(positionsCount);
-			for (const Pos& pos : surroundings)
+			// 着手する前の盤面を保存する (2 手目以降)
+			// 今の盤面は、直前の着手の前の盤面に、直前の着手 (置いた石と、それで取った石) を反映したものなので、その点だけを書き換える
+			if (boardPre2.empty())
 			{
-				uset<Pos> takenStonesEach;
-				bool canTakeEach = CheckCanTake(stone, pos, takenStonesEach);
-				if (canTakeEach)
-				{
-					canTake = true;
-					takenStones.insert(takenStonesEach.begin(), takenStonesEach.end());
-				}
+				if (!history.empty()) boardPre2 = board;
 			}
-
-			// 着手禁止点には打てない
-			// (着手禁止点でも、相手の石を取れるなら打てる)
-			if (surrounded && !canTake)
+			else
 			{
-				// 試しに着手していたものを、元に戻す
-				Set(x - 1, y - 1, Stone::Empty);
-				return false;
+				const PosStone& LastMove = history.back();
+				boardPre2[(LastMove.pos.x - 1) + (LastMove.pos.y - 1) * size] = LastMove.stone;
+				for (const Pos& takenPos : lastTakenStones)
+					boardPre2[(takenPos.x - 1) + (takenPos.y - 1) * size] = Stone::Empty;
 			}
 
-			// 着手できる
+			// 石を置き、1 つだけの連を作る (呼吸点は、上下左右の空き点)
+			const uint16 Idx = static_cast<uint16>((x - 1) + (y - 1) * size);
+			Set(x - 1, y - 1, stone);
+			chainHeads[Idx] = Idx;
+			nextInChain[Idx] = Idx;
+			chainSizes[Idx] = 1;
+			chainLiberties[Idx] = {};
 
-			// 相手の石を取ることが出来るなら、取る
-			if (canTake)
+			// 周囲の座標を取得 (2-4個)
+			arr<Pos, 4> neighbors;
+			const uint8 NeighborCount = GetNeighbors({ x, y }, neighbors);
+
+			// 隣の連は、この点を呼吸点として失う
+			// 自分の連とは合体し、相手の連は、呼吸点が無くなったら後で取る
+			arr<uint16, 4> oppoHeads;
+			uint8 oppoCount = 0;
+			for (uint8 i = 0; i < NeighborCount; ++i)
 			{
-				for (const Pos& pos : takenStones)
-					Set(pos.x - 1, pos.y - 1, Stone::Empty);
+				const uint16 NeighborIdx = static_cast<uint16>((neighbors[i].x - 1) + (neighbors[i].y - 1) * size);
+				const Stone NeighborStone = board[NeighborIdx];
+				if (NeighborStone == Stone::Empty)
+				{
+					SetBit(chainLiberties[chainHeads[Idx]], NeighborIdx, true);
+					continue;
+				}
 
-				// アゲハマを増やす
-				const autosize hamaCount = takenStones.size();
-				if (stone == Stone::Black) hamaBlack += hamaCount;
-				else if (stone == Stone::White) hamaWhite += hamaCount;
+				const uint16 Head = chainHeads[NeighborIdx];
+				SetBit(chainLiberties[Head], Idx, false);
+				if (NeighborStone == stone)
+				{
+					if (Head != chainHeads[Idx]) MergeChains(chainHeads[Idx], Head);
+				}
+				else if (std::find(oppoHeads.begin(), oppoHeads.begin() + oppoCount, Head) == oppoHeads.begin() + oppoCount)
+					oppoHeads[oppoCount++] = Head;
 			}
 
-			// 同形反復なら、やっぱり着手できない
-			// 3手目より前なら、そもそもこのチェックは必要ないのでスキップ
-			// 1手前の盤面と比較する必要はないが、念のため比較する
-			if (history.size() >= 2 && (board == boardPre2 || board == boardPre1))
-			{
-				// 試しに着手していたものを、元に戻す
-				// 石を取るなど盤面がガッツリ変わっていることが想定されるので、
-				// 1手前の盤面のデータ (この時点では、石を置いてみる前の盤面の状態と一致している) で上書きして戻す
-				// ただし、コピーコストが高め.
-				board = boardPre1;
-				return false;
-			}
+			// 呼吸点が無くなった相手の連を取る (取った石は、lastTakenStones に記録する. 容量は、盤面を作ったときに最大の盤面の点の数だけ確保してあるので、確保し直すことはない)
+			lastTakenStones.clear();
+			for (uint8 i = 0; i < oppoCount; ++i)
+				if (GetLibertyCount(chainLiberties[oppoHeads[i]]) == 0)
+					RemoveChain(oppoHeads[i]);
+
+			// アゲハマを増やす
+			if (stone == Stone::Black) hamaBlack += lastTakenStones.size();
+			else if (stone == Stone::White) hamaWhite += lastTakenStones.size();
 
 			// 棋譜に追加する
 			history.emplace_back(PosStone{ { x, y }, stone });
 
-			// 盤面を保存する (1,2 手前の盤面を保存)
-			if (history.size() >= 2)
-			{
-				boardPre2 = boardPre1;  // 2手前の盤面を保存 (先ほどまで、1手前だったもの)
-				boardPre1 = board;  // 1手前の盤面を保存 (先ほどまで、現在の盤面だったもの)
-			}
-			else if (history.size() == 1)
-			{
-				boardPre1 = board;  // 1手目なら、1手前の盤面を保存 (先ほどまで、現在の盤面だったもの)
-			}
+			// 合法手の表と、コウの点を更新する
+			UpdateLegalMoves({ x, y });
+			UpdateKo({ x, y }, stone);
 
 			return true;
 		}
@@ -119,21 +126,150 @@ namespace Shusaku
 		// 左上角が (1, 1), 右下角が (size, size) の座標系で石を置く
 		// 石を置けるなら true を、置けないなら false を返す
 		// 石を置ける時、棋譜にも追加する (黒白交互であるかは気にしない)
-		// 2手前までの盤面を保存し、同形反復になるなら着手できない. ただし、長手数のコウ・同形反復は、チェックしない
+		// 直前の着手でコウになった点には、取り返す手番の側は打てない (同形反復). ただし、長手数のコウ・同形反復は、チェックしない
 		// コンピュータ同士の自動対戦を行うときは、手数の上限を設けるよう、強く推奨する
 		inline bool PutStone(const Pos& pos, Stone stone) { return PutStone(pos.x, pos.y, stone); }
 
+		// 左上角が (1, 1), 右下角が (size, size) の座標系で、stone の手番でその点に打てるか (PutStone が成功するか) を返す
+		// 空き点で、着手禁止点 (自殺手) でなく、コウを取り返す手でもないなら打てる
+		// 着手のたびに、変わった連の周りだけを差分で更新している表を引くので、O(1)
+		inline bool IsLegal(uint8 x, uint8 y, Stone stone) const
+		{
+			const int32 Idx = GetIndex({ static_cast<uint8>(x - 1), static_cast<uint8>(y - 1) });
+			if (Idx == -1 || stone == Stone::Empty) return false;
+			if (stone == koStone && Pos(x, y) == koPos) return false;
+			return TestBit(legalMoves[stone == Stone::Black ? 0 : 1], static_cast<uint16>(Idx));
+		}
+
+		// 左上角が (1, 1), 右下角が (size, size) の座標系で、stone の手番でその点に打てるか (PutStone が成功するか) を返す
+		inline bool IsLegal(const Pos& pos, Stone stone) const { return IsLegal(pos.x, pos.y, stone); }
+
+		// stone の手番で打てる点 (IsLegal を参照) を、outPositions に格納する (中身は上書きされる)
+		// 合法手の表をビット単位で走査するので、空き点を 1 つずつ調べるより速い
+		// 順番は、インデックス ((x-1)+(y-1)*size) の昇順
+		inline void GetLegalMoves(Stone stone, vec<Pos>& outPositions) const
+		{
+			outPositions.clear();
+			if (stone == Stone::Empty) return;
+
+			const PointBits& Bits = legalMoves[stone == Stone::Black ? 0 : 1];
+			for (uint8 word = 0; word < PointWordCount; ++word)
+				for (uint64 bits = Bits[word]; bits != 0; bits &= bits - 1)
+				{
+					const uint16 Idx = static_cast<uint16>(word * 64 + std::countr_zero(bits));
+					const Pos pos = { static_cast<uint8>(Idx % size + 1), static_cast<uint8>(Idx / size + 1) };
+					if (stone == koStone && pos == koPos) continue;
+					outPositions.push_back(pos);
+				}
+		}
+
+		// 直前の着手で石を 1 つ取ってコウになった点 (取り返す手番の側 GetKoStone は、次の 1 手では打てない)
+		// コウでなければ (0, 0)
+		inline const Pos& GetKoPos() const { return koPos; }
+		// コウの点 (GetKoPos) に打てない手番 (コウでなければ Stone::Empty)
+		inline Stone GetKoStone() const { return koStone; }
+
+		// 左上角が (1, 1), 右下角が (size, size) の座標系で、その点が stone にとっての眼 (1 目の真眼) かどうかを判定する
+		// 上下左右が全て stone の石 (または盤外) で、斜めにある相手の石が 盤の内側なら 1 個以下、盤端なら 0 個であるとき、眼とみなす
+		inline bool IsEye(uint8 x, uint8 y, Stone stone) const
+		{
+			if (GetStone(x, y) != Stone::Empty) return false;
+
+			// 上下左右
+			if (y > 1 && GetStone(x, y - 1) != stone) return false;
+			if (y < size && GetStone(x, y + 1) != stone) return false;
+			if (x > 1 && GetStone(x - 1, y) != stone) return false;
+			if (x < size && GetStone(x + 1, y) != stone) return false;
+
+			// 斜め
+			const Stone OppoStone = ReverseStone(stone);
+			uint8 oppoCount = 0;
+			bool onEdge = false;
+			for (const auto& [dx, dy] : { std::pair{ -1, -1 }, { 1, -1 }, { -1, 1 }, { 1, 1 } })
+			{
+				const int32 nx = x + dx, ny = y + dy;
+				if (nx < 1 || size < nx || ny < 1 || size < ny)
+				{
+					onEdge = true;
+					continue;
+				}
+				if (GetStone(static_cast<uint8>(nx), static_cast<uint8>(ny)) == OppoStone) ++oppoCount;
+			}
+
+			return oppoCount <= (onEdge ? 0 : 1);
+		}
+
+		// 左上角が (1, 1), 右下角が (size, size) の座標系で、その点が stone にとっての眼 (1 目の真眼) かどうかを判定する
+		inline bool IsEye(const Pos& pos, Stone stone) const { return IsEye(pos.x, pos.y, stone); }
+
+		// 左上角が (1, 1), 右下角が (size, size) の座標系で、pos にある石とつながっている石 (連) の、呼吸点の数を数える
+		// 呼吸点の座標を outLiberties に格納する (中身は上書きされる. 順番は、インデックスの昇順)
+		// maxCount 個見つかった時点で打ち切るので、「アタリかどうか」などの判定は軽く済む
+		// 空き点が指定されたら 0 を返す
+		inline uint16 GetLiberties(const Pos& pos, vec<Pos>& outLiberties, uint16 maxCount = MAX_uint16) const
+		{
+			outLiberties.clear();
+
+			const uint16 Idx = static_cast<uint16>((pos.x - 1) + (pos.y - 1) * size);
+			if (board[Idx] == Stone::Empty) return 0;
+
+			const PointBits& Liberties = chainLiberties[chainHeads[Idx]];
+			for (uint8 word = 0; word < PointWordCount; ++word)
+				for (uint64 bits = Liberties[word]; bits != 0; bits &= bits - 1)
+				{
+					const uint16 LibertyIdx = static_cast<uint16>(word * 64 + std::countr_zero(bits));
+					outLiberties.emplace_back(static_cast<uint8>(LibertyIdx % size + 1), static_cast<uint8>(LibertyIdx / size + 1));
+					if (outLiberties.size() >= maxCount) return static_cast<uint16>(outLiberties.size());
+				}
+			return static_cast<uint16>(outLiberties.size());
+		}
+
+		// 左上角が (1, 1), 右下角が (size, size) の座標系で、pos にある石とつながっている石 (連) の座標を、outStones に格納する (中身は上書きされる)
+		// 空き点が指定されたら、何も格納しない
+		inline void GetChain(const Pos& pos, vec<Pos>& outStones) const
+		{
+			outStones.clear();
+
+			const uint16 Idx = static_cast<uint16>((pos.x - 1) + (pos.y - 1) * size);
+			if (board[Idx] == Stone::Empty) return;
+
+			uint16 stoneIdx = Idx;
+			do
+			{
+				outStones.emplace_back(static_cast<uint8>(stoneIdx % size + 1), static_cast<uint8>(stoneIdx / size + 1));
+				stoneIdx = nextInChain[stoneIdx];
+			} while (stoneIdx != Idx);
+		}
+
+		// pos の上下左右 (盤内のみ) の座標を outNeighbors に格納し、その数を返す
+		// 左上角が (1, 1), 右下角が (size, size) の座標系
+		inline uint8 GetNeighbors(const Pos& pos, arr<Pos, 4>& outNeighbors) const
+		{
+			uint8 count = 0;
+			if (pos.y > 1) outNeighbors[count++] = Pos(pos.x, pos.y - 1);  // 上
+			if (pos.y < size) outNeighbors[count++] = Pos(pos.x, pos.y + 1);  // 下
+			if (pos.x > 1) outNeighbors[count++] = Pos(pos.x - 1, pos.y);  // 左
+			if (pos.x < size) outNeighbors[count++] = Pos(pos.x + 1, pos.y);  // 右
+			return count;
+		}
+
 		// 盤面を空に戻し、棋譜もクリアする.
 		inline void Clear()
 		{
 			hamaBlack = 0;
 			hamaWhite = 0;
+			stoneBalance = 0;
 
 			std::fill(board.begin(), board.end(), Stone::Empty);
-			boardPre1.clear();
+			RebuildPatterns();
+			RebuildHash();
+			RebuildChains();
 			boardPre2.clear();
 
 			history.clear();
+			lastTakenStones.clear();
+			koPos = { 0, 0 };
+			koStone = Stone::Empty;
 		}
 
 		inline uint8 GetSize() const { return size; }
@@ -141,8 +277,72 @@ namespace Shusaku
 		inline uint16 GetPositionsCount() const { return positionsCount; }
 		inline uint64 GetHamaBlack() const { return hamaBlack; }
 		inline uint64 GetHamaWhite() const { return hamaWhite; }
+		// 盤上の黒石の数から、白石の数を引いたもの (石を置いた・取ったときに差分で更新している)
+		inline int32 GetStoneBalance() const { return stoneBalance; }
 		inline const vec<Stone>& GetBoard() const { return board; }
 		inline const vec<PosStone>& GetHistory() const { return history; }
+		// 直前の着手をする前の盤面 (同形反復の判定で、次の着手の後の盤面と比べるもの. 着手が 2 手に満たなければ空)
+		inline const vec<Stone>& GetBoardBeforeLastMove() const { return boardPre2; }
+
+		// 直前に成功した着手で取った石の座標 (左上角が (1, 1), 右下角が (size, size) の座標系)
+		inline const vec<Pos>& GetLastTakenStones() const { return lastTakenStones; }
+
+		// 左上角が (1, 1), 右下角が (size, size) の座標系で、その点の 3x3 パターンのコード (Pattern3x3 を参照) を取得する
+		// 石を置いた・取ったときに、周囲の点のコードだけを差分で更新している
+		inline uint16 GetPattern(uint8 x, uint8 y) const { return patterns[GetIndex({ static_cast<uint8>(x - 1), static_cast<uint8>(y - 1) })]; }
+		// 左上角が (1, 1), 右下角が (size, size) の座標系で、その点の 3x3 パターンのコード (Pattern3x3 を参照) を取得する
+		inline uint16 GetPattern(const Pos& pos) const { return GetPattern(pos.x, pos.y); }
+
+		// 盤面を変えない対称変換 (Symmetry を参照) の集合を、ビットマスクで返す (bit s が立っていれば、変換 s で盤面が変わらない)
+		// 同形反復の判定に使う 2 手前の盤面も変えないものだけを含めるので、対称な点に打った結果は、打てるかどうかも含めて対称になる
+		// 恒等変換 (bit 0) は常に含む
+		inline uint8 GetSymmetryMask() const
+		{
+			uint8 mask = 1 << Symmetry::Identity;
+			for (uint8 symmetry = 1; symmetry < Symmetry::Count; ++symmetry)
+			{
+				bool isInvariant = true;
+				for (uint16 idx = 0; idx < positionsCount && isInvariant; ++idx)
+				{
+					uint8 x = static_cast<uint8>(idx % size), y = static_cast<uint8>(idx / size);
+					Symmetry::Apply(symmetry, size, x, y);
+					const uint16 TransformedIdx = x + y * size;
+
+					if (board[TransformedIdx] != board[idx]) isInvariant = false;
+					else if (!boardPre2.empty() && boardPre2[TransformedIdx] != boardPre2[idx]) isInvariant = false;
+				}
+				if (isInvariant) mask |= 1 << symmetry;
+			}
+			return mask;
+		}
+
+		// 盤面のハッシュ値 (Zobrist を参照. 手番・コウの状態は含まない)
+		// 石を置いた・取ったときに、差分で更新している
+		inline uint64 GetHash() const { return hash; }
+
+		// 盤面を 8 通りの対称変換 (Symmetry を参照) で移したもののハッシュ値のうち、最小のものを返す
+		// 対称な盤面同士は同じ値になるので、定石・評価のキャッシュのキーに使う
+		// outSymmetry が nullptr でないなら、最小値を与えた変換を格納する (この変換で移した盤面を、正規形とする)
+		inline uint64 GetCanonicalHash(uint8* outSymmetry = nullptr) const
+		{
+			arr<uint64, Symmetry::Count> hashes{};
+			for (uint16 idx = 0; idx < positionsCount; ++idx)
+			{
+				const Stone stone = board[idx];
+				if (stone == Stone::Empty) continue;
+
+				for (uint8 symmetry = 0; symmetry < Symmetry::Count; ++symmetry)
+				{
+					uint8 x = static_cast<uint8>(idx % size), y = static_cast<uint8>(idx / size);
+					Symmetry::Apply(symmetry, size, x, y);
+					hashes[symmetry] ^= Zobrist::GetStoneKey(x + y * size, stone);
+				}
+			}
+
+			const uint8 MinSymmetry = static_cast<uint8>(std::min_element(hashes.begin(), hashes.end()) - hashes.begin());
+			if (outSymmetry) *outSymmetry = MinSymmetry;
+			return hashes[MinSymmetry];
+		}
 
 	private:
 
@@ -152,16 +352,44 @@ namespace Shusaku
 
 		uint64 hamaBlack = 0;  // 黒が取ったアゲハマ (白石) の数
 		uint64 hamaWhite = 0;  // 白が取ったアゲハマ (黒石) の数
+		int32 stoneBalance = 0;  // 盤上の黒石の数 - 白石の数
 
 		vec<Stone> board;
 		// 棋譜 (黒 → 白 → 黒 → ... の順番で置かれた座標の履歴)
 		// 左上角が (1, 1), 右下角が (size, size) の座標系
 		vec<PosStone> history;
 
-		// 1,2 手前の盤面を保存するための変数
-		vec<Stone> boardPre1;
+		// 直前の着手をする前の盤面 (着手が 2 手に満たなければ空)
 		vec<Stone> boardPre2;
 
+		// 各点の 3x3 パターンのコード (board と同じインデックス)
+		vec<uint16> patterns;
+
+		// 直前に成功した着手で取った石
+		vec<Pos> lastTakenStones;
+
+		// 盤面のハッシュ値 (Zobrist を参照)
+		uint64 hash = 0;
+
+		// 交点ごとに 1 ビットの表 (board と同じインデックス)
+		static constexpr uint8 PointWordCount = (MaxPositionsCount + 63) / 64;
+		using PointBits = arr<uint64, PointWordCount>;
+
+		// 連 (つながっている石) の情報
+		// 連の石は nextInChain で循環リストにつなぎ、連の代表の石 (chainHeads) のインデックスで、石の数と呼吸点を引く
+		// 石を置いた・取ったときに、周りの連だけを差分で更新している
+		vec<uint16> chainHeads;  // 各点の石が属する連の代表 (board と同じインデックス. 空き点では意味を持たない)
+		vec<uint16> nextInChain;  // 同じ連の次の石 (board と同じインデックス)
+		vec<uint16> chainSizes;  // 連の石の数 (代表のインデックスで引く)
+		vec<PointBits> chainLiberties;  // 連の呼吸点の表 (代表のインデックスで引く)
+
+		// 手番ごとの、打てる点 (空き点で、着手禁止点でない) の表 ([0] が黒番、[1] が白番. コウは含めない)
+		arr<PointBits, 2> legalMoves{};
+
+		// コウの点と、そこに打てない手番 (GetKoPos を参照)
+		Pos koPos = { 0, 0 };
+		Stone koStone = Stone::Empty;
+
 		inline Board(BoardSize boardSize)
 		{
 			uint8 size = 0;
@@ -175,7 +403,16 @@ namespace Shusaku
 			this->boardSize = boardSize;
 
 			this->board.resize(positionsCount, Stone::Empty);
+			this->patterns.resize(positionsCount, 0);
+			this->chainHeads.resize(positionsCount, 0);
+			this->nextInChain.resize(positionsCount, 0);
+			this->chainSizes.resize(positionsCount, 0);
+			this->chainLiberties.resize(positionsCount);
+			RebuildPatterns();
+			RebuildHash();
+			RebuildChains();
 			this->history.reserve(static_cast<autosize>(positionsCount) << 2);  // 同形反復があるので、一応4倍程度の容量を確保しておく
+			this->lastTakenStones.reserve(MaxPositionsCount);  // 1 手で取る石は、盤面の点の数を越えない (大きさの違う盤面をコピー代入しても足りるように、最大の盤面の分)
 		}
 
 		// 左上角が (0, 0), 右下角が (size - 1, size - 1) の座標系で石を取得する
@@ -192,7 +429,50 @@ namespace Shusaku
 		{
 			int32 idx = GetIndex({ x, y });
 			if (idx == -1) return;  // 範囲外なら何もしない
+
+			// ハッシュ値から元の石を除き、新しい石を加える
+			if (board[idx] != Stone::Empty) hash ^= Zobrist::GetStoneKey(idx, board[idx]);
+			if (stone != Stone::Empty) hash ^= Zobrist::GetStoneKey(idx, stone);
+
+			// 黒石と白石の数の差も、元の石を除き、新しい石を加える
+			stoneBalance -= GetBalanceSign(board[idx]);
+			stoneBalance += GetBalanceSign(stone);
 			board[idx] = stone;
+
+			// 周囲の点から見ると、この点の状態が変わったので、3x3 パターンを更新する
+			for (uint8 dir = 0; dir < Pattern3x3::DirectionCount; ++dir)
+			{
+				const int32 neighborIdx = GetIndex({ static_cast<uint8>(x + Pattern3x3::DirectionX[dir]), static_cast<uint8>(y + Pattern3x3::DirectionY[dir]) });
+				if (neighborIdx == -1) continue;
+
+				uint16& code = patterns[neighborIdx];
+				code = Pattern3x3::SetField(code, Pattern3x3::GetOpposite(dir), static_cast<uint8>(stone));
+			}
+		}
+
+		// 全ての点の 3x3 パターンを、盤面から計算し直す
+		inline void RebuildPatterns()
+		{
+			for (uint8 y = 0; y < size; ++y)
+				for (uint8 x = 0; x < size; ++x)
+				{
+					uint16 code = 0;
+					for (uint8 dir = 0; dir < Pattern3x3::DirectionCount; ++dir)
+					{
+						const int32 neighborIdx = GetIndex({ static_cast<uint8>(x + Pattern3x3::DirectionX[dir]), static_cast<uint8>(y + Pattern3x3::DirectionY[dir]) });
+						const uint8 value = neighborIdx != -1 ? static_cast<uint8>(board[neighborIdx]) : Pattern3x3::OffBoard;
+						code = Pattern3x3::SetField(code, dir, value);
+					}
+					patterns[GetIndex({ x, y })] = code;
+				}
+		}
+
+		// 盤面のハッシュ値を、盤面から計算し直す
+		inline void RebuildHash()
+		{
+			hash = 0;
+			for (uint16 idx = 0; idx < positionsCount; ++idx)
+				if (board[idx] != Stone::Empty) hash ^= Zobrist::GetStoneKey(idx, board[idx]);
 		}
 
 		// 盤面の座標から、配列のインデックスを取得する
@@ -206,120 +486,196 @@ namespace Shusaku
 			return pos.x + pos.y * size;
 		}
 
-		// pos の周囲の座標を取得する
-		// 左上角が (1, 1), 右下角が (size, size) の座標系
-		inline uset<Pos> GetSurroundingPositions(const Pos& pos) const
+		static inline bool TestBit(const PointBits& bits, uint16 idx) { return (bits[idx >> 6] >> (idx & 63)) & 1; }
+		static inline void SetBit(PointBits& bits, uint16 idx, bool value)
 		{
-			uset<Pos> out;
-			out.reserve(4);
-
-			if (pos.y > 1) out.insert(Pos(pos.x, pos.y - 1));  // 上
-			if (pos.y < size) out.insert(Pos(pos.x, pos.y + 1));  // 下
-			if (pos.x > 1) out.insert(Pos(pos.x - 1, pos.y));  // 左
-			if (pos.x < size) out.insert(Pos(pos.x + 1, pos.y));  // 右
-
-			return out;
+			const uint64 Mask = uint64(1) << (idx & 63);
+			if (value) bits[idx >> 6] |= Mask;
+			else bits[idx >> 6] &= ~Mask;
 		}
-
-		// groupElementPos とつながっている石を探索する
-		// groupPos にはつながっている石の座標を、surroundingPos にはその周囲の座標を格納する
-		// 左上角が (1, 1), 右下角が (size, size) の座標系
-		inline void GetGroup(const Pos& groupElementPos, uset<Pos>& outGroupPos, uset<Pos>& outSurroundingPos) const
+		static inline void OrBits(PointBits& bits, const PointBits& other)
 		{
-			// このグループの石の種類
-			Stone groupStone = Get(groupElementPos.x - 1, groupElementPos.y - 1);
+			for (uint8 word = 0; word < PointWordCount; ++word)
+				bits[word] |= other[word];
+		}
+		static inline uint16 GetLibertyCount(const PointBits& liberties)
+		{
+			uint16 count = 0;
+			for (const uint64 Word : liberties)
+				count += static_cast<uint16>(std::popcount(Word));
+			return count;
+		}
 
-			outGroupPos.clear();
-			outSurroundingPos.clear();
+		// 2 つの連 (代表が headA, headB) を合体する
+		// 小さい方の連の石の代表を付け替え、循環リストをつなぎ、呼吸点を合わせる
+		inline void MergeChains(uint16 headA, uint16 headB)
+		{
+			if (chainSizes[headA] < chainSizes[headB]) std::swap(headA, headB);
 
+			uint16 stoneIdx = headB;
+			do
 			{
-				// 今探索中の座標
-				que<Pos> q;
-				q.push(groupElementPos);
+				chainHeads[stoneIdx] = headA;
+				stoneIdx = nextInChain[stoneIdx];
+			} while (stoneIdx != headB);
 
-				// 全ての探索が終了するまで繰り返す
-				while (!q.empty())
-				{
-					// 探索するべき座標を取得し、キューから削除
-					Pos pos = q.front();
-					q.pop();
-
-					// 既に探索済みならスキップ
-					if (outGroupPos.contains(pos)) continue;
+			std::swap(nextInChain[headA], nextInChain[headB]);
+			chainSizes[headA] += chainSizes[headB];
+			OrBits(chainLiberties[headA], chainLiberties[headB]);
+		}
 
-					// つながっている石だと判明
+		// 黒石なら 1、白石なら -1、空き点なら 0 を返す (stoneBalance の更新用)
+		static inline int32 GetBalanceSign(Stone stone)
+		{
+			return stone == Stone::Black ? 1 : stone == Stone::White ? -1 : 0;
+		}
 
-					// グループに追加
-					outGroupPos.insert(pos);
+		// 代表が head の連の石を全て取り除き、lastTakenStones に加える
+		// 取り除いた点は、隣の連 (取った側の連) の呼吸点になる
+		inline void RemoveChain(uint16 head)
+		{
+			const autosize Begin = lastTakenStones.size();
+			uint16 stoneIdx = head;
+			do
+			{
+				const Pos pos = { static_cast<uint8>(stoneIdx % size + 1), static_cast<uint8>(stoneIdx / size + 1) };
+				Set(pos.x - 1, pos.y - 1, Stone::Empty);
+				lastTakenStones.push_back(pos);
+				stoneIdx = nextInChain[stoneIdx];
+			} while (stoneIdx != head);
 
-					// 周囲の座標を取得し、次探索に情報を引き継ぐ
-					{
-						uset<Pos> surroundingPos = GetSurroundingPositions(pos);
+			for (autosize t = Begin; t < lastTakenStones.size(); ++t)
+			{
+				const Pos& pos = lastTakenStones[t];
+				arr<Pos, 4> neighbors;
+				const uint8 NeighborCount = GetNeighbors(pos, neighbors);
+				for (uint8 i = 0; i < NeighborCount; ++i)
+				{
+					const uint16 NeighborIdx = static_cast<uint16>((neighbors[i].x - 1) + (neighbors[i].y - 1) * size);
+					if (board[NeighborIdx] == Stone::Empty) continue;
+					SetBit(chainLiberties[chainHeads[NeighborIdx]], static_cast<uint16>((pos.x - 1) + (pos.y - 1) * size), true);
+				}
+			}
+		}
 
-						for (const Pos& p : surroundingPos)
-						{
-							// 探索済みならスキップ
-							if (outGroupPos.contains(p)) continue;
+		// 全ての点の連の情報と、打てるかどうかを、盤面から計算し直す
+		inline void RebuildChains()
+		{
+			for (uint16 idx = 0; idx < positionsCount; ++idx)
+			{
+				chainHeads[idx] = idx;
+				nextInChain[idx] = idx;
+				chainSizes[idx] = board[idx] != Stone::Empty ? 1 : 0;
+				chainLiberties[idx] = {};
+			}
 
-							// 今見ている、周囲の石の種類
-							Stone stone = Get(p.x - 1, p.y - 1);
+			// 各石を 1 つだけの連とし、上下左右の空き点を呼吸点に加え、左・上の同じ色の連と合体する
+			for (uint16 idx = 0; idx < positionsCount; ++idx)
+			{
+				if (board[idx] == Stone::Empty) continue;
 
-							// グループの石なら、キューに追加
-							if (stone == groupStone) q.push(p);
-							// そうでないなら、グループを囲む点であるので、追加
-							else outSurroundingPos.insert(p);
-						}
-					}
+				const Pos pos = { static_cast<uint8>(idx % size + 1), static_cast<uint8>(idx / size + 1) };
+				arr<Pos, 4> neighbors;
+				const uint8 NeighborCount = GetNeighbors(pos, neighbors);
+				for (uint8 i = 0; i < NeighborCount; ++i)
+				{
+					const uint16 NeighborIdx = static_cast<uint16>((neighbors[i].x - 1) + (neighbors[i].y - 1) * size);
+					if (board[NeighborIdx] == Stone::Empty) SetBit(chainLiberties[chainHeads[idx]], NeighborIdx, true);
+					else if (NeighborIdx < idx && board[NeighborIdx] == board[idx] && chainHeads[NeighborIdx] != chainHeads[idx])
+						MergeChains(chainHeads[idx], chainHeads[NeighborIdx]);
 				}
 			}
+
+			for (uint16 idx = 0; idx < positionsCount; ++idx)
+				UpdateLegality(idx);
 		}
 
-		// elementPos にある石・及びそれとつながっている石のグループについて、相手の石に囲まれているかどうかをチェックする
-		// 囲まれているなら true を、囲まれていないなら false を返す
-		// 左上角が (1, 1), 右下角が (size, size) の座標系
-		inline bool CheckSurrounded(const Pos& elementPos) const
+		// インデックス idx の点に黒・白が打てるか (コウは除く) を、連の呼吸点の数から求め直す
+		// 上下左右に空き点があれば、どちらも打てる
+		// 無ければ、呼吸点が 2 つ以上ある自分の連につながるか、呼吸点が idx だけの相手の連を取れるなら打てる
+		inline void UpdateLegality(uint16 idx)
 		{
-			const Stone GroupStone = Get(elementPos.x - 1, elementPos.y - 1);
-			if (GroupStone == Stone::Empty) return false;  // 空き点が指定されたら判定不可
-			const Stone OppoStone = ReverseStone(GroupStone);
-
-			uset<Pos> _, surroundingPos;
-			GetGroup(elementPos, _, surroundingPos);
+			if (board[idx] != Stone::Empty)
+			{
+				SetBit(legalMoves[0], idx, false);
+				SetBit(legalMoves[1], idx, false);
+				return;
+			}
 
-			for (const Pos& pos : surroundingPos)
+			const Pos pos = { static_cast<uint8>(idx % size + 1), static_cast<uint8>(idx / size + 1) };
+			arr<Pos, 4> neighbors;
+			const uint8 NeighborCount = GetNeighbors(pos, neighbors);
+			bool isBlackLegal = false, isWhiteLegal = false;
+			for (uint8 i = 0; i < NeighborCount; ++i)
 			{
-				if (Get(pos.x - 1, pos.y - 1) != OppoStone)
-					return false;
+				const uint16 NeighborIdx = static_cast<uint16>((neighbors[i].x - 1) + (neighbors[i].y - 1) * size);
+				const Stone NeighborStone = board[NeighborIdx];
+				if (NeighborStone == Stone::Empty)
+				{
+					isBlackLegal = isWhiteLegal = true;
+					break;
+				}
+
+				// 呼吸点が 1 つ (idx) だけなら、相手はそれを取れ、自分はつながっても呼吸点が無い
+				const bool IsInAtari = GetLibertyCount(chainLiberties[chainHeads[NeighborIdx]]) == 1;
+				if (NeighborStone == Stone::Black) (IsInAtari ? isWhiteLegal : isBlackLegal) = true;
+				else (IsInAtari ? isBlackLegal : isWhiteLegal) = true;
 			}
-			return true;
+			SetBit(legalMoves[0], idx, isBlackLegal);
+			SetBit(legalMoves[1], idx, isWhiteLegal);
 		}
 
-		// stone が targetPos にある石を、取れるかどうかをチェックする
-		// 取れるなら true を、取れないなら false を返す
-		// その際、取ることができる相手の石の座標を outTakenStones に格納する
+		// pos への着手 (と、その着手で取った石 lastTakenStones) で、打てるかどうかが変わりうる点だけを求め直す
+		// 変わりうるのは、次の点だけ
+		// - 着手した点・取った石の点と、その上下左右 (空き点が増減した)
+		// - 着手した点に接する連 (自分の連は合体し、相手の連は呼吸点を 1 つ失った) の呼吸点が 1 つになったなら、その呼吸点
+		// - 取った石に接する連 (呼吸点が増えた) の、全ての呼吸点
 		// 左上角が (1, 1), 右下角が (size, size) の座標系
-		inline bool CheckCanTake(Stone stone, const Pos& targetPos, uset<Pos>& outTakenStones) const
+		inline void UpdateLegalMoves(const Pos& pos)
 		{
-			outTakenStones.clear();
+			PointBits dirty{};
+			const auto MarkAround = [this, &dirty](const Pos& center)
+				{
+					SetBit(dirty, static_cast<uint16>((center.x - 1) + (center.y - 1) * size), true);
+					arr<Pos, 4> neighbors;
+					const uint8 NeighborCount = GetNeighbors(center, neighbors);
+					for (uint8 i = 0; i < NeighborCount; ++i)
+					{
+						const uint16 NeighborIdx = static_cast<uint16>((neighbors[i].x - 1) + (neighbors[i].y - 1) * size);
+						SetBit(dirty, NeighborIdx, true);
+
+						// 石を取ったなら、隣の連は呼吸点が増え、着手したなら、隣の連は呼吸点を失った
+						if (board[NeighborIdx] == Stone::Empty) continue;
+						const PointBits& Liberties = chainLiberties[chainHeads[NeighborIdx]];
+						if (board[(center.x - 1) + (center.y - 1) * size] == Stone::Empty || GetLibertyCount(Liberties) == 1)
+							OrBits(dirty, Liberties);
+					}
+				};
 
-			if (Get(targetPos.x - 1, targetPos.y - 1) != ReverseStone(stone))
-				return false;  // 対象の位置に相手の石がないなら取れない
+			MarkAround(pos);
+			for (const Pos& taken : lastTakenStones)
+				MarkAround(taken);
 
-			// 対象の石とつながっている石を探索
-			uset<Pos> groupPos, surroundingPos;
-			GetGroup(targetPos, groupPos, surroundingPos);
+			for (uint8 word = 0; word < PointWordCount; ++word)
+				for (uint64 bits = dirty[word]; bits != 0; bits &= bits - 1)
+					UpdateLegality(static_cast<uint16>(word * 64 + std::countr_zero(bits)));
+		}
 
-			// 対象の石とつながっている石の周囲が、全て自分の石で囲まれているなら取れる
-			for (const Pos& pos : surroundingPos)
-			{
-				if (Get(pos.x - 1, pos.y - 1) != stone)
-					return false;
-			}
+		// stone が pos に打った直後に、コウの点を求め直す
+		// 石を 1 つだけ取り、打った石が 1 つだけの連で、呼吸点が取った石の点だけなら、そこがコウになる
+		// (相手がすぐに取り返すと、直前の着手をする前の盤面に戻ってしまう)
+		// 左上角が (1, 1), 右下角が (size, size) の座標系
+		inline void UpdateKo(const Pos& pos, Stone stone)
+		{
+			koPos = { 0, 0 };
+			koStone = Stone::Empty;
+			if (lastTakenStones.size() != 1) return;
 
-			// 相手の石を取ることができる
+			const uint16 Head = chainHeads[(pos.x - 1) + (pos.y - 1) * size];
+			if (chainSizes[Head] != 1 || GetLibertyCount(chainLiberties[Head]) != 1) return;
 
-			outTakenStones = groupPos;
-			return true;
+			koPos = lastTakenStones[0];
+			koStone = ReverseStone(stone);
 		}
 	};
 }
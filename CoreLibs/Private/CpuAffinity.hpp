@@ -0,0 +1,136 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "TypeAlias.hpp"
+#include "MacroDefine.hpp"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <sched.h>
+#endif
+
+namespace Shusaku
+{
+	// スレッドを、特定の CPU (論理コア) に固定する
+	// 同じマシンで複数のエンジンを動かす時に、CPU を取り合わないように分けるために使う
+	// Linux と Windows (64 個目までの CPU) でのみ固定でき、それ以外の環境では何もしない
+	class CpuAffinity final
+	{
+	public:
+
+		inline CpuAffinity() = delete;
+
+		// このプロセスが使える CPU の番号を、昇順で返す (分からなければ空)
+		static inline vec<uint32> GetAvailableCpus()
+		{
+			vec<uint32> cpus;
+#ifdef _WIN32
+			DWORD_PTR processMask = 0, systemMask = 0;
+			if (!GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask)) return cpus;
+			for (uint32 cpu = 0; cpu < sizeof(DWORD_PTR) * 8; ++cpu)
+				if (processMask & (static_cast<DWORD_PTR>(1) << cpu)) cpus.push_back(cpu);
+#elif defined(__linux__)
+			cpu_set_t available;
+			CPU_ZERO(&available);
+			if (sched_getaffinity(0, sizeof(available), &available) != 0) return cpus;
+			for (uint32 cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+				if (CPU_ISSET(cpu, &available)) cpus.push_back(cpu);
+#endif
+			return cpus;
+		}
+
+		// 呼び出したスレッドを、cpus のいずれかで動くように固定する (この後に立てたスレッドにも引き継がれる)
+		// 固定できたら true を返す (cpus が空なら、何もせず false を返す)
+		static inline bool PinCurrentThread(UNUSED const vec<uint32>& cpus)
+		{
+			if (cpus.empty()) return false;
+#ifdef _WIN32
+			DWORD_PTR mask = 0;
+			for (const uint32 Cpu : cpus)
+				if (Cpu < sizeof(DWORD_PTR) * 8) mask |= static_cast<DWORD_PTR>(1) << Cpu;
+			return mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#elif defined(__linux__)
+			cpu_set_t pinned;
+			CPU_ZERO(&pinned);
+			for (const uint32 Cpu : cpus)
+				if (Cpu < CPU_SETSIZE) CPU_SET(Cpu, &pinned);
+			return CPU_COUNT(&pinned) > 0 && sched_setaffinity(0, sizeof(pinned), &pinned) == 0;  // 0 は、呼び出したスレッド
+#else
+			return false;
+#endif
+		}
+
+		// cpus を count 等分したうちの、idx 番目の範囲を返す
+		// CPU が count より少なければ、1 つずつ順に割り当てる
+		static inline vec<uint32> GetShare(const vec<uint32>& cpus, uint32 idx, uint32 count)
+		{
+			if (cpus.empty() || count == 0) return {};
+
+			autosize begin = cpus.size() * idx / count;
+			autosize end = cpus.size() * (idx + 1) / count;
+			if (begin == end)
+			{
+				begin = idx % cpus.size();
+				end = begin + 1;
+			}
+			return vec<uint32>(cpus.begin() + begin, cpus.begin() + end);
+		}
+
+		// "0-3,8,10-11" のような、CPU の番号 (と、その範囲) をカンマで区切った文字列を読み取り、昇順 (重複なし) で outCpus に格納する
+		// 読み取れなかったら false を返す
+		static inline bool ParseList(const str& text, vec<uint32>& outCpus)
+		{
+			outCpus.clear();
+
+			autosize begin = 0;
+			while (begin <= text.size())
+			{
+				const autosize End = std::min(text.find(',', begin), text.size());
+				const str Item = text.substr(begin, End - begin);
+				begin = End + 1;
+
+				uint32 first, last;
+				const autosize Dash = Item.find('-');
+				if (Dash == str::npos)
+				{
+					if (!ParseNumber(Item, first)) return false;
+					last = first;
+				}
+				else if (!ParseNumber(Item.substr(0, Dash), first) || !ParseNumber(Item.substr(Dash + 1), last) || last < first)
+					return false;
+
+				for (uint32 cpu = first; cpu <= last; ++cpu)
+					outCpus.push_back(cpu);
+			}
+
+			std::sort(outCpus.begin(), outCpus.end());
+			outCpus.erase(std::unique(outCpus.begin(), outCpus.end()), outCpus.end());
+			return !outCpus.empty();
+		}
+
+	private:
+
+		// 空白を除いた 10 進数を読み取る
+		static inline bool ParseNumber(const str& text, uint32& outValue)
+		{
+			const autosize First = text.find_first_not_of(" \t");
+			const autosize Last = text.find_last_not_of(" \t");
+			if (First == str::npos) return false;
+
+			outValue = 0;
+			for (autosize i = First; i <= Last; ++i)
+			{
+				if (text[i] < '0' || '9' < text[i]) return false;
+				outValue = outValue * 10 + static_cast<uint32>(text[i] - '0');
+				if (outValue > 65535) return false;  // CPU の番号として大き過ぎる
+			}
+			return true;
+		}
+	};
+}
@@ -1,5 +1,8 @@
 ﻿#pragma once
 
+#include <cfloat>
+#include <cstdint>
+
 #define MAX_int8 (INT8_MAX)
 #define MAX_int16 (INT16_MAX)
 #define MAX_int32 (INT32_MAX)
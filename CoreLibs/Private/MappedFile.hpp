@@ -0,0 +1,122 @@
+﻿#pragma once
+
+#include <string>
+#include "TypeAlias.hpp"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Shusaku
+{
+	// ファイルを、メモリにマップする (既定では読み取り専用)
+	// 中身はページ単位で必要になった分だけ読み込まれ、同じファイルをマップした他のプロセスとも共有される
+	// 書き込めるようにマップした場合、書き込んだ内容は、同じファイルをマップした他のプロセスからもすぐに見え、いずれファイルにも書き戻される
+	class MappedFile final
+	{
+	public:
+
+		inline MappedFile() = default;
+		inline ~MappedFile() { Close(); }
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		// path のファイルをマップする (既に開いているものは閉じる)
+		// writable なら、書き込めるようにマップする (GetWritableData を参照)
+		// 開けなかった・空のファイルだった場合は false を返す
+		inline bool Open(const str& path, bool writable = false)
+		{
+			Close();
+
+#ifdef _WIN32
+			const DWORD Access = writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ;
+			const DWORD Share = writable ? FILE_SHARE_READ | FILE_SHARE_WRITE : FILE_SHARE_READ;
+			fileHandle = CreateFileA(path.c_str(), Access, Share, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (fileHandle == INVALID_HANDLE_VALUE) return false;
+
+			LARGE_INTEGER fileSize{};
+			if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+			{
+				Close();
+				return false;
+			}
+
+			mappingHandle = CreateFileMappingA(fileHandle, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, nullptr);
+			if (mappingHandle == nullptr)
+			{
+				Close();
+				return false;
+			}
+
+			data = static_cast<uint8*>(MapViewOfFile(mappingHandle, writable ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, 0));
+			if (data == nullptr)
+			{
+				Close();
+				return false;
+			}
+			size = static_cast<autosize>(fileSize.QuadPart);
+#else
+			const int32 Fd = open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+			if (Fd < 0) return false;
+
+			struct stat fileStat{};
+			if (fstat(Fd, &fileStat) != 0 || fileStat.st_size == 0)
+			{
+				close(Fd);
+				return false;
+			}
+
+			void* p = mmap(nullptr, static_cast<autosize>(fileStat.st_size), writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, Fd, 0);
+			close(Fd);  // マップした後は、閉じても構わない
+			if (p == MAP_FAILED) return false;
+
+			data = static_cast<uint8*>(p);
+			size = static_cast<autosize>(fileStat.st_size);
+#endif
+			isWritable = writable;
+			return true;
+		}
+
+		inline void Close()
+		{
+#ifdef _WIN32
+			if (data) UnmapViewOfFile(data);
+			if (mappingHandle) CloseHandle(mappingHandle);
+			if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+			mappingHandle = nullptr;
+			fileHandle = INVALID_HANDLE_VALUE;
+#else
+			if (data) munmap(data, size);
+#endif
+			data = nullptr;
+			size = 0;
+			isWritable = false;
+		}
+
+		inline bool IsOpen() const { return data != nullptr; }
+		inline const uint8* GetData() const { return data; }
+		// 書き込めるようにマップしていなければ nullptr
+		inline uint8* GetWritableData() const { return isWritable ? data : nullptr; }
+		inline autosize GetSize() const { return size; }
+
+	private:
+
+		uint8* data = nullptr;
+		autosize size = 0;
+		bool isWritable = false;
+
+#ifdef _WIN32
+		HANDLE fileHandle = INVALID_HANDLE_VALUE;
+		HANDLE mappingHandle = nullptr;
+#endif
+	};
+}
@@ -0,0 +1,263 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <array>
+#include <vector>
+#include "TypeAlias.hpp"
+#include "StoneEnum.hpp"
+
+namespace Shusaku
+{
+	// 3x3 パターン (ある点の周囲 8 点の状態) を扱う
+	// 周囲 8 点それぞれの状態を 2bit (0: 空き点, 1: 黒, 2: 白, 3: 盤外) で表し、16bit のコードにまとめる
+	// 並びは下位 bit から、上, 下, 左, 右, 左上, 右上, 左下, 右下 の順
+	class Pattern3x3 final
+	{
+	public:
+
+		inline Pattern3x3() = delete;
+
+		static constexpr uint8 DirectionCount = 8;  // 周囲の点の数
+		static constexpr uint8 OffBoard = 3;  // 盤外を表す値
+		static constexpr autosize CodeCount = 1 << 16;  // コードの種類数
+
+		// 各方向の、中心からの相対座標
+		static constexpr arr<int8, DirectionCount> DirectionX = { 0, 0, -1, 1, -1, 1, -1, 1 };
+		static constexpr arr<int8, DirectionCount> DirectionY = { -1, 1, 0, 0, -1, -1, 1, 1 };
+
+		// 方向 dir の反対方向を返す (周囲の点から見て、中心がどの方向にあるか)
+		inline static constexpr uint8 GetOpposite(uint8 dir)
+		{
+			constexpr arr<uint8, DirectionCount> Opposites = { 1, 0, 3, 2, 7, 6, 5, 4 };
+			return Opposites[dir];
+		}
+
+		// コードから、方向 dir の点の状態を取り出す
+		inline static constexpr uint8 GetField(uint16 code, uint8 dir)
+		{
+			return static_cast<uint8>((code >> (dir << 1)) & 0b11);
+		}
+
+		// コードの、方向 dir の点の状態を value に書き換えたものを返す
+		inline static constexpr uint16 SetField(uint16 code, uint8 dir, uint8 value)
+		{
+			const uint8 Shift = dir << 1;
+			return static_cast<uint16>((code & ~(0b11 << Shift)) | (value << Shift));
+		}
+
+		// 黒石と白石を入れ替えたコードを返す (空き点・盤外はそのまま)
+		inline static constexpr uint16 SwapColors(uint16 code)
+		{
+			// 01 と 10 のフィールドだけ、両方の bit を反転させる
+			return static_cast<uint16>(code ^ (((code ^ (code >> 1)) & 0x5555) * 0b11));
+		}
+
+		// コードを、対称変換 symmetry (Symmetry と同じ 3bit の表現) で移したものを返す
+		inline static constexpr uint16 Transform(uint16 code, uint8 symmetry)
+		{
+			uint16 transformed = 0;
+			for (uint8 dir = 0; dir < DirectionCount; ++dir)
+			{
+				int8 dx = DirectionX[dir], dy = DirectionY[dir];
+				if (symmetry & 4) { const int8 t = dx; dx = dy; dy = t; }
+				if (symmetry & 1) dx = -dx;
+				if (symmetry & 2) dy = -dy;
+
+				const uint8 TransformedDir = static_cast<uint8>(GetDirection(static_cast<uint8>(dy + 1), static_cast<uint8>(dx + 1)));
+				transformed = SetField(transformed, TransformedDir, GetField(code, dir));
+			}
+			return transformed;
+		}
+
+		// 8 通りの対称変換で移したコードのうち、最小のもの (正規形) を返す
+		inline static constexpr uint16 GetCanonical(uint16 code)
+		{
+			uint16 canonical = code;
+			for (uint8 symmetry = 1; symmetry < 8; ++symmetry)
+				canonical = std::min(canonical, Transform(code, symmetry));
+			return canonical;
+		}
+
+		// stone の手番で、コード code の中心に着手する手の重み (プレイアウトでの選ばれやすさ) を返す
+		// 自分の眼 (1 目の真眼) を潰す手は 0
+		inline static uint16 GetWeight(uint16 code, Stone stone);
+
+		// 黒番から見た、全てのコードの重みを計算する (起動時に 1 度だけ呼ばれる)
+		// 6 万通り以上のコードを総当たりするので、定数式として評価するとコンパイラの評価ステップ数の上限を越えてしまう
+		// そのため、パターンの定義だけをコンパイル時の定数とし、表は起動時に生成する
+		inline static arr<uint16, CodeCount> MakeWeights();
+
+	private:
+
+		// パターンの定義
+		// 上の行から順に 3 文字ずつで表し、中心 (2 行目の 2 文字目) が着手点
+		// X, O は石 (どちらの色にも当てはめて照合する), '.' は空き点, '?' は何でもよい,
+		// 'x' は X 以外, 'o' は O 以外, '#' は盤外
+		struct ShapeDefinition final
+		{
+			const char* rows[3];
+		};
+
+		// 着手点の周りの形として、打つ価値が高いもの (Pachi / MoGo のプレイアウト用パターンに倣う)
+		static constexpr arr<ShapeDefinition, 13> Shapes =
+		{ {
+			{ { "XOX", "...", "???" } },  // ハネ (挟むハネ)
+			{ { "XO.", "...", "?.?" } },  // ハネ (切られないハネ)
+			{ { "XO?", "X..", "x.?" } },  // ハネ (曲がり)
+			{ { "XOO", "...", "?.?" } },  // ハネ (薄いハネ)
+			{ { "XO?", "O.o", "?o?" } },  // 切り (守られていない切り)
+			{ { "XO?", "O.X", "???" } },  // 切り (覗かれた切り)
+			{ { "?X?", "O.O", "ooo" } },  // 切り (切りを防ぐ)
+			{ { ".O.", "X..", "..." } },  // 桂馬の切り
+			{ { "X.?", "O.?", "###" } },  // 辺 (追う)
+			{ { "OX?", "o.O", "###" } },  // 辺 (辺の切りを防ぐ)
+			{ { "?X?", "x.O", "###" } },  // 辺 (辺の連絡を防ぐ)
+			{ { "?XO", "x.x", "###" } },  // 辺 (下がり)
+			{ { "?OX", "X.O", "###" } },  // 辺 (切り)
+		} };
+
+		// 3x3 の行・列 (中心が (1, 1)) から、方向のインデックスを求める (中心なら -1)
+		inline static constexpr int8 GetDirection(uint8 row, uint8 column)
+		{
+			constexpr int8 Directions[3][3] = { { 4, 0, 5 }, { 2, -1, 3 }, { 6, 1, 7 } };
+			return Directions[row][column];
+		}
+
+		// パターンの 1 文字が、どの状態にマッチするかを bit で返す (bit i が立っていれば、状態 i にマッチする)
+		inline static constexpr uint8 GetAllowedMask(char c, uint8 x, uint8 o)
+		{
+			switch (c)
+			{
+			case 'X': return static_cast<uint8>(1 << x);
+			case 'O': return static_cast<uint8>(1 << o);
+			case 'x': return static_cast<uint8>(0b1111 & ~(1 << x));
+			case 'o': return static_cast<uint8>(0b1111 & ~(1 << o));
+			case '.': return 1 << 0;
+			case '#': return 1 << OffBoard;
+			default: return 0b1111;
+			}
+		}
+
+		// パターン shape を対称変換 (回転・反転) し、X を x, O を o の状態に当てはめたとき、マッチするコードに印を付ける
+		inline static void MarkShape(vec<bool>& marks, const ShapeDefinition& shape, uint8 symmetry, uint8 x, uint8 o)
+		{
+			// 方向ごとに、マッチする状態の候補を求める
+			arr<uint8, DirectionCount> allowed{};
+			for (uint8 row = 0; row < 3; ++row)
+				for (uint8 column = 0; column < 3; ++column)
+				{
+					// 対称変換後の位置 (中心からの相対座標で、転置・反転する)
+					int8 dx = static_cast<int8>(column) - 1, dy = static_cast<int8>(row) - 1;
+					if (symmetry & 0b001) { const int8 t = dx; dx = dy; dy = t; }
+					if (symmetry & 0b010) dx = -dx;
+					if (symmetry & 0b100) dy = -dy;
+
+					const int8 dir = GetDirection(static_cast<uint8>(dy + 1), static_cast<uint8>(dx + 1));
+					if (dir < 0) continue;
+					allowed[dir] = GetAllowedMask(shape.rows[row][column], x, o);
+				}
+
+			// マッチする全てのコードを列挙する (各方向の候補を、桁ごとに進める)
+			arr<uint8, DirectionCount> values{};
+			for (uint8 dir = 0; dir < DirectionCount; ++dir)
+			{
+				while (!(allowed[dir] & (1 << values[dir]))) ++values[dir];
+			}
+			while (true)
+			{
+				uint16 code = 0;
+				for (uint8 dir = 0; dir < DirectionCount; ++dir)
+					code = SetField(code, dir, values[dir]);
+				marks[code] = true;
+
+				// 次の組み合わせへ
+				uint8 dir = 0;
+				for (; dir < DirectionCount; ++dir)
+				{
+					do ++values[dir]; while (values[dir] < 4 && !(allowed[dir] & (1 << values[dir])));
+					if (values[dir] < 4) break;
+
+					// 桁上がり
+					values[dir] = 0;
+					while (!(allowed[dir] & (1 << values[dir]))) ++values[dir];
+				}
+				if (dir == DirectionCount) break;
+			}
+		}
+	};
+
+	inline arr<uint16, Pattern3x3::CodeCount> Pattern3x3::MakeWeights()
+	{
+		constexpr uint16 EmptyAreaWeight = 10;  // 周りに石が無い点
+		constexpr uint16 EmptyEdgeWeight = 4;  // 周りに石が無い、1 線の点
+		constexpr uint16 EmptyCornerWeight = 2;  // 周りに石が無い、隅の点
+		constexpr uint16 ContactWeight = 16;  // 周りに石がある点
+		constexpr uint16 NoLibertyWeight = 2;  // 上下左右が全て相手の石 (または盤外) の点. 相手の石を取る手か、打てない手
+		constexpr uint16 ShapeWeight = 96;  // パターンにマッチした点
+
+		const uint8 Black = static_cast<uint8>(Stone::Black);
+		const uint8 White = static_cast<uint8>(Stone::White);
+
+		// パターンにマッチするコードに、印を付ける
+		vec<bool> shapeMarks(CodeCount, false);
+		for (const ShapeDefinition& shape : Shapes)
+			for (uint8 symmetry = 0; symmetry < 8; ++symmetry)
+			{
+				MarkShape(shapeMarks, shape, symmetry, Black, White);
+				MarkShape(shapeMarks, shape, symmetry, White, Black);
+			}
+
+		arr<uint16, CodeCount> weights{};
+		for (autosize i = 0; i < CodeCount; ++i)
+		{
+			const uint16 code = static_cast<uint16>(i);
+
+			// 上下左右・斜めの状態を数える
+			uint8 ownCount = 0, oppoCount = 0, edgeCount = 0, diagonalOppoCount = 0, diagonalEdgeCount = 0, stoneCount = 0;
+			for (uint8 dir = 0; dir < DirectionCount; ++dir)
+			{
+				const uint8 value = GetField(code, dir);
+				const bool IsOrthogonal = dir < 4;
+				if (value == Black || value == White) ++stoneCount;
+				if (IsOrthogonal)
+				{
+					if (value == Black) ++ownCount;
+					else if (value == White) ++oppoCount;
+					else if (value == OffBoard) ++edgeCount;
+				}
+				else
+				{
+					if (value == White) ++diagonalOppoCount;
+					else if (value == OffBoard) ++diagonalEdgeCount;
+				}
+			}
+
+			// 自分の眼 (1 目の真眼) は潰さない (Board::IsEye と同じ判定)
+			if (ownCount + edgeCount == 4 && diagonalOppoCount <= (diagonalEdgeCount > 0 ? 0 : 1))
+			{
+				weights[i] = 0;
+				continue;
+			}
+
+			uint16 weight = 0;
+			if (oppoCount + edgeCount == 4) weight = NoLibertyWeight;
+			else if (stoneCount > 0) weight = ContactWeight;
+			else if (edgeCount >= 2) weight = EmptyCornerWeight;
+			else if (edgeCount == 1) weight = EmptyEdgeWeight;
+			else weight = EmptyAreaWeight;
+
+			if (shapeMarks[i] && weight < ShapeWeight) weight = ShapeWeight;
+
+			weights[i] = weight;
+		}
+		return weights;
+	}
+
+	// 黒番から見た、全てのコードの重み
+	inline const arr<uint16, Pattern3x3::CodeCount> Pattern3x3Weights = Pattern3x3::MakeWeights();
+
+	inline uint16 Pattern3x3::GetWeight(uint16 code, Stone stone)
+	{
+		return Pattern3x3Weights[stone == Stone::White ? SwapColors(code) : code];
+	}
+}
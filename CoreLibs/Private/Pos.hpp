@@ -21,9 +21,10 @@ namespace std
 	template <>
 	struct hash<Shusaku::Pos>
 	{
+		// x, y はそれぞれ 8 ビットに収まるので、並べるだけで衝突しない値になる
 		std::size_t operator()(const Shusaku::Pos& p) const noexcept
 		{
-			return (std::hash<int>()(p.x) ^ (std::hash<int>()(p.y) << 1));
+			return static_cast<std::size_t>(p.x) | (static_cast<std::size_t>(p.y) << 8);
 		}
 	};
 }
@@ -0,0 +1,98 @@
+﻿#pragma once
+
+#include "TypeAlias.hpp"
+#include "Pos.hpp"
+
+namespace Shusaku
+{
+	// 盤面の 8 通りの対称変換 (回転・反転) を扱う
+	// 変換は 3bit で表し、転置 (x と y の入れ替え, bit2) → 左右反転 (bit0) → 上下反転 (bit1) の順に適用する
+	class Symmetry final
+	{
+	public:
+
+		inline Symmetry() = delete;
+
+		static constexpr uint8 Count = 8;  // 変換の種類数
+		static constexpr uint8 Identity = 0;  // 何もしない変換
+
+		// 左上角が (0, 0), 右下角が (size - 1, size - 1) の座標系で、(x, y) を変換 symmetry で移す
+		inline static constexpr void Apply(uint8 symmetry, uint8 size, uint8& x, uint8& y)
+		{
+			if (symmetry & 4)
+			{
+				const uint8 temp = x;
+				x = y;
+				y = temp;
+			}
+			if (symmetry & 1) x = size - 1 - x;
+			if (symmetry & 2) y = size - 1 - y;
+		}
+
+		// 左上角が (0, 0), 右下角が (size - 1, size - 1) の座標系で、(x, y) を変換 symmetry の逆変換で移す
+		inline static constexpr void ApplyInverse(uint8 symmetry, uint8 size, uint8& x, uint8& y)
+		{
+			if (symmetry & 1) x = size - 1 - x;
+			if (symmetry & 2) y = size - 1 - y;
+			if (symmetry & 4)
+			{
+				const uint8 temp = x;
+				x = y;
+				y = temp;
+			}
+		}
+
+		// 左上角が (1, 1), 右下角が (size, size) の座標系で、pos を symmetryMask (bit s が立っていれば変換 s を含む) の変換で移した点のうち、
+		// 盤面のインデックスが最小のもの (代表) を返す
+		// symmetryMask が盤面を変えない変換の集合 (Board::GetSymmetryMask) なら、代表が同じ点同士は、打てばお互いに対称な盤面になる
+		inline static constexpr Pos GetRepresentative(const Pos& pos, uint8 size, uint8 symmetryMask)
+		{
+			Pos representative = pos;
+			for (uint8 symmetry = 1; symmetry < Count; ++symmetry)
+			{
+				if (!(symmetryMask & (1 << symmetry))) continue;
+
+				const Pos transformed = Transform(pos, size, symmetry);
+				if (transformed.y < representative.y || (transformed.y == representative.y && transformed.x < representative.x))
+					representative = transformed;
+			}
+			return representative;
+		}
+
+		// 左上角が (1, 1), 右下角が (size, size) の座標系で、pos を symmetryMask の変換で移した点を、さらに変換 symmetry で移した点のうち、
+		// 盤面のインデックスが最小のものを返す
+		// symmetry が盤面を正規形に移す変換 (Board::GetCanonicalHash), symmetryMask がその盤面の Board::GetSymmetryMask なら、
+		// 互いに対称な手は、どちらの向きの盤面から求めても、正規形の盤面の上で同じ点になる (定石・評価のキャッシュに手を記録するのに使う)
+		inline static constexpr Pos GetCanonicalRepresentative(const Pos& pos, uint8 size, uint8 symmetry, uint8 symmetryMask)
+		{
+			Pos representative = Transform(pos, size, symmetry);
+			for (uint8 s = 1; s < Count; ++s)
+			{
+				if (!(symmetryMask & (1 << s))) continue;
+
+				const Pos transformed = Transform(Transform(pos, size, s), size, symmetry);
+				if (transformed.y < representative.y || (transformed.y == representative.y && transformed.x < representative.x))
+					representative = transformed;
+			}
+			return representative;
+		}
+
+		// 左上角が (1, 1), 右下角が (size, size) の座標系で、pos を変換 symmetry で移す ((0, 0) (パス) はそのまま)
+		inline static constexpr Pos Transform(const Pos& pos, uint8 size, uint8 symmetry)
+		{
+			if (pos.x == 0 || pos.y == 0) return pos;
+			uint8 x = pos.x - 1, y = pos.y - 1;
+			Apply(symmetry, size, x, y);
+			return { static_cast<uint8>(x + 1), static_cast<uint8>(y + 1) };
+		}
+
+		// 左上角が (1, 1), 右下角が (size, size) の座標系で、pos を変換 symmetry の逆変換で移す ((0, 0) (パス) はそのまま)
+		inline static constexpr Pos InverseTransform(const Pos& pos, uint8 size, uint8 symmetry)
+		{
+			if (pos.x == 0 || pos.y == 0) return pos;
+			uint8 x = pos.x - 1, y = pos.y - 1;
+			ApplyInverse(symmetry, size, x, y);
+			return { static_cast<uint8>(x + 1), static_cast<uint8>(y + 1) };
+		}
+	};
+}
@@ -0,0 +1,107 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+#include "TypeAlias.hpp"
+
+namespace Shusaku
+{
+	// 決まった数のスレッドを最初に立てておき、仕事を順に割り振るスレッドプール
+	// 呼び出しのたびにスレッドを立てないので、短い仕事を何度も並列に行うのに向く
+	// 複数のスレッドから同時に ParallelFor を呼んでもよい (仕事は 1 つの待ち行列に並び、空いたスレッドから順に取る)
+	class ThreadPool final
+	{
+	public:
+
+		// threadCount 本のスレッドを立てる (0 ならハードウェアのスレッド数)
+		inline explicit ThreadPool(uint32 threadCount = 0)
+		{
+			if (threadCount == 0) threadCount = std::max<uint32>(std::thread::hardware_concurrency(), 1);
+
+			threads.reserve(threadCount);
+			for (uint32 i = 0; i < threadCount; ++i)
+				threads.emplace_back([this]() { RunWorker(); });
+		}
+
+		// 待ち行列に残っている仕事を全て終えてから、スレッドを止める
+		inline ~ThreadPool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				isStopping = true;
+			}
+			condition.notify_all();
+			for (std::thread& thread : threads)
+				thread.join();
+		}
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		inline uint32 GetThreadCount() const { return static_cast<uint32>(threads.size()); }
+
+		// func(0), func(1), ..., func(count - 1) を、プールのスレッドで並列に行い、全て終わるまで待つ
+		// 番号は前から順に、空いたスレッドが 1 つずつ取っていく
+		// プールのスレッドの中から呼ぶと、空きスレッドが無くなって終わらないことがあるので、呼ばないこと
+		inline void ParallelFor(autosize count, const std::function<void(autosize)>& func)
+		{
+			if (count == 0) return;
+
+			// 呼び出しごとの状態 (この関数が戻るまで生きている)
+			std::atomic<autosize> next = 0;
+			autosize remainingJobCount = std::min<autosize>(count, threads.size());
+			std::mutex doneMutex;
+			std::condition_variable doneCondition;
+
+			const autosize JobCount = remainingJobCount;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				for (autosize j = 0; j < JobCount; ++j)
+					jobs.emplace([&]()
+						{
+							for (autosize i = next++; i < count; i = next++)
+								func(i);
+
+							std::lock_guard<std::mutex> doneLock(doneMutex);
+							if (--remainingJobCount == 0) doneCondition.notify_one();
+						});
+			}
+			condition.notify_all();
+
+			std::unique_lock<std::mutex> doneLock(doneMutex);
+			doneCondition.wait(doneLock, [&]() { return remainingJobCount == 0; });
+		}
+
+	private:
+
+		vec<std::thread> threads;
+		std::queue<std::function<void()>> jobs;  // 待ち行列
+		std::mutex mutex;  // jobs と isStopping を守る
+		std::condition_variable condition;  // jobs に仕事が入った・止める時に知らせる
+		bool isStopping = false;
+
+		// 各スレッドの処理 (待ち行列から仕事を取っては行う)
+		inline void RunWorker()
+		{
+			while (true)
+			{
+				std::function<void()> job;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					condition.wait(lock, [this]() { return isStopping || !jobs.empty(); });
+					if (jobs.empty()) return;  // 止める時で、仕事が残っていない
+
+					job = std::move(jobs.front());
+					jobs.pop();
+				}
+				job();
+			}
+		}
+	};
+}
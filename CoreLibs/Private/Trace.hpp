@@ -0,0 +1,212 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "TypeAlias.hpp"
+
+// 処理の区間 (スコープ) の開始・終了時刻を記録する
+// SHUSAKU_TRACE を定義してビルドした時だけ記録し、定義しなければ何もしない (実行時のコストもない)
+// SHUSAKU_TRACE を 2 以上にすると、Board::PutStone のような、1 回が短く回数の多い区間も記録する (TRACE_SCOPE_DETAIL)
+// name は文字列リテラルにすること (ポインタのまま記録する)
+#ifdef SHUSAKU_TRACE
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) const ::Shusaku::Trace::Scope TRACE_CONCAT(traceScope, __LINE__)(name)
+#if SHUSAKU_TRACE + 0 >= 2
+#define TRACE_SCOPE_DETAIL(name) TRACE_SCOPE(name)
+#else
+#define TRACE_SCOPE_DETAIL(name) ((void)0)
+#endif
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_SCOPE_DETAIL(name) ((void)0)
+#endif
+
+// スレッドごとのリングバッファに記録できる区間の数 (古いものから上書きされる)
+#ifndef SHUSAKU_TRACE_CAPACITY
+#define SHUSAKU_TRACE_CAPACITY (1 << 18)
+#endif
+
+namespace Shusaku
+{
+	// TRACE_SCOPE で記録した区間を、スレッドごとに集め、Chrome のトレース形式 (JSON) で書き出す
+	// 書き出したファイルは、Perfetto (ui.perfetto.dev) や chrome://tracing で、スレッドごとのタイムラインとして開ける
+	// 記録はスレッドごとのバッファに書くだけなので、スレッド間で競合しない
+	// 探索は 1 ラウンドごとにスレッドを立て直すので、終了したスレッドのバッファは、次に立てたスレッドが引き継ぐ (同じ行に並ぶ)
+	// fork したワーカープロセスの記録は、そのプロセスの中にしか残らない
+	class Trace final
+	{
+	public:
+
+		// 記録を行うビルドかどうか
+#ifdef SHUSAKU_TRACE
+		static constexpr bool IsEnabled = true;
+#else
+		static constexpr bool IsEnabled = false;
+#endif
+
+		static constexpr autosize Capacity = SHUSAKU_TRACE_CAPACITY;
+
+		inline Trace() = delete;
+
+		// 作られてから破棄されるまでの区間を、呼び出したスレッドのバッファに記録する
+		class Scope final
+		{
+		public:
+
+			inline explicit Scope(const char* name) : name(name), begin(GetNanoseconds()) {}
+			inline ~Scope() { GetThreadBuffer().Push(name, begin, GetNanoseconds()); }
+
+			Scope(const Scope&) = delete;
+			Scope& operator=(const Scope&) = delete;
+
+		private:
+
+			const char* name;
+			int64 begin;
+		};
+
+		// これまでに記録した区間を、path に Chrome のトレース形式 (JSON) で書き出す
+		// 書き出せなかったら false を返す
+		// 記録中のスレッドがあると、その途中の区間が欠けたり混ざったりするので、探索の止まっている間に呼ぶこと
+		static inline bool Write(const str& path)
+		{
+			std::ofstream ofs(path, std::ios::out | std::ios::trunc);
+			if (!ofs) return false;
+
+			ofs << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+			bool first = true;
+			{
+				Registry& registry = GetRegistry();
+				std::lock_guard<std::mutex> lock(registry.mutex);
+				for (const std::unique_ptr<Buffer>& Held : registry.buffers)
+				{
+					// バッファが一周していたら、残っている古い方から並べる
+					const uint64 Count = Held->count.load(std::memory_order_acquire);
+					for (uint64 i = Count > Capacity ? Count - Capacity : 0; i < Count; ++i)
+					{
+						const Event& Recorded = Held->events[i % Capacity];
+						if (first) first = false;
+						else ofs << ",";
+
+						// 時刻の単位はマイクロ秒
+						const int64 Duration = Recorded.end - Recorded.begin;
+						ofs << "\n{\"name\":\"" << Recorded.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << Held->threadIdx
+							<< ",\"ts\":" << Recorded.begin / 1000 << "." << FormatFraction(Recorded.begin % 1000)
+							<< ",\"dur\":" << Duration / 1000 << "." << FormatFraction(Duration % 1000) << "}";
+					}
+				}
+			}
+			ofs << "\n]}\n";
+
+			return static_cast<bool>(ofs);
+		}
+
+		// これまでに記録した区間を、全て捨てる
+		// Write と同じく、探索の止まっている間に呼ぶこと
+		static inline void Clear()
+		{
+			Registry& registry = GetRegistry();
+			std::lock_guard<std::mutex> lock(registry.mutex);
+			for (const std::unique_ptr<Buffer>& Held : registry.buffers)
+				Held->count.store(0, std::memory_order_release);
+		}
+
+	private:
+
+		// 記録した 1 つの区間 (時刻は、最初に記録した時からのナノ秒)
+		struct Event final
+		{
+			const char* name;
+			int64 begin;
+			int64 end;
+		};
+
+		// 1 つのスレッドが記録していくリングバッファ
+		struct Buffer final
+		{
+			inline explicit Buffer(uint32 threadIdx) : events(Capacity), threadIdx(threadIdx) {}
+
+			inline void Push(const char* name, int64 begin, int64 end)
+			{
+				const uint64 Idx = count.load(std::memory_order_relaxed);
+				events[Idx % Capacity] = { name, begin, end };
+				count.store(Idx + 1, std::memory_order_release);
+			}
+
+			vec<Event> events;
+			std::atomic<uint64> count = 0;  // これまでに記録した区間の数 (Capacity を超えたら、古いものから上書きされている)
+			uint32 threadIdx;  // トレース上のスレッドの番号
+		};
+
+		// 全てのスレッドのバッファ (プロセスの終了まで破棄しない)
+		struct Registry final
+		{
+			std::mutex mutex;
+			vec<std::unique_ptr<Buffer>> buffers;
+			vec<Buffer*> freeBuffers;  // 終了したスレッドが使っていたもの
+		};
+
+		// スレッドが終了する時に、バッファを返す
+		struct ThreadSlot final
+		{
+			inline ThreadSlot()
+			{
+				Registry& registry = GetRegistry();
+				std::lock_guard<std::mutex> lock(registry.mutex);
+				if (registry.freeBuffers.empty())
+				{
+					const uint32 ThreadIdx = static_cast<uint32>(registry.buffers.size()) + 1;
+					registry.buffers.push_back(std::make_unique<Buffer>(ThreadIdx));
+					buffer = registry.buffers.back().get();
+				}
+				else
+				{
+					buffer = registry.freeBuffers.back();
+					registry.freeBuffers.pop_back();
+				}
+			}
+
+			inline ~ThreadSlot()
+			{
+				Registry& registry = GetRegistry();
+				std::lock_guard<std::mutex> lock(registry.mutex);
+				registry.freeBuffers.push_back(buffer);
+			}
+
+			Buffer* buffer;
+		};
+
+		static inline Registry& GetRegistry()
+		{
+			// スレッドの終了時 (ThreadSlot の破棄) より先に破棄されないように、解放しない
+			static Registry* registry = new Registry();
+			return *registry;
+		}
+
+		static inline Buffer& GetThreadBuffer()
+		{
+			thread_local ThreadSlot slot;
+			return *slot.buffer;
+		}
+
+		static inline int64 GetNanoseconds()
+		{
+			static const std::chrono::steady_clock::time_point Origin = std::chrono::steady_clock::now();
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - Origin).count();
+		}
+
+		// 0 ~ 999 を、3 桁の 0 埋めの文字列にする
+		static inline str FormatFraction(int64 value)
+		{
+			str text = std::to_string(value);
+			return str(3 - std::min<autosize>(text.size(), 3), '0') + text;
+		}
+	};
+}
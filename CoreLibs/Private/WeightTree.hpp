@@ -0,0 +1,69 @@
+﻿#pragma once
+
+#include <vector>
+#include "TypeAlias.hpp"
+
+namespace Shusaku
+{
+	// 重みに比例した抽選を行うための、累積和の木 (Fenwick tree)
+	// 要素の重みの更新と、重みに比例した要素の抽選を、どちらも O(log N) で行う
+	class WeightTree final
+	{
+	public:
+
+		inline WeightTree() = default;
+		inline explicit WeightTree(autosize count) { Reset(count); }
+
+		// 要素数を count にして、全ての重みを 0 にする
+		inline void Reset(autosize count)
+		{
+			weights.assign(count, 0);
+			tree.assign(count + 1, 0);
+			total = 0;
+
+			// 抽選の二分探索で使う、要素数以下の最大の 2 のべき乗
+			topBit = 1;
+			while ((topBit << 1) <= count) topBit <<= 1;
+		}
+
+		inline autosize GetCount() const { return weights.size(); }
+		inline uint32 GetWeight(autosize idx) const { return weights[idx]; }
+		inline uint64 GetTotal() const { return total; }
+
+		// idx 番目の要素の重みを weight にする
+		inline void Set(autosize idx, uint32 weight)
+		{
+			const int64 Delta = static_cast<int64>(weight) - static_cast<int64>(weights[idx]);
+			if (Delta == 0) return;
+
+			weights[idx] = weight;
+			total += Delta;
+			for (autosize i = idx + 1; i < tree.size(); i += i & (~i + 1))
+				tree[i] += Delta;
+		}
+
+		// value (0 <= value < GetTotal()) に対して、重みの累積和が value を越える最初の要素のインデックスを返す
+		// value を一様乱数にすれば、重みに比例した抽選になる
+		inline autosize Find(uint64 value) const
+		{
+			autosize idx = 0;
+			for (autosize bit = topBit; bit > 0; bit >>= 1)
+			{
+				const autosize next = idx + bit;
+				if (next < tree.size() && static_cast<uint64>(tree[next]) <= value)
+				{
+					idx = next;
+					value -= tree[next];
+				}
+			}
+			return idx;  // tree のインデックスは 1 始まりなので、そのまま要素のインデックスになる
+		}
+
+	private:
+
+		vec<uint32> weights;  // 各要素の重み
+		vec<int64> tree;  // 累積和の木 (1 始まり)
+		uint64 total = 0;  // 重みの合計
+		autosize topBit = 1;
+	};
+}
@@ -0,0 +1,56 @@
+﻿#pragma once
+
+#include <array>
+#include "TypeAlias.hpp"
+#include "StoneEnum.hpp"
+
+namespace Shusaku
+{
+	// 盤面のハッシュ値 (Zobrist hashing) に使う乱数表
+	// 各点・各色に 64bit の乱数を割り当て、盤上の石の乱数を全て XOR したものを、盤面のハッシュ値とする
+	// 石を置く・取るたびに、その点の乱数を XOR するだけで、差分で更新できる
+	// ファイル (定石など) に保存して使うので、乱数は固定の種から生成し、実行ごとに変わらないようにする
+	class Zobrist final
+	{
+	public:
+
+		inline Zobrist() = delete;
+
+		static constexpr autosize MaxPositionsCount = 19 * 19;  // 対応する最大の交点数
+		static constexpr autosize KeyCount = MaxPositionsCount * 2 + 1;  // 各点の黒・白と、手番の分
+
+		// 点 idx (盤面のインデックス) に stone (黒か白) があることを表す乱数
+		inline static uint64 GetStoneKey(autosize idx, Stone stone);
+
+		// 白番であることを表す乱数 (手番を区別したいときに、ハッシュ値に XOR する)
+		inline static uint64 GetWhiteTurnKey();
+
+		// 固定の種から、乱数表を生成する (SplitMix64)
+		inline static constexpr arr<uint64, KeyCount> MakeKeys()
+		{
+			arr<uint64, KeyCount> keys{};
+			uint64 state = 0x53687573616B75ull;  // "Shusaku"
+			for (uint64& key : keys)
+			{
+				state += 0x9E3779B97F4A7C15ull;
+				uint64 z = state;
+				z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+				z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+				key = z ^ (z >> 31);
+			}
+			return keys;
+		}
+	};
+
+	inline constexpr arr<uint64, Zobrist::KeyCount> ZobristKeys = Zobrist::MakeKeys();
+
+	inline uint64 Zobrist::GetStoneKey(autosize idx, Stone stone)
+	{
+		return ZobristKeys[(idx << 1) + (stone == Stone::White ? 1 : 0)];
+	}
+
+	inline uint64 Zobrist::GetWhiteTurnKey()
+	{
+		return ZobristKeys[KeyCount - 1];
+	}
+}
@@ -1,13 +1,15 @@
 ﻿#pragma once
 
-#include <opencv2/opencv.hpp>
-
 #include <iostream>
+#include <iomanip>
 #include <fstream>
 #include <filesystem>
 #include <array>
 #include <vector>
 #include <tuple>
+#include <optional>
+#include <memory>
+#include <map>
 #include <unordered_map>
 #include <unordered_set>
 #include <queue>
@@ -19,10 +21,14 @@
 #include <random>
 #include <algorithm>
 #include <cstring>
+#include <bit>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #include <future>
+#include <atomic>
 #include <chrono>
+#include <charconv>
 
 #include "../Private/TypeAlias.hpp"
 #include "../Private/MacroDefine.hpp"
@@ -32,4 +38,13 @@
 #include "../Private/PosStone.hpp"
 #include "../Private/Math.hpp"
 #include "../Private/Rand.hpp"
+#include "../Private/WeightTree.hpp"
+#include "../Private/Arena.hpp"
+#include "../Private/Pattern3x3.hpp"
+#include "../Private/Zobrist.hpp"
+#include "../Private/Symmetry.hpp"
+#include "../Private/MappedFile.hpp"
+#include "../Private/CpuAffinity.hpp"
+#include "../Private/ThreadPool.hpp"
+#include "../Private/Trace.hpp"
 #include "../Private/Board.hpp"
@@ -1,6 +1,6 @@
 ﻿#include <Main.hpp>
 
-int main()
+int main(int argc, char** argv)
 {
-	return Main();
+	return Main(argc, argv);
 }
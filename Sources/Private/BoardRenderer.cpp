@@ -0,0 +1,291 @@
+﻿#include <BoardRenderer.hpp>
+
+using namespace Shusaku;
+
+static vec<Pos> GetStarPositions(BoardSize boardSize);
+
+static constexpr uint8 StoneMargin = 4;  // 石の余白 (px)
+
+static const cv::Scalar BoardColor = { 63, 194, 253 };  // 盤面の背景色 (BGR)
+static const cv::Scalar FrameColor = { 43, 56, 59 };  // 盤面の枠線の色 (BGR)
+static const cv::Scalar StarColor = FrameColor;  // 星の色 (BGR)
+static const cv::Scalar BlackStoneColor = { 0, 0, 0 };  // 黒石の色 (BGR)
+static const cv::Scalar WhiteStoneColor = { 255, 255, 255 };  // 白石の色 (BGR)
+static const cv::Scalar StoneOutlineColor = { 0, 0, 255 };  // 石のアウトラインの色 (赤) (BGR)
+static const cv::Scalar BlackStoneTextColor = WhiteStoneColor;  // 黒石の上に描画する手番の数字の色 (BGR)
+static const cv::Scalar WhiteStoneTextColor = BlackStoneColor;  // 白石の上に描画する手番の数字の色 (BGR)
+
+const cv::Mat& BoardRenderer::Render(const Board& board, bool bWithHistory)
+{
+	const uint8 LineCount = board.GetSize();
+	const uint16 PositionsCount = board.GetPositionsCount();
+
+	// 盤面の大きさが変わったら、背景から描き直す
+	if (assets == nullptr || boardSize != board.GetBoardSize())
+	{
+		boardSize = board.GetBoardSize();
+		assets = &GetAssets(boardSize);
+		cellStates.clear();
+	}
+	if (cellStates.empty())
+	{
+		assets->background.copyTo(frame);
+		cellStates.assign(PositionsCount, CellState{});
+	}
+
+	const vec<PosStone>& History = board.GetHistory();
+
+	// 各点の手番の数字 (その点に最後に着手した手番) を求める
+	// この時、盤面のデータと棋譜のデータが一致している前提で処理を行う
+	// 同じ場所に複数回着手してある可能性があるため、棋譜を前から読み取って上書きしていく
+	numbers.assign(PositionsCount, 0);
+	if (bWithHistory)
+	{
+		for (autosize i = 0; i < History.size(); ++i)
+		{
+			const Pos& pos = History[i].pos;
+			if (pos.x < 1 || LineCount < pos.x || pos.y < 1 || LineCount < pos.y) continue;  // パス
+			numbers[(pos.x - 1) + (pos.y - 1) * LineCount] = static_cast<uint16>(std::min<autosize>(i + 1, MAX_uint16));
+		}
+	}
+
+	// 最新の着手 (石を赤いアウトラインで囲む)
+	sautosize latestIdx = -1;
+	if (!History.empty())
+	{
+		const PosStone& LatestPut = History.back();
+		if (LatestPut.stone != Stone::Empty && 1 <= LatestPut.pos.x && LatestPut.pos.x <= LineCount && 1 <= LatestPut.pos.y && LatestPut.pos.y <= LineCount)
+			latestIdx = (LatestPut.pos.x - 1) + (LatestPut.pos.y - 1) * LineCount;
+	}
+
+	// 前回から状態が変わった点だけ、描き直す
+	for (uint8 y = 1; y <= LineCount; ++y)
+		for (uint8 x = 1; x <= LineCount; ++x)
+		{
+			const autosize Idx = (x - 1) + (y - 1) * LineCount;
+
+			CellState state;
+			state.stone = board.GetStone(x, y);
+			if (state.stone != Stone::Empty)
+			{
+				// (石が取られていたせいで) 空き点になっている場所には、数字もアウトラインも描画しない
+				// 棋譜から読み取るのではなく、石の座標で判断している点に注意!
+				state.number = numbers[Idx];
+				state.isLatest = static_cast<sautosize>(Idx) == latestIdx;
+			}
+
+			if (state == cellStates[Idx]) continue;
+
+			DrawCell(x, y, state);
+			cellStates[Idx] = state;
+		}
+
+	return frame;
+}
+
+void BoardRenderer::Invalidate()
+{
+	cellStates.clear();
+}
+
+void BoardRenderer::GetLayout(uint8 lineCount, uint8& outCellSize, uint8& outMargin)
+{
+	constexpr uint8 MaxMargin = 50;  // 盤面の外側の余白の大きさ 最大値 (px)
+
+	outCellSize = static_cast<uint8>(std::ceil(1.0 * (ImageSize - (MaxMargin << 1)) / (lineCount - 1)));  // 1マスのサイズ 切り上げ (px)
+	const uint16 ImageBoardSize = outCellSize * (lineCount - 1);  // 盤面のサイズ (px)
+	outMargin = (ImageSize - ImageBoardSize) >> 1;  // 盤面の外側の余白の大きさ (px)
+}
+
+const BoardRenderer::Assets& BoardRenderer::GetAssets(BoardSize boardSize)
+{
+	// 一度描いた画像は消さないので、返した参照は最後まで有効
+	static std::mutex mutex;
+	static std::map<BoardSize, Assets> assetsBySize;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = assetsBySize.find(boardSize);
+	if (it == assetsBySize.end())
+	{
+		it = assetsBySize.emplace(boardSize, Assets{}).first;
+		CreateAssets(boardSize, it->second);
+	}
+	return it->second;
+}
+
+void BoardRenderer::CreateAssets(BoardSize boardSize, Assets& outAssets)
+{
+	constexpr uint8 LineWidth = 1;  // 線の太さ (px)
+	constexpr uint8 StarRadius = 4;  // 星の半径 (px)
+
+	const uint8 LineCount = Board::Create(boardSize).GetSize();  // 盤面のサイズ (9x9, 19x19など)
+	uint8 CellSize, Margin;  // 1マスのサイズ, 盤面の外側の余白の大きさ (px)
+	GetLayout(LineCount, CellSize, Margin);
+	const uint16 ImageBoardSize = CellSize * (LineCount - 1);  // 盤面のサイズ (px)
+
+	const uint16 StoneRadius = (CellSize - StoneMargin) >> 1;  // 石の半径 (px)
+	const uint8 StoneOutlineWidth = StoneRadius * 0.15;  // 石のアウトラインの太さ (px)
+
+	outAssets.cellSize = CellSize;
+	outAssets.margin = Margin;
+	outAssets.stoneRadius = StoneRadius;
+
+	// 背景
+	{
+		cv::Mat& image = outAssets.background;
+
+		// 画像の初期化、背景を設定
+		image = cv::Mat(ImageSize, ImageSize, CV_8UC3, BoardColor);
+
+		// 盤面の枠線を描画
+		for (uint8 i = 0; i < LineCount; ++i)
+		{
+			// 画像端からの位置
+			const uint16 pos = Margin + i * CellSize;
+
+			// 横線の描画
+			cv::line(image,
+				cv::Point(Margin, pos),
+				cv::Point(Margin + ImageBoardSize, pos),
+				FrameColor, LineWidth);
+			// 縦線の描画
+			cv::line(image,
+				cv::Point(pos, Margin),
+				cv::Point(pos, Margin + ImageBoardSize),
+				FrameColor, LineWidth);
+		}
+
+		// 星を描画
+		const vec<Pos> StarPositions = GetStarPositions(boardSize);
+		for (const Pos& pos : StarPositions)
+		{
+			// 画像端からの位置
+			const uint16 PosX = Margin + (pos.x - 1) * CellSize;
+			const uint16 PosY = Margin + (pos.y - 1) * CellSize;
+			cv::circle(image, cv::Point(PosX, PosY), StarRadius, StarColor, cv::FILLED, cv::LINE_AA);
+		}
+	}
+
+	// 石 (1 マス分. 中心が交点になる)
+	// 不透明度は、アンチエイリアスをかけた円として描き、貼るときに背景と混ぜる
+	const cv::Point Center(CellSize >> 1, CellSize >> 1);
+	for (uint8 isLatest = 0; isLatest < 2; ++isLatest)
+		for (const Stone stone : { Stone::Black, Stone::White })
+		{
+			const uint8 Idx = GetSpriteIndex(stone, isLatest);
+			const cv::Scalar& StoneColor = stone == Stone::Black ? BlackStoneColor : WhiteStoneColor;
+			cv::Mat& color = outAssets.spriteColors[Idx];
+			cv::Mat& alpha = outAssets.spriteAlphas[Idx];
+
+			alpha = cv::Mat::zeros(CellSize, CellSize, CV_8UC1);
+			if (isLatest)
+			{
+				// 最新の着手の石は、アウトラインの分、半径を小さくする
+				const uint16 Radius = StoneRadius - (StoneOutlineWidth - (StoneMargin >> 1));
+
+				color = cv::Mat(CellSize, CellSize, CV_8UC3, StoneOutlineColor);
+				cv::circle(color, Center, Radius, StoneColor, cv::FILLED, cv::LINE_AA);
+				cv::circle(alpha, Center, StoneRadius + (StoneMargin >> 1), cv::Scalar(255), cv::FILLED, cv::LINE_AA);
+			}
+			else
+			{
+				color = cv::Mat(CellSize, CellSize, CV_8UC3, StoneColor);
+				cv::circle(alpha, Center, StoneRadius, cv::Scalar(255), cv::FILLED, cv::LINE_AA);
+			}
+		}
+}
+
+void BoardRenderer::DrawCell(uint8 x, uint8 y, const CellState& state)
+{
+	const uint8 CellSize = assets->cellSize;
+	const uint16 HalfCellSize = CellSize >> 1;
+
+	// (x, y) を中心とする 1 マス分の範囲 (隣の点の範囲とは重ならない)
+	const cv::Rect CellRect(assets->margin + (x - 1) * CellSize - HalfCellSize, assets->margin + (y - 1) * CellSize - HalfCellSize, CellSize, CellSize);
+	cv::Mat cell = frame(CellRect);
+	const cv::Mat background = assets->background(CellRect);
+
+	if (state.stone == Stone::Empty)
+	{
+		background.copyTo(cell);
+		return;
+	}
+
+	// 背景に、石の画像を不透明度に応じて混ぜて貼る
+	const uint8 SpriteIdx = GetSpriteIndex(state.stone, state.isLatest);
+	const cv::Mat& SpriteColor = assets->spriteColors[SpriteIdx];
+	const cv::Mat& SpriteAlpha = assets->spriteAlphas[SpriteIdx];
+	for (int32 row = 0; row < CellSize; ++row)
+	{
+		const uint8* bg = background.ptr<uint8>(row);
+		const uint8* color = SpriteColor.ptr<uint8>(row);
+		const uint8* alpha = SpriteAlpha.ptr<uint8>(row);
+		uint8* dst = cell.ptr<uint8>(row);
+		for (int32 col = 0; col < CellSize; ++col)
+		{
+			const uint16 A = alpha[col];
+			for (uint8 ch = 0; ch < 3; ++ch)
+			{
+				const int32 i = col * 3 + ch;
+				dst[i] = static_cast<uint8>((bg[i] * (255 - A) + color[i] * A + 127) / 255);
+			}
+		}
+	}
+
+	// 石の上に、手番の数字を描画する
+	if (state.number != 0)
+	{
+		// APIの型と合わせる
+		constexpr int FontFace = cv::FONT_HERSHEY_SIMPLEX;
+		constexpr double FontScaleMultiplier = 0.03;  // フォントサイズを、石の半径の何倍にするか
+		constexpr double ThicknessMultiplier = 0.06;  // フォントの太さを、石の半径の何倍にするか
+
+		const uint16 StoneRadius = assets->stoneRadius;
+		const double FontScale = StoneRadius * FontScaleMultiplier;  // フォントサイズ (px)
+		const int Thickness = static_cast<int>(std::floor(StoneRadius * ThicknessMultiplier));  // フォントの太さ 切り捨て (px)
+
+		// 手番の数字の色を決定
+		const cv::Scalar& TextColor = state.stone == Stone::Black ? BlackStoneTextColor : WhiteStoneTextColor;
+
+		// テキストの位置を決定 (中央揃え)
+		const str NumberText = std::to_string(state.number);
+		const cv::Size TextSize = cv::getTextSize(NumberText, FontFace, FontScale, Thickness, nullptr);
+		const cv::Point TextPos(HalfCellSize - (TextSize.width >> 1), HalfCellSize + (TextSize.height >> 1));
+
+		// テキストを描画 (マスの外にはみ出た分は描画されない)
+		cv::putText(cell, NumberText, TextPos, FontFace, FontScale, TextColor, Thickness, cv::LINE_AA);
+	}
+}
+
+// 左上角が (1, 1), 右下角が (size, size) の座標系
+vec<Pos> GetStarPositions(BoardSize boardSize)
+{
+	if (boardSize == BoardSize::_9x9)
+	{
+		return
+		{
+			{ 3, 3 }, { 7, 3 },
+			{ 3, 7 }, { 7, 7 },
+		};
+	}
+	else if (boardSize == BoardSize::_13x13)
+	{
+		return
+		{
+			{ 4, 4 }, { 7, 4 }, { 10, 4 },
+			{ 4, 7 }, { 7, 7 }, { 10, 7 },
+			{ 4, 10 }, { 7, 10 }, { 10, 10 },
+		};
+	}
+	else if (boardSize == BoardSize::_19x19)
+	{
+		return
+		{
+			{ 4, 4 }, { 10, 4 }, { 16, 4 },
+			{ 4, 10 }, { 10, 10 }, { 16, 10 },
+			{ 4, 16 }, { 10, 16 }, { 16, 16 },
+		};
+	}
+	else
+		return {};
+}
@@ -0,0 +1,168 @@
+﻿#include <EndgameSolver.hpp>
+#include <Simulator.hpp>
+
+using namespace Shusaku;
+
+// 置換表の 1 エントリ
+struct TableEntry final
+{
+	// 値が、探索窓の中で確定したものか、上限・下限でしかないか
+	enum class Bound : uint8 { None, Exact, Lower, Upper };
+
+	uint64 key = 0;
+	int16 value = 0;
+	uint16 depth = 0;  // この値を求めたときの、残りの手数
+	Bound bound = Bound::None;
+	Pos bestPos;  // 最善手 ((0, 0) ならパス)
+};
+
+// 1 回の読み切りで使う状態
+struct SolverContext final
+{
+	std::chrono::steady_clock::time_point deadline;
+	uint64 nodeCount = 0;
+	bool isAborted = false;
+	vec<TableEntry> table;
+};
+
+static int32 Negamax(Stone turn, const Board& board, bool passed, int32 alpha, int32 beta, uint16 depth, SolverContext& context, Pos* outBestPos = nullptr);
+static int32 Evaluate(Stone turn, const Board& board);
+static uint64 GetKey(Stone turn, const Board& board, bool passed);
+
+bool EndgameSolver::Solve(Stone stone, const Board& board, uint32 timeLimit, Pos& outPos, int32* outResult)
+{
+	// 読む手数の上限は、空き点の数に応じて決める (石を取ると空き点が増えるので、余裕を持たせる)
+	autosize emptyCount = 0;
+	for (const Stone s : board.GetBoard())
+		if (s == Stone::Empty) ++emptyCount;
+	const uint16 MaxDepth = static_cast<uint16>(std::min<autosize>(emptyCount * 3 + 2, MAX_uint16));
+
+	SolverContext context;
+	context.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeLimit);
+	context.table.resize(TableSize);
+
+	// 勝ち負けだけを求めるので、0 の周りの幅のない窓で読む (返る値は、符号だけが正しい)
+	Pos bestPos = { 0, 0 };
+	const int32 Score = Negamax(stone, board, false, -1, 1, MaxDepth, context, &bestPos);
+	if (context.isAborted) return false;
+
+	outPos = bestPos;
+	if (outResult) *outResult = Score > 0 ? 1 : Score < 0 ? -1 : 0;
+	return true;
+}
+
+// turn の手番で board を読み、turn から見た点数の差を返す (passed は、直前の手がパスだったか)
+// 値が (alpha, beta) の外なら、返すのは値の上限・下限でしかない
+// outBestPos が nullptr でないなら、最善手を格納する
+int32 Negamax(Stone turn, const Board& board, bool passed, int32 alpha, int32 beta, uint16 depth, SolverContext& context, Pos* outBestPos)
+{
+	// 時間切れを、一定のノード数ごとに確かめる
+	constexpr uint64 TimeCheckInterval = 1024;
+	if (++context.nodeCount % TimeCheckInterval == 0 && std::chrono::steady_clock::now() > context.deadline)
+		context.isAborted = true;
+	if (context.isAborted) return 0;
+
+	if (depth == 0) return Evaluate(turn, board);
+
+	// 置換表を引く
+	const uint64 Key = GetKey(turn, board, passed);
+	TableEntry& entry = context.table[Key & (EndgameSolver::TableSize - 1)];
+	Pos tableBestPos = { 0, 0 };
+	bool hasTableBestPos = false;
+	if (entry.key == Key && entry.bound != TableEntry::Bound::None)
+	{
+		tableBestPos = entry.bestPos;
+		hasTableBestPos = true;
+
+		// 根では、最善手を返す必要があるので、値だけでは打ち切らない
+		if (!outBestPos && entry.depth >= depth)
+		{
+			if (entry.bound == TableEntry::Bound::Exact) return entry.value;
+			if (entry.bound == TableEntry::Bound::Lower && entry.value >= beta) return entry.value;
+			if (entry.bound == TableEntry::Bound::Upper && entry.value <= alpha) return entry.value;
+		}
+	}
+
+	// 候補手を並べる (置換表の最善手 → パス → 空き点 の順)
+	// 終盤では、既に勝敗が決まっていることが多いので、パスを先に読むと、早く打ち切れる
+	// 自分の眼 (1 目の真眼) を潰す手は読まない (EndgameSolver を参照)
+	const uint8 Size = board.GetSize();
+	vec<Pos> moves;
+	moves.reserve(static_cast<autosize>(board.GetPositionsCount()) + 1);
+	if (hasTableBestPos) moves.push_back(tableBestPos);
+	if (!hasTableBestPos || tableBestPos != Pos(0, 0)) moves.emplace_back(0, 0);
+	for (uint8 y = 1; y <= Size; ++y)
+		for (uint8 x = 1; x <= Size; ++x)
+		{
+			if (hasTableBestPos && tableBestPos == Pos(x, y)) continue;
+			if (!board.IsLegal(x, y, turn) || board.IsEye(x, y, turn)) continue;
+			moves.emplace_back(x, y);
+		}
+
+	const Stone OppoStone = ReverseStone(turn);
+	const int32 AlphaOrigin = alpha;
+	int32 bestValue = -MAX_int16;
+	Pos bestPos = { 0, 0 };
+
+	Board child = board;
+	for (const Pos& move : moves)
+	{
+		int32 value;
+		if (move == Pos(0, 0))
+		{
+			// 双方がパスしたら終局
+			value = passed ? Evaluate(turn, board) : -Negamax(OppoStone, board, true, -beta, -alpha, depth - 1, context);
+		}
+		else
+		{
+			child = board;
+			if (!child.PutStone(move, turn)) continue;
+			value = -Negamax(OppoStone, child, false, -beta, -alpha, depth - 1, context);
+		}
+		if (context.isAborted) return 0;
+
+		if (value > bestValue)
+		{
+			bestValue = value;
+			bestPos = move;
+		}
+		alpha = std::max(alpha, value);
+		if (alpha >= beta) break;
+	}
+
+	// 置換表に記録する
+	entry.key = Key;
+	entry.value = static_cast<int16>(bestValue);
+	entry.depth = depth;
+	entry.bestPos = bestPos;
+	entry.bound =
+		bestValue <= AlphaOrigin ? TableEntry::Bound::Upper :
+		bestValue >= beta ? TableEntry::Bound::Lower : TableEntry::Bound::Exact;
+
+	if (outBestPos) *outBestPos = bestPos;
+	return bestValue;
+}
+
+// 盤面をそのまま数えた、turn から見た点数の差
+int32 Evaluate(Stone turn, const Board& board)
+{
+	const int32 Score = Simulator::GetScore(board);
+	return turn == Stone::Black ? Score : -Score;
+}
+
+// 置換表のキー (盤面のハッシュ値に、手番と、直前の手がパスだったかと、コウの状態を加える)
+// 同じ盤面でも、コウの点に打てるかどうかで結果が変わるので、コウの点と、そこに打てない手番も区別する
+uint64 GetKey(Stone turn, const Board& board, bool passed)
+{
+	constexpr uint64 PassedKey = 0x2545F4914F6CDD1Dull;
+	constexpr uint64 KoKeyMultiplier = 0x9E3779B97F4A7C15ull;  // 奇数なので、(コウの点, 手番) ごとに異なる値になる
+
+	uint64 koKey = 0;
+	if (board.GetKoStone() != Stone::Empty)
+	{
+		const Pos& KoPos = board.GetKoPos();
+		const uint64 KoIdx = (KoPos.x - 1) + static_cast<uint64>(KoPos.y - 1) * board.GetSize();
+		koKey = (KoIdx * 2 + (board.GetKoStone() == Stone::White ? 1 : 0) + 1) * KoKeyMultiplier;
+	}
+	return board.GetHash() ^ (turn == Stone::White ? Zobrist::GetWhiteTurnKey() : 0) ^ (passed ? PassedKey : 0) ^ koKey;
+}
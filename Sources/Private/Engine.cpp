@@ -0,0 +1,64 @@
+﻿#include <Engine.hpp>
+#include <Simulator.hpp>
+
+using namespace Shusaku;
+
+static SimulatorOptions CreatePositionOptions(const SimulatorOptions& options);
+
+Engine::Engine(const SimulatorOptions& options, uint32 workerCount)
+	: options(CreatePositionOptions(options))
+	, pool(workerCount > 0 ? workerCount : Simulator::GetThreadCount(options))
+{
+}
+
+vec<EngineResult> Engine::Evaluate(const vec<EngineRequest>& requests)
+{
+	TRACE_SCOPE("Engine::Evaluate");
+
+	vec<EngineResult> results(requests.size());
+	pool.ParallelFor(requests.size(),
+		[&](autosize i)
+		{
+			results[i] = EvaluateOnCurrentThread(requests[i]);
+		});
+	return results;
+}
+
+EngineResult Engine::Evaluate(const EngineRequest& request)
+{
+	EngineResult result;
+	pool.ParallelFor(1, [&](autosize) { result = EvaluateOnCurrentThread(request); });
+	return result;
+}
+
+EngineResult Engine::EvaluateOnCurrentThread(const EngineRequest& request) const
+{
+	TRACE_SCOPE("Engine::Position");
+
+	EngineResult result;
+
+	// 局面を作る
+	Board board = Board::Create(request.boardSize);
+	for (const PosStone& Move : request.history)
+		if (!board.PutStone(Move.pos, Move.stone))
+			return result;
+	result.isValid = true;
+
+	SimulatorOptions positionOptions = options;
+	if (request.thinkCount > 0) positionOptions.thinkCount = request.thinkCount;
+
+	result.bestPos = Simulator::Think(request.stone, board, positionOptions, &result.winRate, request.withOwnership ? &result.ownership : nullptr);
+	return result;
+}
+
+// 局面ごとの設定を作る
+// 1 つの局面の探索は、プールのスレッド 1 本で行う (Simulator::Search はスレッドを立てずに、そのスレッドで試行する)
+// 予算の既定値は、元の設定のスレッド数で決まるもの (Simulator::GetThinkCount) のままにする
+SimulatorOptions CreatePositionOptions(const SimulatorOptions& options)
+{
+	SimulatorOptions positionOptions = options;
+	positionOptions.thinkCount = Simulator::GetThinkCount(options);
+	positionOptions.threadCount = 1;
+	positionOptions.cpus.clear();
+	return positionOptions;
+}
@@ -0,0 +1,243 @@
+﻿#include <EngineConfig.hpp>
+
+using namespace Shusaku;
+
+static bool Apply(const str& key, const str& value, EngineConfig& outConfig, str* outError);
+static str Trim(const str& text);
+static bool ParseBool(const str& text, bool& outValue);
+static bool ParseAuto(const str& text, bool& outValue);
+template<class T> static bool ParseInteger(const str& text, T& outValue);
+static bool ParseRate(const str& text, double& outValue);
+static bool ParseReal(const str& text, double& outValue);
+
+bool EngineConfig::Parse(int argc, const char* const* argv, EngineConfig& outConfig, str* outError)
+{
+	// --key=value と --key value を、(key, value) の組に揃える
+	vec<std::pair<str, str>> arguments;
+	for (int i = 1; i < argc; ++i)
+	{
+		const str Argument = argv[i];
+		if (Argument.rfind("--", 0) != 0)
+		{
+			if (outError) *outError = "Unexpected argument: " + Argument;
+			return false;
+		}
+
+		const autosize Equal = Argument.find('=');
+		if (Equal != str::npos)
+			arguments.emplace_back(Argument.substr(2, Equal - 2), Argument.substr(Equal + 1));
+		else if (Argument == "--help")
+			arguments.emplace_back("help", "true");
+		else if (i + 1 < argc)
+		{
+			arguments.emplace_back(Argument.substr(2), argv[i + 1]);
+			++i;
+		}
+		else
+		{
+			if (outError) *outError = "Missing value: " + Argument;
+			return false;
+		}
+	}
+
+	// 設定ファイルを先に読み取り、コマンドライン引数で上書きする
+	for (const auto& [Key, Value] : arguments)
+		if (Key == "config" && !LoadFile(Value, outConfig, outError)) return false;
+	for (const auto& [Key, Value] : arguments)
+		if (Key != "config" && !Apply(Key, Value, outConfig, outError)) return false;
+
+	return true;
+}
+
+bool EngineConfig::LoadFile(const str& path, EngineConfig& outConfig, str* outError)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		if (outError) *outError = "Cannot open config file: " + path;
+		return false;
+	}
+
+	str line;
+	uint32 lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		++lineNumber;
+
+		const autosize Comment = line.find('#');
+		if (Comment != str::npos) line.erase(Comment);
+		if (Trim(line).empty()) continue;
+
+		const autosize Equal = line.find('=');
+		if (Equal == str::npos || !Apply(Trim(line.substr(0, Equal)), Trim(line.substr(Equal + 1)), outConfig, outError))
+		{
+			if (outError) *outError = path + ":" + std::to_string(lineNumber) + ": " + (Equal == str::npos ? "Expected 'key = value'" : *outError);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+str EngineConfig::GetUsage()
+{
+	return
+		"Usage: Shusaku [--key value | --key=value]...\n"
+		"  --config <path>                    Read 'key = value' lines from a file (command line wins)\n"
+		"  --size <9|13|19>                   Board size (default 9)\n"
+		"  --black <auto|manual>              Who plays black (default auto)\n"
+		"  --white <auto|manual>              Who plays white (default auto)\n"
+		"  --win-rate-threshold <rate>        Pass/resign threshold (default 0.1)\n"
+		"  --settled-ownership-threshold <r>  Ownership treated as settled (default 0.9)\n"
+		"  --settled-rate-threshold <rate>    Settled share of the board to pass (default 0.95)\n"
+		"  --think-count <n>                  Playouts per candidate (default 0 = by thread count)\n"
+		"  --threads <n>                      Search threads (default 0 = hardware threads)\n"
+		"  --cpus <list>                      Pin search threads to CPUs, e.g. 0-3,8 (default none)\n"
+		"  --workers <n>                      Worker processes (default 0 = this process only)\n"
+		"  --pin-workers <true|false>         Pin each worker to its share of CPUs (default true)\n"
+		"  --playout-policy <eye-aware|pattern|random>  Playout move selection (default pattern)\n"
+		"  --playout-tactics <true|false>     Prefer capture/escape moves in playouts (default true)\n"
+		"  --last-good-reply <true|false>     Replay replies that won earlier playouts (default false)\n"
+		"  --lockstep-playouts <true|false>   Run eye-aware playouts several at a time with SIMD\n"
+		"                                     (needs --playout-policy eye-aware --playout-tactics false\n"
+		"                                      --last-good-reply false --playout-mercy 0)\n"
+		"  --playout-max-turns-rate <n>       Playout length limit, in board points (default 3)\n"
+		"  --playout-mercy <n>                End a playout once the stone difference reaches n (default 0 = off)\n"
+		"  --book-games <n>                   Regenerate the opening book with n self-play games (default 0)\n"
+		"  --book-moves <n>                   Opening moves kept per game (default 8)\n"
+		"  --book-min-tries <n>               Minimum games per book move (default 2)\n"
+		"  --analyze <path>                   Analyse a finished game (kifu .txt or .sgf) instead of playing\n"
+		"                                     (each position gets the --think-count budget, positions run in parallel)\n"
+		"  --tournament <config>              Play this configuration (A) against it overridden by a config file (B)\n"
+		"  --tournament-games <n>             Maximum tournament games (default 1000)\n"
+		"  --tournament-parallel <n>          Games played at once, one thread each (default 0 = hardware threads)\n"
+		"  --sprt-elo0 <elo>, --sprt-elo1 <elo>  SPRT hypotheses for A minus B (default 0, 10)\n"
+		"  --pattern-weights <path>           Learned playout weights for the pattern policy\n"
+		"                                     (default ../Outputs/PatternWeights.bin, hand-set weights if missing)\n"
+		"  --train-patterns <dir>             Learn playout weights from the kifu/SGF files in dir and write them\n"
+		"                                     to --pattern-weights instead of playing\n"
+		"  --train-iterations <n>             MM iterations for --train-patterns (default 16)\n"
+		"  --eval-cache <path>                Persistent search cache shared across games, runs and processes\n"
+		"                                     (created if missing; searches warm-start from cached statistics)\n"
+		"  --eval-cache-buckets <n>           Buckets when creating the cache, 512 bytes each (default 65536)\n"
+		"  --help                             Show this message\n";
+}
+
+// key の項目に、value を設定する
+bool Apply(const str& key, const str& value, EngineConfig& outConfig, str* outError)
+{
+	SimulatorOptions& simulatorOptions = outConfig.simulatorOptions;
+
+	bool succeeded;
+	if (key == "size")
+	{
+		succeeded = true;
+		if (value == "9") outConfig.boardSize = BoardSize::_9x9;
+		else if (value == "13") outConfig.boardSize = BoardSize::_13x13;
+		else if (value == "19") outConfig.boardSize = BoardSize::_19x19;
+		else succeeded = false;
+	}
+	else if (key == "black") succeeded = ParseAuto(value, outConfig.blackAuto);
+	else if (key == "white") succeeded = ParseAuto(value, outConfig.whiteAuto);
+	else if (key == "win-rate-threshold") succeeded = ParseRate(value, outConfig.winRateThreshold);
+	else if (key == "settled-ownership-threshold") succeeded = ParseRate(value, outConfig.settledOwnershipThreshold);
+	else if (key == "settled-rate-threshold") succeeded = ParseRate(value, outConfig.settledRateThreshold);
+	else if (key == "think-count") succeeded = ParseInteger(value, simulatorOptions.thinkCount);
+	else if (key == "threads") succeeded = ParseInteger(value, simulatorOptions.threadCount);
+	else if (key == "cpus") succeeded = CpuAffinity::ParseList(value, simulatorOptions.cpus);
+	else if (key == "workers") succeeded = ParseInteger(value, outConfig.clusterOptions.workerCount);
+	else if (key == "pin-workers") succeeded = ParseBool(value, outConfig.clusterOptions.pinWorkers);
+	else if (key == "playout-policy")
+	{
+		succeeded = true;
+		if (value == "eye-aware") simulatorOptions.playoutPolicy = PlayoutPolicy::EyeAware;
+		else if (value == "pattern") simulatorOptions.playoutPolicy = PlayoutPolicy::Pattern;
+		else if (value == "random") simulatorOptions.playoutPolicy = PlayoutPolicy::Random;
+		else succeeded = false;
+	}
+	else if (key == "playout-tactics") succeeded = ParseBool(value, simulatorOptions.playoutTactics);
+	else if (key == "last-good-reply") succeeded = ParseBool(value, simulatorOptions.lastGoodReply);
+	else if (key == "lockstep-playouts") succeeded = ParseBool(value, simulatorOptions.lockstepPlayouts);
+	else if (key == "playout-max-turns-rate")
+		succeeded = ParseInteger(value, simulatorOptions.playoutMaxTurnsRate) && simulatorOptions.playoutMaxTurnsRate > 0;
+	else if (key == "playout-mercy") succeeded = ParseInteger(value, simulatorOptions.playoutMercyThreshold);
+	else if (key == "book-games") succeeded = ParseInteger(value, outConfig.bookGameCount);
+	else if (key == "book-moves") succeeded = ParseInteger(value, outConfig.bookMoveCount);
+	else if (key == "book-min-tries") succeeded = ParseInteger(value, outConfig.bookMinTryCount);
+	else if (key == "analyze") succeeded = !(outConfig.analyzePath = value).empty();
+	else if (key == "tournament") succeeded = !(outConfig.tournamentConfigPath = value).empty();
+	else if (key == "tournament-games") succeeded = ParseInteger(value, outConfig.tournamentOptions.maxGameCount);
+	else if (key == "tournament-parallel") succeeded = ParseInteger(value, outConfig.tournamentOptions.parallelGameCount);
+	else if (key == "sprt-elo0") succeeded = ParseReal(value, outConfig.tournamentOptions.elo0);
+	else if (key == "sprt-elo1") succeeded = ParseReal(value, outConfig.tournamentOptions.elo1);
+	else if (key == "pattern-weights") succeeded = !(outConfig.patternWeightsPath = value).empty();
+	else if (key == "train-patterns") succeeded = !(outConfig.trainPatternsPath = value).empty();
+	else if (key == "train-iterations") succeeded = ParseInteger(value, outConfig.trainIterationCount) && outConfig.trainIterationCount > 0;
+	else if (key == "eval-cache") succeeded = !(outConfig.evalCachePath = value).empty();
+	else if (key == "eval-cache-buckets") succeeded = ParseInteger(value, outConfig.evalCacheBucketCount) && outConfig.evalCacheBucketCount > 0;
+	else if (key == "help") succeeded = ParseBool(value, outConfig.showHelp);
+	else
+	{
+		if (outError) *outError = "Unknown option: " + key;
+		return false;
+	}
+
+	if (!succeeded && outError) *outError = "Invalid value for " + key + ": '" + value + "'";
+	return succeeded;
+}
+
+// 前後の空白を取り除く
+str Trim(const str& text)
+{
+	const autosize First = text.find_first_not_of(" \t\r");
+	if (First == str::npos) return "";
+	return text.substr(First, text.find_last_not_of(" \t\r") - First + 1);
+}
+
+bool ParseBool(const str& text, bool& outValue)
+{
+	if (text == "true" || text == "1") outValue = true;
+	else if (text == "false" || text == "0") outValue = false;
+	else return false;
+	return true;
+}
+
+// auto なら true, manual なら false
+bool ParseAuto(const str& text, bool& outValue)
+{
+	if (text == "auto") outValue = true;
+	else if (text == "manual") outValue = false;
+	else return false;
+	return true;
+}
+
+// 符号なしの 10 進数を、T に収まる範囲で読み取る
+template<class T>
+bool ParseInteger(const str& text, T& outValue)
+{
+	T value{};
+	const auto [End, Error] = std::from_chars(text.data(), text.data() + text.size(), value);
+	if (text.empty() || Error != std::errc() || End != text.data() + text.size()) return false;
+	outValue = value;
+	return true;
+}
+
+// 0 以上 1 以下の実数を読み取る
+bool ParseRate(const str& text, double& outValue)
+{
+	double value = 0.0;
+	const auto [End, Error] = std::from_chars(text.data(), text.data() + text.size(), value);
+	if (text.empty() || Error != std::errc() || End != text.data() + text.size() || value < 0.0 || 1.0 < value) return false;
+	outValue = value;
+	return true;
+}
+
+// 実数 (負の数も含む) を読み取る
+bool ParseReal(const str& text, double& outValue)
+{
+	double value = 0.0;
+	const auto [End, Error] = std::from_chars(text.data(), text.data() + text.size(), value);
+	if (text.empty() || Error != std::errc() || End != text.data() + text.size() || !std::isfinite(value)) return false;
+	outValue = value;
+	return true;
+}
@@ -0,0 +1,230 @@
+﻿#include <EvalCache.hpp>
+#include <OpeningBook.hpp>
+
+using namespace Shusaku;
+
+static_assert(sizeof(EvalCache::Header) == 64);
+static_assert(sizeof(EvalCache::Record) % sizeof(uint64) == 0);
+static_assert(sizeof(EvalCache::Slot) % 64 == 0);
+// 他のプロセスと共有するメモリの上で使うので、ロックを使わない (アドレスに依らない) 不可分操作であること
+static_assert(std::atomic_ref<uint32>::is_always_lock_free && std::atomic_ref<uint64>::is_always_lock_free);
+
+bool EvalCache::Open(const str& path, uint64 bucketCount)
+{
+	slots = nullptr;
+	this->bucketCount = 0;
+
+	// 無ければ作ってから開く
+	if (!file.Open(path, true))
+	{
+		if (!CreateEmptyFile(path, std::bit_floor(std::max<uint64>(bucketCount, 1)))) return false;
+		if (!file.Open(path, true)) return false;
+	}
+
+	// ヘッダを確かめる
+	if (file.GetSize() < sizeof(Header)) return false;
+	Header header;
+	std::memcpy(&header, file.GetData(), sizeof(Header));
+	if (header.magic != MagicValue || header.version != Version || header.slotsPerBucket != SlotsPerBucket) return false;
+	if (header.bucketCount == 0 || !std::has_single_bit(header.bucketCount)) return false;
+	if (file.GetSize() != sizeof(Header) + header.bucketCount * SlotsPerBucket * sizeof(Slot)) return false;
+
+	slots = reinterpret_cast<Slot*>(file.GetWritableData() + sizeof(Header));
+	this->bucketCount = header.bucketCount;
+	return true;
+}
+
+bool EvalCache::Probe(Stone stone, const Board& board, Record& outRecord, uint8* outSymmetry) const
+{
+	if (!IsOpen()) return false;
+
+	const uint64 Key = OpeningBook::GetKey(stone, board, outSymmetry);
+	const Slot* const Bucket = slots + (Key & (bucketCount - 1)) * SlotsPerBucket;
+	for (uint32 s = 0; s < SlotsPerBucket; ++s)
+		if (ReadSlot(Bucket[s], outRecord) && outRecord.key == Key && outRecord.boardSize == board.GetSize())
+			return true;
+	return false;
+}
+
+bool EvalCache::WarmStart(Stone stone, const Board& board, RootStats& outStats, uint64* outTryCount) const
+{
+	TRACE_SCOPE("EvalCache::WarmStart");
+
+	Record record;
+	uint8 symmetry;
+	if (!Probe(stone, board, record, &symmetry)) return false;
+
+	const uint8 size = board.GetSize();
+	if (outStats.tryCounts.size() != board.GetPositionsCount())
+		outStats.Reset(board.GetPositionsCount(), !outStats.ownershipCounts.empty());
+
+	// 正規形での手を、元の盤面での手に戻して加算する
+	// 記録した手は、対称な手の代表なので、元の盤面でそれと対称な全ての点に加算する (探索で、代表の結果を写すのと同じ)
+	// 加算した試行回数の合計は、対称な手をまとめて 1 つと数える (探索の予算と同じ単位)
+	const uint8 SymmetryMask = board.GetSymmetryMask();
+	uint64 tryCount = 0;
+	for (uint8 i = 0; i < record.moveCount && i < Record::MaxMoveCount; ++i)
+	{
+		const Move& Cached = record.moves[i];
+		const Pos Original = Symmetry::InverseTransform({ Cached.x, Cached.y }, size, symmetry);
+		if (Original.x < 1 || size < Original.x || Original.y < 1 || size < Original.y) continue;
+
+		// 対称な点のうち、重ならないものだけに加算する (対角線上の点などは、いくつかの変換で同じ点に移る)
+		arr<Pos, Symmetry::Count> credited;
+		uint8 creditedCount = 0;
+		for (uint8 s = 0; s < Symmetry::Count; ++s)
+		{
+			if (!(SymmetryMask & (1 << s))) continue;
+
+			const Pos pos = Symmetry::Transform(Original, size, s);
+			if (std::find(credited.begin(), credited.begin() + creditedCount, pos) != credited.begin() + creditedCount) continue;
+			if (!board.IsLegal(pos, stone)) continue;
+
+			const autosize Idx = (pos.x - 1) + (pos.y - 1) * size;
+			outStats.tryCounts[Idx] += Cached.tryCount;
+			outStats.winCounts[Idx] += Cached.winCount;
+			credited[creditedCount++] = pos;
+		}
+		if (creditedCount > 0) tryCount += Cached.tryCount;
+	}
+
+	if (outTryCount) *outTryCount = tryCount;
+	return true;
+}
+
+void EvalCache::Store(Stone stone, const Board& board, const RootStats& stats)
+{
+	TRACE_SCOPE("EvalCache::Store");
+
+	if (!IsOpen() || stats.tryCounts.size() != board.GetPositionsCount()) return;
+
+	const uint8 size = board.GetSize();
+	uint8 symmetry;
+	const uint64 Key = OpeningBook::GetKey(stone, board, &symmetry);
+
+	// 試行回数の多い手から順に、正規形の盤面の上での代表 (Symmetry::GetCanonicalRepresentative) に移して記録する
+	// 盤面が対称なら、対称な手は同じ代表になるので、1 つだけ記録する (探索の候補手と同じく、対称な手をまとめて 1 つと数える)
+	const uint8 SymmetryMask = board.GetSymmetryMask();
+	vec<autosize> indices;
+	indices.reserve(stats.tryCounts.size());
+	for (autosize i = 0; i < stats.tryCounts.size(); ++i)
+		if (stats.tryCounts[i] > 0) indices.push_back(i);
+	if (indices.empty()) return;
+	std::stable_sort(indices.begin(), indices.end(),
+		[&stats](autosize a, autosize b) { return stats.tryCounts[a] > stats.tryCounts[b]; });
+
+	Record record{};
+	record.key = Key;
+	record.boardSize = size;
+	for (const autosize Idx : indices)
+	{
+		if (record.moveCount == Record::MaxMoveCount) break;
+
+		const Pos Canonical = Symmetry::GetCanonicalRepresentative({ static_cast<uint8>(Idx % size + 1), static_cast<uint8>(Idx / size + 1) }, size, symmetry, SymmetryMask);
+		const auto IsSame = [&Canonical](const Move& move) { return move.x == Canonical.x && move.y == Canonical.y; };
+		if (std::any_of(record.moves.begin(), record.moves.begin() + record.moveCount, IsSame)) continue;
+
+		Move& move = record.moves[record.moveCount++];
+		move.x = Canonical.x;
+		move.y = Canonical.y;
+		move.tryCount = static_cast<uint32>(std::min<uint64>(stats.tryCounts[Idx], MAX_uint32));
+		move.winCount = static_cast<uint32>(std::min<uint64>(stats.winCounts[Idx], move.tryCount));
+	}
+	const uint64 TryCount = record.GetTryCount();
+
+	// 同じ局面の記録か、無ければ、試行回数の合計が最も少ない (空を含む) 記録を置き換える
+	Slot* const Bucket = slots + (Key & (bucketCount - 1)) * SlotsPerBucket;
+	Slot* victim = nullptr;
+	uint64 victimTryCount = MAX_uint64;
+	for (uint32 s = 0; s < SlotsPerBucket; ++s)
+	{
+		Record existing;
+		if (!ReadSlot(Bucket[s], existing)) continue;  // 書き込み中のスロットは避ける
+
+		if (existing.key == Key && existing.boardSize == size)
+		{
+			if (existing.GetTryCount() > TryCount) return;
+			victim = &Bucket[s];
+			break;
+		}
+
+		const uint64 ExistingTryCount = existing.boardSize == 0 ? 0 : existing.GetTryCount();
+		if (ExistingTryCount < victimTryCount)
+		{
+			victim = &Bucket[s];
+			victimTryCount = ExistingTryCount;
+		}
+	}
+	if (victim) WriteSlot(*victim, record);
+}
+
+// シーケンスロックで読む
+// 番号が偶数で、読む前後で変わっていなければ、書き込みと重なっていない
+bool EvalCache::ReadSlot(const Slot& slot, Record& outRecord)
+{
+	constexpr uint32 MaxAttemptCount = 4;
+
+	std::atomic_ref<uint32> sequence(const_cast<uint32&>(slot.sequence));
+	arr<uint64, Slot::WordCount> words;
+	for (uint32 attempt = 0; attempt < MaxAttemptCount; ++attempt)
+	{
+		const uint32 Before = sequence.load(std::memory_order_acquire);
+		if (Before & 1) continue;
+
+		for (autosize w = 0; w < Slot::WordCount; ++w)
+			words[w] = std::atomic_ref<uint64>(const_cast<uint64&>(slot.words[w])).load(std::memory_order_relaxed);
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (sequence.load(std::memory_order_relaxed) != Before) continue;
+
+		std::memcpy(&outRecord, words.data(), sizeof(Record));
+		return true;
+	}
+	return false;
+}
+
+// シーケンスロックで書く
+// 番号を奇数にできた (他に書いているものがいない) 場合だけ書き、書き終えたら次の偶数にする
+// 書き込みの途中でプロセスが落ちると、そのスロットは奇数のまま残り、以降は使われない
+bool EvalCache::WriteSlot(Slot& slot, const Record& record)
+{
+	std::atomic_ref<uint32> sequence(slot.sequence);
+	uint32 expected = sequence.load(std::memory_order_relaxed);
+	if ((expected & 1) || !sequence.compare_exchange_strong(expected, expected + 1, std::memory_order_acquire, std::memory_order_relaxed))
+		return false;
+	std::atomic_thread_fence(std::memory_order_release);
+
+	arr<uint64, Slot::WordCount> words;
+	std::memcpy(words.data(), &record, sizeof(Record));
+	for (autosize w = 0; w < Slot::WordCount; ++w)
+		std::atomic_ref<uint64>(slot.words[w]).store(words[w], std::memory_order_relaxed);
+
+	sequence.store(expected + 2, std::memory_order_release);
+	return true;
+}
+
+// 一時ファイルにヘッダを書いて、0 で埋めた大きさまで伸ばしてから、path にハードリンクを張る
+// 同時に作ったプロセスがあれば、先にリンクを張った方のファイルを使う (どのプロセスも、作りかけのファイルを開くことはない)
+bool EvalCache::CreateEmptyFile(const str& path, uint64 bucketCount)
+{
+	const str TempPath = path + ".tmp" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+
+	Header header{};
+	header.magic = MagicValue;
+	header.version = Version;
+	header.slotsPerBucket = SlotsPerBucket;
+	header.bucketCount = bucketCount;
+	{
+		std::ofstream ofs(TempPath, std::ios::binary);
+		if (!ofs) return false;
+		ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		if (!ofs) return false;
+	}
+
+	std::error_code error;
+	std::filesystem::resize_file(TempPath, sizeof(Header) + bucketCount * SlotsPerBucket * sizeof(Slot), error);
+	if (!error) std::filesystem::create_hard_link(TempPath, path, error);
+	const bool Exists = std::filesystem::exists(path);
+	std::filesystem::remove(TempPath, error);
+	return Exists;
+}
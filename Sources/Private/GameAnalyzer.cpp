@@ -0,0 +1,214 @@
+﻿#include <GameAnalyzer.hpp>
+#include <Simulator.hpp>
+
+using namespace Shusaku;
+
+static bool LoadKifu(std::istream& input, vec<PosStone>& outHistory);
+static bool LoadSgf(std::istream& input, vec<PosStone>& outHistory, BoardSize* outBoardSize);
+static str FormatPos(const Pos& pos);
+
+bool GameAnalyzer::LoadGame(const str& path, vec<PosStone>& outHistory, BoardSize* outBoardSize)
+{
+	outHistory.clear();
+
+	std::ifstream file(path);
+	if (!file) return false;
+
+	const bool IsSgf = path.size() >= 4 && (path.compare(path.size() - 4, 4, ".sgf") == 0 || path.compare(path.size() - 4, 4, ".SGF") == 0);
+	return IsSgf ? LoadSgf(file, outHistory, outBoardSize) : LoadKifu(file, outHistory);
+}
+
+vec<MoveAnalysis> GameAnalyzer::Analyze(BoardSize boardSize, const vec<PosStone>& history, const SimulatorOptions& options)
+{
+	// 各手を打つ前の局面を、先に並べておく
+	vec<Board> boards;
+	boards.reserve(history.size());
+	{
+		Board board = Board::Create(boardSize);
+		for (const PosStone& Move : history)
+		{
+			boards.push_back(board);
+			if (!board.PutStone(Move.pos, Move.stone))
+			{
+				boards.pop_back();
+				break;
+			}
+		}
+	}
+
+	// 1 つの局面の探索は 1 スレッドで行い、局面の間で並列にする
+	// 探索のスレッドは、局面を解析するスレッドを固定した CPU を引き継ぐ
+	SimulatorOptions positionOptions = options;
+	positionOptions.threadCount = 1;
+	positionOptions.cpus.clear();
+	positionOptions.openingBook = nullptr;
+	const uint64 TryCount = Simulator::GetThinkCount(options);
+
+	vec<MoveAnalysis> analyses(boards.size());
+	const uint32 WorkerCount = static_cast<uint32>(std::min<autosize>(Simulator::GetThreadCount(options), boards.size()));
+	std::atomic<autosize> nextPosition = 0;
+
+	vec<std::future<void>> futures;
+	futures.reserve(WorkerCount);
+	for (uint32 w = 0; w < WorkerCount; ++w)
+	{
+		futures.emplace_back(std::async(std::launch::async,
+			[&, w]()
+			{
+				// CPU の番号が指定されていれば、このスレッドを固定する
+				if (!options.cpus.empty())
+					CpuAffinity::PinCurrentThread({ options.cpus[w % options.cpus.size()] });
+
+				RootStats stats;
+				for (autosize i = nextPosition++; i < boards.size(); i = nextPosition++)
+				{
+					TRACE_SCOPE("GameAnalyzer::Position");
+
+					const Board& board = boards[i];
+					const PosStone& Played = history[i];
+					MoveAnalysis& analysis = analyses[i];
+
+					stats.Reset(board.GetPositionsCount(), false);
+					Simulator::Search(Played.stone, board, positionOptions, TryCount, stats);
+
+					analysis.played = Played;
+					analysis.bestPos = Simulator::SelectBest(Played.stone, board, positionOptions, stats, &analysis.bestWinRate);
+
+					// 実際に打たれた手の勝率は、試行の結果そのまま (事前評価は混ぜない)
+					const autosize PlayedIdx = (Played.pos.x - 1) + (Played.pos.y - 1) * board.GetSize();
+					analysis.playedTryCount = stats.tryCounts[PlayedIdx];
+					if (analysis.playedTryCount > 0)
+						analysis.playedWinRate = static_cast<double>(stats.winCounts[PlayedIdx]) / analysis.playedTryCount;
+				}
+			}
+		));
+	}
+	for (auto& future : futures)
+		future.get();
+
+	return analyses;
+}
+
+vec<double> GameAnalyzer::GetWinRates(const vec<MoveAnalysis>& analyses)
+{
+	vec<double> winRates;
+	winRates.reserve(analyses.size());
+	for (autosize i = 0; i < analyses.size(); ++i)
+	{
+		// 最善手が見つからなかった局面は、半々とみなす
+		const MoveAnalysis& Analysis = analyses[i];
+		const double WinRate = Analysis.bestWinRate == MIN_double ? 0.5 : Analysis.bestWinRate;
+
+		// 棋譜にパスが残らないので、手番と、グラフの交互の手番がずれていたら反転させる
+		const Stone GraphTurn = (i & 1) == 0 ? Stone::Black : Stone::White;
+		winRates.push_back(Analysis.played.stone == GraphTurn ? WinRate : 1.0 - WinRate);
+	}
+	return winRates;
+}
+
+bool GameAnalyzer::WriteReport(const str& path, const vec<MoveAnalysis>& analyses)
+{
+	const str OutputPath = "../Outputs/" + path + ".txt";
+
+	std::ofstream ofs(OutputPath, std::ios::out | std::ios::trunc);
+	if (!ofs) return false;
+
+	// 手数 手番 実際の手 その勝率 最善手 その勝率 勝率の差
+	ofs << "# Move Turn Played WinRate Best BestWinRate Loss\n";
+	ofs << std::fixed << std::setprecision(3);
+	for (autosize i = 0; i < analyses.size(); ++i)
+	{
+		const MoveAnalysis& Analysis = analyses[i];
+		ofs << (i + 1) << " " << (Analysis.played.stone == Stone::Black ? "B" : "W") << " " << FormatPos(Analysis.played.pos) << " ";
+		if (Analysis.playedWinRate == MIN_double) ofs << "-";
+		else ofs << Analysis.playedWinRate;
+		ofs << " " << FormatPos(Analysis.bestPos) << " ";
+		if (Analysis.bestWinRate == MIN_double) ofs << "-";
+		else ofs << Analysis.bestWinRate;
+		ofs << " ";
+		if (Analysis.playedWinRate == MIN_double || Analysis.bestWinRate == MIN_double) ofs << "-";
+		else ofs << std::max(Analysis.bestWinRate - Analysis.playedWinRate, 0.0);
+		ofs << "\n";
+	}
+
+	return static_cast<bool>(ofs);
+}
+
+// ImageWriter::WriteHistory の形式 ("B x,y" / "W x,y" の行) を読み取る (空行は読み飛ばす)
+bool LoadKifu(std::istream& input, vec<PosStone>& outHistory)
+{
+	str line;
+	while (std::getline(input, line))
+	{
+		if (!line.empty() && line.back() == '\r') line.pop_back();
+		if (line.empty()) continue;
+
+		char turn = 0, comma = 0;
+		int x = 0, y = 0;
+		std::istringstream iss(line);
+		if (!(iss >> turn >> x >> comma >> y) || comma != ',' || (turn != 'B' && turn != 'W')) return false;
+		if (x < 1 || 19 < x || y < 1 || 19 < y) return false;
+
+		outHistory.push_back({ { static_cast<uint8>(x), static_cast<uint8>(y) }, turn == 'B' ? Stone::Black : Stone::White });
+	}
+	return true;
+}
+
+// SGF の本譜 (最初の ')' までに現れる、B と W の着手) を読み取る
+// 座標は "aa" が (1, 1) で、1 文字目が x, 2 文字目が y. 空 ("") と "tt" はパス
+bool LoadSgf(std::istream& input, vec<PosStone>& outHistory, BoardSize* outBoardSize)
+{
+	const str Text((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+
+	str identifier;
+	for (autosize i = 0; i < Text.size(); ++i)
+	{
+		const char C = Text[i];
+		if (C == ')') break;  // 最初の変化が終わった
+		if ('A' <= C && C <= 'Z')
+		{
+			identifier.push_back(C);
+			continue;
+		}
+		if (C != '[')
+		{
+			if (C == ';' || C == '(') identifier.clear();
+			continue;
+		}
+
+		// 値を読み取る ("\" の次の文字は、そのまま値に含める)
+		str value;
+		for (++i; i < Text.size() && Text[i] != ']'; ++i)
+		{
+			if (Text[i] == '\\' && i + 1 < Text.size()) ++i;
+			value.push_back(Text[i]);
+		}
+
+		if (identifier == "SZ")
+		{
+			if (value == "9") { if (outBoardSize) *outBoardSize = BoardSize::_9x9; }
+			else if (value == "13") { if (outBoardSize) *outBoardSize = BoardSize::_13x13; }
+			else if (value == "19") { if (outBoardSize) *outBoardSize = BoardSize::_19x19; }
+			else return false;
+		}
+		else if (identifier == "AB" || identifier == "AW")
+			return false;
+		else if ((identifier == "B" || identifier == "W") && !value.empty() && value != "tt")
+		{
+			if (value.size() != 2 || value[0] < 'a' || 's' < value[0] || value[1] < 'a' || 's' < value[1]) return false;
+			const Pos Move = { static_cast<uint8>(value[0] - 'a' + 1), static_cast<uint8>(value[1] - 'a' + 1) };
+			outHistory.push_back({ Move, identifier == "B" ? Stone::Black : Stone::White });
+		}
+
+		// 同じ識別子に値が続く場合 (AB[aa][bb] など) に備えて、識別子は次の ';' か英大文字まで残す
+		if (i + 1 < Text.size() && Text[i + 1] != '[') identifier.clear();
+	}
+	return true;
+}
+
+// "(x,y)" の形にする (パスは "pass")
+str FormatPos(const Pos& pos)
+{
+	if (pos == Pos(0, 0)) return "pass";
+	return "(" + std::to_string(pos.x) + "," + std::to_string(pos.y) + ")";
+}
@@ -0,0 +1,86 @@
+﻿#include <GraphRenderer.hpp>
+
+using namespace Shusaku;
+
+static constexpr uint16 MemoryWidth = 50;  // メモリの幅 (px)
+static constexpr uint16 PointRadius = 4;  // 点の半径 (px)
+static constexpr uint8 MemoryLineCount = 11;  // メモリのライン数 (奇数の想定)
+static constexpr double MemoriesMargin = 1.0 * GraphRenderer::Height / (MemoryLineCount + 1);  // メモリの間隔
+
+static const cv::Scalar BlackPointColor = { 0, 0, 0 };  // 点の色 (黒) (BGR)
+static const cv::Scalar WhitePointColor = { 255, 255, 255 };  // 点の色 (白) (BGR)
+static const cv::Scalar GeneralColor = { 82, 61, 58 };  // 汎用色 (BGR)
+
+const cv::Scalar GraphRenderer::BackgroundColor = { 240, 180, 170 };
+
+GraphRenderer::GraphRenderer(autosize pointCount)
+	: pointCount(pointCount)
+{
+	points.reserve(pointCount);
+
+	// 画像の初期化、背景を設定
+	image = cv::Mat(Height, Width, CV_8UC3, BackgroundColor);
+
+	// メモリを描画
+	{
+		constexpr uint8 BorderLineWidth = 1;  // 境界線の太さ (px)
+		constexpr uint8 LineWidth = 1;  // ラインの太さ (px)
+		constexpr uint8 LineLength = 20;  // 境界線より左部分の、ラインの長さ (px)
+		constexpr uint8 CenterIndex = MemoryLineCount / 2;  // 中央のラインのインデックス
+		constexpr uint16 LeftX = MemoryWidth - LineLength;  // ラインの左端の X 座標
+
+		static const cv::Scalar LineAccentColor = { 64, 48, 232 };  // ラインのアクセント色 (BGR)
+
+		// 境界線を描画
+		cv::line(image, cv::Point(MemoryWidth, 0), cv::Point(MemoryWidth, Height), GeneralColor, BorderLineWidth, cv::LINE_AA);
+
+		// ラインを描画
+		for (uint8 i = 0; i < MemoryLineCount; ++i)
+		{
+			// 最初と中央、最後のラインは長くする
+			const bool IsLong = (i == 0 || i == CenterIndex || i == MemoryLineCount - 1);
+
+			// 位置を計算
+			const uint16 RightX = IsLong ? Width : MemoryWidth;
+			const uint16 Y = static_cast<uint16>(std::round(Math::RemapClamped(i, 0, MemoryLineCount - 1, Height - MemoriesMargin, MemoriesMargin)));
+
+			// 色を決定
+			// 中央のラインはアクセント色、それ以外は汎用色
+			const cv::Scalar& LineColor = (i == CenterIndex) ? LineAccentColor : GeneralColor;
+
+			// 各ラインを描画
+			cv::line(image, cv::Point(LeftX, Y), cv::Point(RightX, Y), LineColor, LineWidth, cv::LINE_AA);
+		}
+	}
+}
+
+void GraphRenderer::AddPoint(double winRate)
+{
+	constexpr uint8 PointsLineWidth = 1;  // 点を結ぶ線の太さ (px)
+
+	if (points.size() >= pointCount) return;
+
+	const double PointsMargin = 1.0 * (Width - MemoryWidth) / (pointCount + 1);  // 点の間隔
+
+	const autosize Idx = points.size();
+	const bool IsBlack = !(Idx & 1);
+	const double WinRate = IsBlack ? winRate : 1.0 - winRate;  // 黒石の勝率はそのまま、白石の勝率は反転させる
+
+	// 座標を計算し、保存する
+	const uint16 X = static_cast<uint16>(std::round(MemoryWidth + (Idx + 1) * PointsMargin));
+	const uint16 Y = static_cast<uint16>(std::round(Math::RemapClamped(WinRate, 0.0, 1.0, Height - MemoriesMargin, MemoriesMargin)));
+	points.emplace_back(X, Y);
+
+	// 直前の点と結ぶ線を描画
+	if (Idx >= 1)
+		cv::line(image, points[Idx - 1], points[Idx], GeneralColor, PointsLineWidth, cv::LINE_AA);
+
+	// 点は線の上に描画するので、今引いた線に重なる点を、前から順に描画し直す (点の間隔が狭いと、直前の点より前の点も重なる)
+	autosize first = Idx >= 1 ? Idx - 1 : 0;
+	while (first > 0 && points[Idx - 1].x - points[first - 1].x <= PointRadius + 1) --first;
+	for (autosize i = first; i <= Idx; ++i)
+	{
+		const cv::Scalar& PointColor = !(i & 1) ? BlackPointColor : WhitePointColor;
+		cv::circle(image, points[i], PointRadius, PointColor, cv::FILLED, cv::LINE_AA);
+	}
+}
@@ -0,0 +1,536 @@
+﻿#include <LockstepPlayout.hpp>
+
+using namespace Shusaku;
+
+static constexpr uint32 LaneCount = LockstepPlayout::LaneCount;
+static constexpr int32 Comi = 7;  // コミ (黒が出す. Simulator の勝敗判定と同じ)
+
+// WordCount 個の 64 bit の語で表した、全てのレーンのビットボード
+// 点 (x, y) (0 始まり) は、x + y * size 番目のビット. レーンを最も内側に並べるので、同じ語の全てのレーンが連続する
+template<uint8 WordCount>
+struct alignas(64) LaneBits final
+{
+	uint64 words[WordCount][LaneCount];
+};
+
+// 盤面の大きさで決まる、全てのレーンで共通のマスク
+template<uint8 WordCount>
+struct BoardMasks final
+{
+	int32 size = 0;
+	uint64 onBoard[WordCount]{};  // 盤上の点
+	uint64 firstColumn[WordCount]{};  // x == 0 の点
+	uint64 lastColumn[WordCount]{};  // x == size - 1 の点
+	uint64 firstRow[WordCount]{};  // y == 0 の点
+	uint64 lastRow[WordCount]{};  // y == size - 1 の点
+	uint64 edge[WordCount]{};  // 盤端の点
+};
+
+// 1 局分の手番の石 (own) と相手の石 (opp)
+template<uint8 WordCount>
+struct LaneStones final
+{
+	LaneBits<WordCount> own, opp;
+};
+
+template<uint8 WordCount> static void RunLanes(Stone stone, const Board& board, const SimulatorOptions& options, uint32 gameCount, arr<Stone, LaneCount>& outWinners, int32* outOwnershipCounts);
+template<uint8 WordCount> static BoardMasks<WordCount> CreateMasks(uint8 size);
+template<uint8 WordCount> static void LoadStones(const vec<Stone>& stones, LaneBits<WordCount>& outBlack, LaneBits<WordCount>& outWhite);
+static uint64 FromLower(uint64 word, uint64 lowerWord, int32 shift);
+static uint64 FromUpper(uint64 word, uint64 upperWord, int32 shift);
+template<uint8 WordCount> static void GetAdjacent(const BoardMasks<WordCount>& masks, const LaneBits<WordCount>& bits, LaneBits<WordCount>& outAdjacent);
+template<uint8 WordCount> static void GetNeighbors(const BoardMasks<WordCount>& masks, const LaneBits<WordCount>& bits, uint8 direction, LaneBits<WordCount>& outNeighbors);
+template<uint8 WordCount> static void FloodToLiberty(const BoardMasks<WordCount>& masks, const LaneBits<WordCount>& seeds, const LaneBits<WordCount>& area, const LaneBits<WordCount>& liberties, LaneBits<WordCount>& outChain);
+template<uint8 WordCount> static void Flood(const BoardMasks<WordCount>& masks, const LaneBits<WordCount>& seeds, const LaneBits<WordCount>& area, LaneBits<WordCount>& outFilled);
+template<uint8 WordCount> static void GetEyes(const BoardMasks<WordCount>& masks, const LaneBits<WordCount>& own, const LaneBits<WordCount>& opp, const LaneBits<WordCount>& empty, LaneBits<WordCount>& outEyes);
+template<uint8 WordCount> static int32 PickBit(const LaneBits<WordCount>& bits, uint32 lane);
+
+void LockstepPlayout::Run(Stone stone, const Board& board, const SimulatorOptions& options, uint32 gameCount, arr<Stone, LaneCount>& outWinners, int32* outOwnershipCounts)
+{
+	TRACE_SCOPE("LockstepPlayout::Run");
+
+	// 盤面の点の数に合った語数で処理する (9x9 は 81 bit, 13x13 は 169 bit, 19x19 は 361 bit)
+	switch (board.GetBoardSize())
+	{
+	case BoardSize::_9x9:
+		RunLanes<2>(stone, board, options, gameCount, outWinners, outOwnershipCounts);
+		break;
+	case BoardSize::_13x13:
+		RunLanes<3>(stone, board, options, gameCount, outWinners, outOwnershipCounts);
+		break;
+	case BoardSize::_19x19:
+	default:
+		RunLanes<6>(stone, board, options, gameCount, outWinners, outOwnershipCounts);
+		break;
+	}
+}
+
+// LockstepPlayout::Run の本体 (盤面の点を WordCount 個の語で表す)
+template<uint8 WordCount>
+void RunLanes(Stone stone, const Board& board, const SimulatorOptions& options, uint32 gameCount, arr<Stone, LaneCount>& outWinners, int32* outOwnershipCounts)
+{
+	using Bits = LaneBits<WordCount>;
+
+	const uint8 Size = board.GetSize();
+	const uint16 PositionsCount = board.GetPositionsCount();
+	const BoardMasks<WordCount> Masks = CreateMasks<WordCount>(Size);
+	gameCount = std::min(gameCount, LaneCount);
+
+	// 対局の最大手数 (options.playoutMaxTurnsRate を参照)
+	const uint32 MaxTurns = static_cast<uint32>(PositionsCount) * options.playoutMaxTurnsRate;
+
+	// 全てのレーンに、同じ盤面を読み込む
+	// 手番は全てのレーンで揃っている (打てなければパスするので、どのレーンも毎手、手番が入れ替わる)
+	LaneStones<WordCount> current, beforeLast;  // 現在の盤面と、同形反復の判定に使う、直前の着手の前の盤面
+	LoadStones(board.GetBoard(), stone == Stone::Black ? current.own : current.opp, stone == Stone::Black ? current.opp : current.own);
+	if (board.GetBoardBeforeLastMove().empty())
+		beforeLast = {};  // 空の盤面は、着手の後の盤面と一致しないので、判定しないのと同じ
+	else
+		LoadStones(board.GetBoardBeforeLastMove(), stone == Stone::Black ? beforeLast.own : beforeLast.opp, stone == Stone::Black ? beforeLast.opp : beforeLast.own);
+
+	// 各レーンの状態
+	arr<bool, LaneCount> passed{};  // 直前の手番でパスしたか
+	arr<bool, LaneCount> finished{};  // 双方がパスして、終局したか (使わないレーンは、最初から終局扱い)
+	for (uint32 l = gameCount; l < LaneCount; ++l)
+		finished[l] = true;
+
+	Bits empty, eyes, candidates, move, neighbors, nearEmpty, isolatedOpp, seeds, chain, taken, own, liberties;
+	for (uint32 turn = 0; turn < MaxTurns; ++turn)
+	{
+		if (std::all_of(finished.begin(), finished.end(), [](bool b) { return b; })) break;
+
+		// 空き点のうち、自分の眼を除いた点から選ぶ
+		for (uint8 w = 0; w < WordCount; ++w)
+			for (uint32 l = 0; l < LaneCount; ++l)
+				empty.words[w][l] = Masks.onBoard[w] & ~(current.own.words[w][l] | current.opp.words[w][l]);
+		GetEyes(Masks, current.own, current.opp, empty, eyes);
+		for (uint8 w = 0; w < WordCount; ++w)
+			for (uint32 l = 0; l < LaneCount; ++l)
+				candidates.words[w][l] = empty.words[w][l] & ~eyes.words[w][l];
+
+		// 各レーンで候補からランダムに選び、全てのレーンでまとめて着手を試行する
+		// 打てなかった点 (着手禁止点・同形反復) は候補から外し、打てるか候補が無くなるまで選び直す
+		arr<bool, LaneCount> pending{};  // まだ着手を決めていないレーン
+		arr<bool, LaneCount> moved{};  // この手番で着手したレーン
+		for (uint32 l = 0; l < LaneCount; ++l)
+			pending[l] = !finished[l];
+		while (true)
+		{
+			bool anyPending = false;
+			for (uint32 l = 0; l < LaneCount; ++l)
+			{
+				for (uint8 w = 0; w < WordCount; ++w)
+					move.words[w][l] = 0;
+				if (!pending[l]) continue;
+
+				const int32 Idx = PickBit(candidates, l);
+				if (Idx < 0)
+				{
+					pending[l] = false;  // 打てる点がないので、パスする
+					continue;
+				}
+				move.words[Idx >> 6][l] = static_cast<uint64>(1) << (Idx & 63);
+				anyPending = true;
+			}
+			if (!anyPending) break;
+
+			// 着手に接する相手の連のうち、着手の後に呼吸点が無くなるものを取る
+			// 上下左右の隣の石ごとに連を辿る. 隣に空き点を持つ石の連は取れないので、辿らない
+			for (uint8 w = 0; w < WordCount; ++w)
+				for (uint32 l = 0; l < LaneCount; ++l)
+					empty.words[w][l] &= ~move.words[w][l];
+			GetAdjacent(Masks, empty, nearEmpty);
+			for (uint8 w = 0; w < WordCount; ++w)
+				for (uint32 l = 0; l < LaneCount; ++l)
+				{
+					taken.words[w][l] = 0;
+					isolatedOpp.words[w][l] = current.opp.words[w][l] & ~nearEmpty.words[w][l];
+				}
+			for (uint8 direction = 0; direction < 4; ++direction)
+			{
+				GetNeighbors(Masks, move, direction, seeds);
+				for (uint8 w = 0; w < WordCount; ++w)
+					for (uint32 l = 0; l < LaneCount; ++l)
+						seeds.words[w][l] &= isolatedOpp.words[w][l] & ~taken.words[w][l];
+				FloodToLiberty(Masks, seeds, current.opp, empty, chain);
+				for (uint8 w = 0; w < WordCount; ++w)
+					for (uint32 l = 0; l < LaneCount; ++l)
+						taken.words[w][l] |= chain.words[w][l];
+			}
+
+			// 着手の後の、手番の石
+			for (uint8 w = 0; w < WordCount; ++w)
+				for (uint32 l = 0; l < LaneCount; ++l)
+				{
+					own.words[w][l] = current.own.words[w][l] | move.words[w][l];
+					liberties.words[w][l] = empty.words[w][l] | taken.words[w][l];
+				}
+
+			// 隣に空き点があるか、石を取れるなら、呼吸点があるので打てる
+			// どちらでもないレーンだけ、着手した石の連を辿って、呼吸点を探す (最後まで見つからなければ、着手禁止点)
+			GetAdjacent(Masks, move, neighbors);
+			arr<bool, LaneCount> hasLiberty{};
+			for (uint8 w = 0; w < WordCount; ++w)
+				for (uint32 l = 0; l < LaneCount; ++l)
+					hasLiberty[l] |= (neighbors.words[w][l] & liberties.words[w][l]) != 0;
+			for (uint8 w = 0; w < WordCount; ++w)
+				for (uint32 l = 0; l < LaneCount; ++l)
+					seeds.words[w][l] = hasLiberty[l] ? 0 : move.words[w][l];
+			FloodToLiberty(Masks, seeds, own, liberties, chain);
+			for (uint8 w = 0; w < WordCount; ++w)
+				for (uint32 l = 0; l < LaneCount; ++l)
+				{
+					hasLiberty[l] |= (move.words[w][l] & ~chain.words[w][l]) != 0;
+					empty.words[w][l] |= move.words[w][l];  // 試行した着手を戻す
+				}
+
+			// 各レーンの着手を確定するか、候補から外す
+			for (uint32 l = 0; l < LaneCount; ++l)
+			{
+				if (!pending[l]) continue;
+
+				bool isRepeated = true;
+				for (uint8 w = 0; w < WordCount; ++w)
+				{
+					const uint64 Own = own.words[w][l];
+					const uint64 Opp = current.opp.words[w][l] & ~taken.words[w][l];
+					isRepeated &= Own == beforeLast.own.words[w][l] && Opp == beforeLast.opp.words[w][l];
+				}
+
+				if (hasLiberty[l] && !isRepeated)
+				{
+					for (uint8 w = 0; w < WordCount; ++w)
+					{
+						beforeLast.own.words[w][l] = current.own.words[w][l];
+						beforeLast.opp.words[w][l] = current.opp.words[w][l];
+						current.own.words[w][l] = own.words[w][l];
+						current.opp.words[w][l] &= ~taken.words[w][l];
+					}
+					pending[l] = false;
+					moved[l] = true;
+				}
+				else
+				{
+					for (uint8 w = 0; w < WordCount; ++w)
+						candidates.words[w][l] &= ~move.words[w][l];
+				}
+			}
+		}
+
+		// 双方がパスしたら終局
+		for (uint32 l = 0; l < LaneCount; ++l)
+		{
+			if (finished[l]) continue;
+			finished[l] = !moved[l] && passed[l];
+			passed[l] = !moved[l];
+		}
+
+		// 手番を入れ替える
+		std::swap(current.own, current.opp);
+		std::swap(beforeLast.own, beforeLast.opp);
+		stone = ReverseStone(stone);
+	}
+
+	// 勝敗を判定する
+	// 石の数と、一方の石だけに接している空き点の領域 (地) の数の合計で比べる (Simulator::Judge と同じ)
+	const Bits& Black = stone == Stone::Black ? current.own : current.opp;
+	const Bits& White = stone == Stone::Black ? current.opp : current.own;
+	Bits& blackReach = eyes;  // 黒石に接している空き点の領域
+	Bits& whiteReach = candidates;  // 白石に接している空き点の領域
+	for (uint8 w = 0; w < WordCount; ++w)
+		for (uint32 l = 0; l < LaneCount; ++l)
+			empty.words[w][l] = Masks.onBoard[w] & ~(Black.words[w][l] | White.words[w][l]);
+	GetAdjacent(Masks, Black, neighbors);
+	Flood(Masks, neighbors, empty, blackReach);
+	GetAdjacent(Masks, White, neighbors);
+	Flood(Masks, neighbors, empty, whiteReach);
+
+	Bits& blackArea = own;
+	Bits& whiteArea = taken;
+	for (uint8 w = 0; w < WordCount; ++w)
+		for (uint32 l = 0; l < LaneCount; ++l)
+		{
+			blackArea.words[w][l] = Black.words[w][l] | (blackReach.words[w][l] & ~whiteReach.words[w][l]);
+			whiteArea.words[w][l] = White.words[w][l] | (whiteReach.words[w][l] & ~blackReach.words[w][l]);
+		}
+
+	for (uint32 l = 0; l < gameCount; ++l)
+	{
+		int32 score = -Comi;
+		for (uint8 w = 0; w < WordCount; ++w)
+			score += std::popcount(blackArea.words[w][l]) - std::popcount(whiteArea.words[w][l]);
+		outWinners[l] = score > 0 ? Stone::Black : score < 0 ? Stone::White : Stone::Empty;
+
+		if (!outOwnershipCounts) continue;
+		for (uint8 w = 0; w < WordCount; ++w)
+		{
+			for (uint64 bits = blackArea.words[w][l]; bits != 0; bits &= bits - 1)
+				++outOwnershipCounts[(w << 6) + std::countr_zero(bits)];
+			for (uint64 bits = whiteArea.words[w][l]; bits != 0; bits &= bits - 1)
+				--outOwnershipCounts[(w << 6) + std::countr_zero(bits)];
+		}
+	}
+}
+
+// 一辺 size の盤面の、マスクを作る
+template<uint8 WordCount>
+BoardMasks<WordCount> CreateMasks(uint8 size)
+{
+	BoardMasks<WordCount> masks;
+	masks.size = size;
+	for (int32 y = 0; y < size; ++y)
+		for (int32 x = 0; x < size; ++x)
+		{
+			const int32 Idx = x + y * size;
+			const uint64 Bit = static_cast<uint64>(1) << (Idx & 63);
+			masks.onBoard[Idx >> 6] |= Bit;
+			if (x == 0) masks.firstColumn[Idx >> 6] |= Bit;
+			if (x == size - 1) masks.lastColumn[Idx >> 6] |= Bit;
+			if (y == 0) masks.firstRow[Idx >> 6] |= Bit;
+			if (y == size - 1) masks.lastRow[Idx >> 6] |= Bit;
+		}
+	for (uint8 w = 0; w < WordCount; ++w)
+		masks.edge[w] = masks.firstColumn[w] | masks.lastColumn[w] | masks.firstRow[w] | masks.lastRow[w];
+	return masks;
+}
+
+// 盤面の石の配置 stones を、全てのレーンの黒石・白石のビットボードに読み込む
+template<uint8 WordCount>
+void LoadStones(const vec<Stone>& stones, LaneBits<WordCount>& outBlack, LaneBits<WordCount>& outWhite)
+{
+	outBlack = {};
+	outWhite = {};
+	for (autosize i = 0; i < stones.size(); ++i)
+	{
+		if (stones[i] == Stone::Empty) continue;
+
+		LaneBits<WordCount>& bits = stones[i] == Stone::Black ? outBlack : outWhite;
+		for (uint32 l = 0; l < LaneCount; ++l)
+			bits.words[i >> 6][l] |= static_cast<uint64>(1) << (i & 63);
+	}
+}
+
+// 各点 p について、p - shift の点が含まれるかを表した語を返す (0 < shift < 64)
+// word はビットボードのある語、lowerWord はその 1 つ下位の語 (無ければ 0)
+// 行をまたいだ点も含むので、左右の隣を見る場合は、盤端の列をマスクで外すこと
+uint64 FromLower(uint64 word, uint64 lowerWord, int32 shift)
+{
+	return (word << shift) | (lowerWord >> (64 - shift));
+}
+
+// 各点 p について、p + shift の点が含まれるかを表した語を返す (0 < shift < 64)
+// word はビットボードのある語、upperWord はその 1 つ上位の語 (無ければ 0)
+// 行をまたいだ点も含むので、左右の隣を見る場合は、盤端の列をマスクで外すこと
+uint64 FromUpper(uint64 word, uint64 upperWord, int32 shift)
+{
+	return (word >> shift) | (upperWord << (64 - shift));
+}
+
+// bits の点の、上下左右にある盤上の点を、outAdjacent に格納する
+template<uint8 WordCount>
+void GetAdjacent(const BoardMasks<WordCount>& masks, const LaneBits<WordCount>& bits, LaneBits<WordCount>& outAdjacent)
+{
+	static constexpr uint64 Zeros[LaneCount] = {};
+
+	// 語ごとに、全てのレーンへ同じ演算を行う (レーン方向のループが、ベクトル命令になる)
+	const int32 Size = masks.size;
+	for (uint8 w = 0; w < WordCount; ++w)
+	{
+		const uint64* Words = bits.words[w];
+		const uint64* LowerWords = w > 0 ? bits.words[w - 1] : Zeros;
+		const uint64* UpperWords = w + 1 < WordCount ? bits.words[w + 1] : Zeros;
+		const uint64 NotFirstColumn = ~masks.firstColumn[w], NotLastColumn = ~masks.lastColumn[w], OnBoard = masks.onBoard[w];
+		alignas(64) uint64 adjacent[LaneCount];  // bits と outAdjacent が同じでも良いように、一旦ここに求める
+		for (uint32 l = 0; l < LaneCount; ++l)
+		{
+			const uint64 Horizontal = (FromLower(Words[l], LowerWords[l], 1) & NotFirstColumn) | (FromUpper(Words[l], UpperWords[l], 1) & NotLastColumn);
+			const uint64 Vertical = FromLower(Words[l], LowerWords[l], Size) | FromUpper(Words[l], UpperWords[l], Size);
+			adjacent[l] = (Horizontal | Vertical) & OnBoard;
+		}
+		std::memcpy(outAdjacent.words[w], adjacent, sizeof(adjacent));
+	}
+}
+
+// bits の点の、direction (0: 左, 1: 右, 2: 上, 3: 下) の隣にある盤上の点を、outNeighbors に格納する
+template<uint8 WordCount>
+void GetNeighbors(const BoardMasks<WordCount>& masks, const LaneBits<WordCount>& bits, uint8 direction, LaneBits<WordCount>& outNeighbors)
+{
+	static constexpr uint64 Zeros[LaneCount] = {};
+
+	const int32 Size = masks.size;
+	for (uint8 w = 0; w < WordCount; ++w)
+	{
+		const uint64* Words = bits.words[w];
+		const uint64* LowerWords = w > 0 ? bits.words[w - 1] : Zeros;
+		const uint64* UpperWords = w + 1 < WordCount ? bits.words[w + 1] : Zeros;
+		alignas(64) uint64 neighbors[LaneCount];  // bits と outNeighbors が同じでも良いように、一旦ここに求める
+		switch (direction)
+		{
+		case 0:
+			for (uint32 l = 0; l < LaneCount; ++l)
+				neighbors[l] = FromUpper(Words[l], UpperWords[l], 1) & ~masks.lastColumn[w];
+			break;
+		case 1:
+			for (uint32 l = 0; l < LaneCount; ++l)
+				neighbors[l] = FromLower(Words[l], LowerWords[l], 1) & ~masks.firstColumn[w];
+			break;
+		case 2:
+			for (uint32 l = 0; l < LaneCount; ++l)
+				neighbors[l] = FromUpper(Words[l], UpperWords[l], Size);
+			break;
+		case 3:
+		default:
+			for (uint32 l = 0; l < LaneCount; ++l)
+				neighbors[l] = FromLower(Words[l], LowerWords[l], Size) & masks.onBoard[w];
+			break;
+		}
+		std::memcpy(outNeighbors.words[w], neighbors, sizeof(neighbors));
+	}
+}
+
+// area の点のうち、seeds の点から上下左右に辿って行ける点 (連) を、outChain に格納する (seeds のうち area にない点は含めない)
+// 辿った点が liberties の点 (呼吸点) に接したレーンは、そこで辿るのをやめ、outChain を空にする
+// つまり、呼吸点の無い連だけが残る. 多くのレーンは数点で呼吸点に接するので、連を全て辿るよりも早く終わる
+template<uint8 WordCount>
+void FloodToLiberty(const BoardMasks<WordCount>& masks, const LaneBits<WordCount>& seeds, const LaneBits<WordCount>& area, const LaneBits<WordCount>& liberties, LaneBits<WordCount>& outChain)
+{
+	// 引数どうしが同じでも良いように、手元にコピーしてから辿る (コピーは、レーン方向のループをベクトル命令にするためでもある)
+	const LaneBits<WordCount> Area = area, Liberties = liberties;
+	LaneBits<WordCount> chain, adjacent;
+
+	uint64 any = 0;
+	for (uint8 w = 0; w < WordCount; ++w)
+		for (uint32 l = 0; l < LaneCount; ++l)
+		{
+			chain.words[w][l] = seeds.words[w][l] & Area.words[w][l];
+			any |= chain.words[w][l];
+		}
+
+	while (any != 0)
+	{
+		GetAdjacent(masks, chain, adjacent);
+
+		alignas(64) uint64 touched[LaneCount] = {};
+		for (uint8 w = 0; w < WordCount; ++w)
+			for (uint32 l = 0; l < LaneCount; ++l)
+				touched[l] |= adjacent.words[w][l] & Liberties.words[w][l];
+
+		uint64 changed = 0;
+		for (uint8 w = 0; w < WordCount; ++w)
+			for (uint32 l = 0; l < LaneCount; ++l)
+			{
+				const uint64 Keep = touched[l] != 0 ? 0 : ~static_cast<uint64>(0);
+				const uint64 Grown = adjacent.words[w][l] & Area.words[w][l] & ~chain.words[w][l] & Keep;
+				chain.words[w][l] = (chain.words[w][l] | Grown) & Keep;
+				changed |= Grown;
+			}
+		any = changed;
+	}
+
+	outChain = chain;
+}
+
+// area の点のうち、seeds の点から上下左右に辿って行ける点を、outFilled に格納する (seeds のうち area にない点は含めない)
+// 全てのレーンで広がらなくなるまで、1 点ずつ広げる
+template<uint8 WordCount>
+void Flood(const BoardMasks<WordCount>& masks, const LaneBits<WordCount>& seeds, const LaneBits<WordCount>& area, LaneBits<WordCount>& outFilled)
+{
+	// 引数どうしが同じでも良いように、手元にコピーしてから広げる (コピーは、レーン方向のループをベクトル命令にするためでもある)
+	const LaneBits<WordCount> Area = area;
+	LaneBits<WordCount> filled, adjacent;
+
+	uint64 any = 0;
+	for (uint8 w = 0; w < WordCount; ++w)
+		for (uint32 l = 0; l < LaneCount; ++l)
+		{
+			filled.words[w][l] = seeds.words[w][l] & Area.words[w][l];
+			any |= filled.words[w][l];
+		}
+
+	while (any != 0)
+	{
+		GetAdjacent(masks, filled, adjacent);
+
+		uint64 changed = 0;
+		for (uint8 w = 0; w < WordCount; ++w)
+			for (uint32 l = 0; l < LaneCount; ++l)
+			{
+				const uint64 Grown = adjacent.words[w][l] & Area.words[w][l] & ~filled.words[w][l];
+				filled.words[w][l] |= Grown;
+				changed |= Grown;
+			}
+		any = changed;
+	}
+
+	outFilled = filled;
+}
+
+// 空き点 empty のうち、own にとっての眼 (1 目の真眼) を outEyes に格納する (Board::IsEye と同じ判定)
+// 上下左右が全て own の石 (または盤外) で、斜めにある opp の石が 盤の内側なら 1 個以下、盤端なら 0 個である点
+template<uint8 WordCount>
+void GetEyes(const BoardMasks<WordCount>& masks, const LaneBits<WordCount>& own, const LaneBits<WordCount>& opp, const LaneBits<WordCount>& empty, LaneBits<WordCount>& outEyes)
+{
+	static constexpr uint64 Zeros[LaneCount] = {};
+
+	const int32 Size = masks.size;
+	for (uint8 w = 0; w < WordCount; ++w)
+	{
+		const uint64* OwnLower = w > 0 ? own.words[w - 1] : Zeros;
+		const uint64* OwnUpper = w + 1 < WordCount ? own.words[w + 1] : Zeros;
+		const uint64* OppLower = w > 0 ? opp.words[w - 1] : Zeros;
+		const uint64* OppUpper = w + 1 < WordCount ? opp.words[w + 1] : Zeros;
+		alignas(64) uint64 eyes[LaneCount];  // 引数どうしが同じでも良いように、一旦ここに求める
+		for (uint32 l = 0; l < LaneCount; ++l)
+		{
+			const uint64 Own = own.words[w][l], Opp = opp.words[w][l];
+
+			// 上下左右
+			const uint64 Surrounded =
+				(FromLower(Own, OwnLower[l], Size) | masks.firstRow[w]) &
+				(FromUpper(Own, OwnUpper[l], Size) | masks.lastRow[w]) &
+				(FromLower(Own, OwnLower[l], 1) | masks.firstColumn[w]) &
+				(FromUpper(Own, OwnUpper[l], 1) | masks.lastColumn[w]);
+
+			// 斜め
+			const uint64 UpperLeft = FromLower(Opp, OppLower[l], Size + 1) & ~masks.firstColumn[w];
+			const uint64 UpperRight = FromLower(Opp, OppLower[l], Size - 1) & ~masks.lastColumn[w];
+			const uint64 LowerLeft = FromUpper(Opp, OppUpper[l], Size - 1) & ~masks.firstColumn[w];
+			const uint64 LowerRight = FromUpper(Opp, OppUpper[l], Size + 1) & ~masks.lastColumn[w];
+			const uint64 AnyOpp = UpperLeft | UpperRight | LowerLeft | LowerRight;
+			const uint64 TwoOpp =
+				(UpperLeft & (UpperRight | LowerLeft | LowerRight)) |
+				(UpperRight & (LowerLeft | LowerRight)) |
+				(LowerLeft & LowerRight);
+
+			eyes[l] = empty.words[w][l] & Surrounded & ~TwoOpp & ~(masks.edge[w] & AnyOpp);
+		}
+		std::memcpy(outEyes.words[w], eyes, sizeof(eyes));
+	}
+}
+
+// lane の bits から、一様ランダムに 1 点選び、そのインデックスを返す (点が無ければ -1)
+template<uint8 WordCount>
+int32 PickBit(const LaneBits<WordCount>& bits, uint32 lane)
+{
+	int32 count = 0;
+	for (uint8 w = 0; w < WordCount; ++w)
+		count += std::popcount(bits.words[w][lane]);
+	if (count == 0) return -1;
+
+	int32 rank = Rand::Range(0, count - 1);
+	for (uint8 w = 0; w < WordCount; ++w)
+	{
+		uint64 word = bits.words[w][lane];
+		const int32 WordBitCount = std::popcount(word);
+		if (rank >= WordBitCount)
+		{
+			rank -= WordBitCount;
+			continue;
+		}
+
+		for (; rank > 0; --rank)
+			word &= word - 1;
+		return (w << 6) + std::countr_zero(word);
+	}
+	return -1;  // ここに来ることはない
+}
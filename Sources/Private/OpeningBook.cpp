@@ -0,0 +1,178 @@
+﻿#include <OpeningBook.hpp>
+#include <Simulator.hpp>
+
+using namespace Shusaku;
+
+// 正規形での手 canonicalPos を、symmetry の逆変換で元の盤面 board に戻し、それと対称な手 (盤面が対称なら、どれを打っても対称な局面になる) のうち、
+// stone の手番で打てるものを outPos に格納する (無ければ false)
+static bool GetLegalOrientation(Stone stone, const Board& board, const Pos& canonicalPos, uint8 symmetry, Pos& outPos);
+
+bool OpeningBook::Load(const str& path)
+{
+	entries = nullptr;
+	entryCount = 0;
+	if (!file.Open(path)) return false;
+
+	// ヘッダを確かめる
+	if (file.GetSize() < sizeof(Header)) return false;
+	Header header;
+	std::memcpy(&header, file.GetData(), sizeof(Header));
+	if (header.magic != MagicValue || header.version != Version) return false;
+	if (file.GetSize() != sizeof(Header) + header.entryCount * sizeof(Entry)) return false;
+
+	boardSize = static_cast<uint8>(header.boardSize);
+	entries = reinterpret_cast<const Entry*>(file.GetData() + sizeof(Header));
+	entryCount = static_cast<autosize>(header.entryCount);
+	return true;
+}
+
+bool OpeningBook::Probe(Stone stone, const Board& board, Pos& outPos, double* outWinRate, uint32* outTryCount, uint32* outWinCount) const
+{
+	if (!IsLoaded() || board.GetSize() != boardSize) return false;
+
+	uint8 symmetry;
+	const uint64 Key = GetKey(stone, board, &symmetry);
+
+	// キーが一致するエントリの範囲を、二分探索で探す
+	const Entry* const End = entries + entryCount;
+	const Entry* it = std::lower_bound(entries, End, Key,
+		[](const Entry& entry, uint64 key) { return entry.key < key; });
+
+	// その中で、最も勝率の高い手を選ぶ (打った対局が少ない手を過大評価しないよう、1 勝 1 敗を加えて比べる)
+	bool found = false;
+	double bestWinRate = MIN_double;
+	const Entry* bestEntry = nullptr;
+	for (; it != End && it->key == Key; ++it)
+	{
+		const double WinRate = (it->winCount + 1.0) / (it->tryCount + 2.0);
+		if (WinRate <= bestWinRate) continue;
+
+		// 正規形での手 (対称な手の代表) を、元の盤面での手に戻し、打てるか確かめる
+		Pos pos;
+		if (!GetLegalOrientation(stone, board, { it->x, it->y }, symmetry, pos)) continue;
+
+		found = true;
+		bestWinRate = WinRate;
+		bestEntry = it;
+		outPos = pos;
+	}
+
+	if (found)
+	{
+		if (outWinRate) *outWinRate = bestWinRate;
+		if (outTryCount) *outTryCount = bestEntry->tryCount;
+		if (outWinCount) *outWinCount = bestEntry->winCount;
+	}
+	return found;
+}
+
+uint64 OpeningBook::GetKey(Stone stone, const Board& board, uint8* outSymmetry)
+{
+	const uint64 TurnKey = stone == Stone::White ? Zobrist::GetWhiteTurnKey() : 0;
+	return board.GetCanonicalHash(outSymmetry) ^ TurnKey;
+}
+
+bool OpeningBook::Generate(const str& path, BoardSize boardSize, uint32 gameCount, uint16 bookMoveCount, uint32 minTryCount, const SimulatorOptions& options)
+{
+	// 自己対局の最中は、作り直す前の定石を使わない
+	SimulatorOptions selfPlayOptions = options;
+	selfPlayOptions.openingBook = nullptr;
+
+	OpeningBookBuilder builder;
+	for (uint32 g = 0; g < gameCount; ++g)
+	{
+		Board board = Board::Create(boardSize);
+		Stone turn = Stone::Black;
+
+		// 最初の bookMoveCount 手は、しっかり考えて打つ (試行の乱数によって、対局ごとに手が変わる)
+		for (uint16 m = 0; m < bookMoveCount; ++m)
+		{
+			const Pos nextPos = Simulator::Think(turn, board, selfPlayOptions);
+			if (nextPos == Pos(0, 0) || !board.PutStone(nextPos, turn)) break;
+			turn = ReverseStone(turn);
+		}
+
+		// 残りは、終局まで試行して、勝敗だけ決める
+		const Stone Win = Simulator::__Try(turn, board, selfPlayOptions);
+		builder.AddGame(boardSize, board.GetHistory(), Win, bookMoveCount);
+	}
+
+	return builder.Write(path, minTryCount);
+}
+
+void OpeningBookBuilder::AddGame(BoardSize boardSize, const vec<PosStone>& history, Stone winner, uint16 maxMoveCount)
+{
+	if (!hasBoardSize)
+	{
+		this->boardSize = boardSize;
+		hasBoardSize = true;
+	}
+	if (boardSize != this->boardSize) return;
+
+	// 棋譜を並べ直しながら、各局面で打たれた手を集計する
+	Board board = Board::Create(boardSize);
+	const uint8 Size = board.GetSize();
+	for (autosize i = 0; i < history.size() && i < maxMoveCount; ++i)
+	{
+		const PosStone& move = history[i];
+
+		uint8 symmetry;
+		const uint64 Key = OpeningBook::GetKey(move.stone, board, &symmetry);
+		// 盤面が対称なら、対称な手は同じ手 (正規形の盤面の上での代表) として集計する
+		const Pos CanonicalPos = Symmetry::GetCanonicalRepresentative(move.pos, Size, symmetry, board.GetSymmetryMask());
+
+		std::pair<uint32, uint32>& result = results[{ Key, { CanonicalPos.x, CanonicalPos.y } }];
+		++result.first;
+		if (move.stone == winner) ++result.second;
+
+		if (!board.PutStone(move.pos, move.stone)) break;
+	}
+}
+
+bool OpeningBookBuilder::Write(const str& path, uint32 minTryCount) const
+{
+	vec<OpeningBook::Entry> entries;
+	entries.reserve(results.size());
+	for (const auto& [keyAndPos, result] : results)
+	{
+		if (result.first < minTryCount) continue;
+
+		OpeningBook::Entry entry{};
+		entry.key = keyAndPos.first;
+		entry.x = keyAndPos.second.first;
+		entry.y = keyAndPos.second.second;
+		entry.tryCount = result.first;
+		entry.winCount = result.second;
+		entries.push_back(entry);
+	}
+
+	OpeningBook::Header header{};
+	header.magic = OpeningBook::MagicValue;
+	header.version = OpeningBook::Version;
+	header.boardSize = hasBoardSize ? Board::Create(boardSize).GetSize() : 0;
+	header.entryCount = entries.size();
+
+	std::ofstream ofs(path, std::ios::binary);
+	if (!ofs) return false;
+	ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	ofs.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(OpeningBook::Entry)));
+	return static_cast<bool>(ofs);
+}
+
+static bool GetLegalOrientation(Stone stone, const Board& board, const Pos& canonicalPos, uint8 symmetry, Pos& outPos)
+{
+	const uint8 Size = board.GetSize();
+	const Pos Original = Symmetry::InverseTransform(canonicalPos, Size, symmetry);
+	const uint8 SymmetryMask = board.GetSymmetryMask();
+	for (uint8 s = 0; s < Symmetry::Count; ++s)
+	{
+		if (!(SymmetryMask & (1 << s))) continue;
+
+		const Pos pos = Symmetry::Transform(Original, Size, s);
+		if (!board.IsLegal(pos, stone)) continue;
+
+		outPos = pos;
+		return true;
+	}
+	return false;
+}
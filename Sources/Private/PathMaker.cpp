@@ -27,7 +27,7 @@ str PathMaker::CreateWithDatetime(const str& rawPath, const str& identifier)
 #ifdef _WIN32
 	localtime_s(&localTm, &nowTime);
 #else
-	localtime_r(&now_time, &local_tm);
+	localtime_r(&nowTime, &localTm);
 #endif
 
 	std::ostringstream oss;
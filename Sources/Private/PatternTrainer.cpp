@@ -0,0 +1,332 @@
+﻿#include <PatternTrainer.hpp>
+#include <GameAnalyzer.hpp>
+
+using namespace Shusaku;
+
+// 特徴のグループ (各候補手は、グループごとにちょうど 1 つの特徴を持つ)
+// 3x3 パターン・直前の着手からの距離の区分・石取りの有無・アタリの有無・自らアタリの有無
+static constexpr uint8 GroupCount = 5;
+
+// 1 つの候補手の特徴
+struct MoveFeatures final
+{
+	uint16 pattern;  // 正規形の 3x3 パターンの、学習用の番号
+	uint8 distanceBucket;  // PatternWeights::GetDistanceBucket
+	uint8 flags;  // bit0: 石取り, bit1: アタリ, bit2: 自らアタリ
+};
+
+// 1 つの局面 (candidates の [begin, end) が候補手で、played が実際に打たれた手)
+struct TrainingPosition final
+{
+	autosize begin;
+	autosize end;
+	autosize played;
+};
+
+// 学習に使う全ての局面
+struct TrainingSet final
+{
+	vec<MoveFeatures> candidates;
+	vec<TrainingPosition> positions;
+};
+
+// 特徴の番号付け
+// 3x3 パターンは、正規形だけに番号を付ける. 他のグループは、その後ろに並べる
+struct FeatureLayout final
+{
+	vec<uint16> patternFeatures;  // コード (黒番から見たもの) から、そのパターンの番号
+	vec<uint16> patternCodes;  // パターンの番号から、正規形のコード
+	arr<uint32, GroupCount> offsets{};  // グループの先頭の番号
+	uint32 featureCount = 0;
+
+	// 候補手 move の、グループ group の特徴の番号
+	inline uint32 GetFeature(const MoveFeatures& move, uint8 group) const
+	{
+		switch (group)
+		{
+		case 0: return move.pattern;
+		case 1: return offsets[1] + move.distanceBucket;
+		default: return offsets[group] + ((move.flags >> (group - 2)) & 1);
+		}
+	}
+};
+
+static FeatureLayout CreateLayout();
+static void ExtractGame(BoardSize boardSize, const vec<PosStone>& history, const FeatureLayout& layout, TrainingSet& outSet);
+static MoveFeatures GetMoveFeatures(const Board& board, const Pos& pos, Stone stone, const Pos& lastPos, const FeatureLayout& layout);
+static double UpdateGroup(const TrainingSet& set, const FeatureLayout& layout, uint8 group, uint32 threadCount, vec<double>& gammas);
+
+bool PatternTrainer::Train(const vec<str>& gamePaths, BoardSize boardSize, const str& outputPath, uint32 iterationCount, uint32 threadCount, std::ostream* progress)
+{
+	const FeatureLayout Layout = CreateLayout();
+	if (threadCount == 0) threadCount = std::max<uint32>(std::thread::hardware_concurrency(), 1);
+	const uint32 WorkerCount = static_cast<uint32>(std::min<autosize>(threadCount, std::max<autosize>(gamePaths.size(), 1)));
+
+	// 棋譜を 1 局ずつ読み、特徴を抜き出す (棋譜はスレッドごとに読み捨てる)
+	vec<TrainingSet> sets(WorkerCount);
+	std::atomic<autosize> nextGame = 0;
+	{
+		vec<std::future<void>> futures;
+		futures.reserve(WorkerCount);
+		for (uint32 w = 0; w < WorkerCount; ++w)
+		{
+			futures.emplace_back(std::async(std::launch::async,
+				[&, w]()
+				{
+					vec<PosStone> history;
+					for (autosize g = nextGame++; g < gamePaths.size(); g = nextGame++)
+					{
+						BoardSize gameBoardSize = boardSize;
+						if (!GameAnalyzer::LoadGame(gamePaths[g], history, &gameBoardSize)) continue;
+						ExtractGame(gameBoardSize, history, Layout, sets[w]);
+					}
+				}
+			));
+		}
+		for (auto& future : futures)
+			future.get();
+	}
+
+	// スレッドごとの局面を、1 つにまとめる
+	TrainingSet set;
+	for (TrainingSet& part : sets)
+	{
+		const autosize Offset = set.candidates.size();
+		set.candidates.insert(set.candidates.end(), part.candidates.begin(), part.candidates.end());
+		for (const TrainingPosition& Position : part.positions)
+			set.positions.push_back({ Position.begin + Offset, Position.end + Offset, Position.played + Offset });
+		part = {};
+	}
+	if (set.positions.empty()) return false;
+
+	if (progress)
+		*progress << "Positions " << set.positions.size() << ", candidates " << set.candidates.size() << std::endl;
+
+	// MM 法で、グループごとに順に強さを更新する
+	vec<double> gammas(Layout.featureCount, 1.0);
+	for (uint32 i = 0; i < iterationCount; ++i)
+	{
+		double logLikelihood = 0.0;
+		for (uint8 group = 0; group < GroupCount; ++group)
+		{
+			const double GroupLogLikelihood = UpdateGroup(set, Layout, group, threadCount, gammas);
+			if (group == 0) logLikelihood = GroupLogLikelihood;
+		}
+
+		if (progress)
+			*progress << "Iteration " << (i + 1) << ": log-likelihood per move " << std::fixed << std::setprecision(4) << logLikelihood / set.positions.size() << std::endl;
+	}
+
+	// 重みファイルに書き出す (距離・石取り・アタリ・自らアタリは、それが無い場合に対する比)
+	vec<double> patternGammas(Pattern3x3::CodeCount, 0.0);
+	for (autosize f = 0; f < Layout.patternCodes.size(); ++f)
+		patternGammas[Layout.patternCodes[f]] = gammas[f];
+
+	PatternWeights::Header header{};
+	for (uint8 b = 0; b < PatternWeights::DistanceBucketCount; ++b)
+		header.distanceGammas[b] = static_cast<float>(gammas[Layout.offsets[1] + b] / gammas[Layout.offsets[1]]);
+	header.captureGamma = static_cast<float>(gammas[Layout.offsets[2] + 1] / gammas[Layout.offsets[2]]);
+	header.atariGamma = static_cast<float>(gammas[Layout.offsets[3] + 1] / gammas[Layout.offsets[3]]);
+	header.selfAtariGamma = static_cast<float>(gammas[Layout.offsets[4] + 1] / gammas[Layout.offsets[4]]);
+
+	if (progress)
+	{
+		*progress << "Distance";
+		for (const float Gamma : header.distanceGammas) *progress << " " << Gamma;
+		*progress << ", capture " << header.captureGamma << ", atari " << header.atariGamma << ", self-atari " << header.selfAtariGamma << std::endl;
+	}
+
+	return PatternWeights::Write(outputPath, patternGammas, header);
+}
+
+// 特徴の番号付けを作る
+FeatureLayout CreateLayout()
+{
+	FeatureLayout layout;
+	layout.patternFeatures.assign(Pattern3x3::CodeCount, 0);
+
+	vec<int32> canonicalFeatures(Pattern3x3::CodeCount, -1);
+	for (autosize i = 0; i < Pattern3x3::CodeCount; ++i)
+	{
+		const uint16 Canonical = Pattern3x3::GetCanonical(static_cast<uint16>(i));
+		if (canonicalFeatures[Canonical] < 0)
+		{
+			canonicalFeatures[Canonical] = static_cast<int32>(layout.patternCodes.size());
+			layout.patternCodes.push_back(Canonical);
+		}
+		layout.patternFeatures[i] = static_cast<uint16>(canonicalFeatures[Canonical]);
+	}
+
+	// 距離の区分は 4 つ、有無の特徴は 2 つずつ
+	layout.offsets[0] = 0;
+	layout.offsets[1] = static_cast<uint32>(layout.patternCodes.size());
+	layout.offsets[2] = layout.offsets[1] + PatternWeights::DistanceBucketCount;
+	layout.offsets[3] = layout.offsets[2] + 2;
+	layout.offsets[4] = layout.offsets[3] + 2;
+	layout.featureCount = layout.offsets[4] + 2;
+	return layout;
+}
+
+// 1 局分の棋譜 history を並べ直しながら、各局面の候補手の特徴を outSet に加える
+// 候補手は、自分の眼を潰す手を除いた、全ての合法手
+// 実際に打たれた手が候補手に無い局面 (自分の眼を潰した手など) は加えない. 打てない手があったら、そこで止める
+void ExtractGame(BoardSize boardSize, const vec<PosStone>& history, const FeatureLayout& layout, TrainingSet& outSet)
+{
+	Board board = Board::Create(boardSize);
+	const uint8 Size = board.GetSize();
+
+	for (autosize i = 0; i < history.size(); ++i)
+	{
+		const PosStone& Move = history[i];
+
+		// 直前の着手 (同じ手番が続いているなら、間にパスがあったので、直前の着手は無い)
+		const Pos LastPos = i > 0 && history[i - 1].stone != Move.stone ? history[i - 1].pos : Pos(0, 0);
+
+		TrainingPosition position{ outSet.candidates.size(), 0, 0 };
+		bool hasPlayed = false;
+		for (uint8 y = 1; y <= Size; ++y)
+			for (uint8 x = 1; x <= Size; ++x)
+			{
+				if (!board.IsLegal(x, y, Move.stone) || board.IsEye(x, y, Move.stone)) continue;
+
+				if (Pos(x, y) == Move.pos)
+				{
+					position.played = outSet.candidates.size();
+					hasPlayed = true;
+				}
+				outSet.candidates.push_back(GetMoveFeatures(board, { x, y }, Move.stone, LastPos, layout));
+			}
+
+		position.end = outSet.candidates.size();
+		if (hasPlayed && position.end - position.begin > 1) outSet.positions.push_back(position);
+		else outSet.candidates.resize(position.begin);
+
+		if (!board.PutStone(Move.pos, Move.stone)) break;
+	}
+}
+
+// stone の手番で、pos (合法手) に打つ手の特徴を求める
+MoveFeatures GetMoveFeatures(const Board& board, const Pos& pos, Stone stone, const Pos& lastPos, const FeatureLayout& layout)
+{
+	MoveFeatures features{};
+
+	const uint16 Code = board.GetPattern(pos);
+	features.pattern = layout.patternFeatures[stone == Stone::White ? Pattern3x3::SwapColors(Code) : Code];
+	features.distanceBucket = PatternWeights::GetDistanceBucket(pos, lastPos);
+
+	// 上下左右の連の呼吸点を調べる
+	// 着手した後の自分の連の呼吸点 (pos を除く) は、2 つ見つかれば十分
+	bool isCapture = false, isAtari = false;
+	vec<Pos> liberties;
+	arr<Pos, 2> ownLiberties;
+	uint8 ownLibertyCount = 0;
+	const auto AddOwnLiberty = [&ownLiberties, &ownLibertyCount, &pos](const Pos& liberty)
+		{
+			if (liberty == pos || ownLibertyCount >= 2) return;
+			for (uint8 i = 0; i < ownLibertyCount; ++i)
+				if (ownLiberties[i] == liberty) return;
+			ownLiberties[ownLibertyCount++] = liberty;
+		};
+
+	arr<Pos, 4> neighbors;
+	const uint8 NeighborCount = board.GetNeighbors(pos, neighbors);
+	for (uint8 n = 0; n < NeighborCount; ++n)
+	{
+		const Stone NeighborStone = board.GetStone(neighbors[n]);
+		if (NeighborStone == Stone::Empty)
+			AddOwnLiberty(neighbors[n]);
+		else if (NeighborStone == stone)
+		{
+			board.GetLiberties(neighbors[n], liberties, 3);
+			for (const Pos& Liberty : liberties)
+				AddOwnLiberty(Liberty);
+		}
+		else
+		{
+			// 相手の連の呼吸点が pos だけなら取れ、pos を含めて 2 つならアタリになる
+			const uint16 LibertyCount = board.GetLiberties(neighbors[n], liberties, 3);
+			if (LibertyCount == 1) isCapture = true;
+			else if (LibertyCount == 2) isAtari = true;
+		}
+	}
+
+	const bool IsSelfAtari = !isCapture && ownLibertyCount <= 1;
+	features.flags = static_cast<uint8>((isCapture ? 1 : 0) | (isAtari ? 2 : 0) | (IsSelfAtari ? 4 : 0));
+	return features;
+}
+
+// MM 法で、グループ group の特徴の強さを 1 回更新する
+// 各特徴 i の強さは、(打たれた手が i を持っていた回数 + 1) / (Σ_局面 (i を持つ候補手の強さ / i の強さ) / (候補手の強さの合計) + 2 / (i の強さ + 1)) にする
+// 分子・分母の 1, 2 / (強さ + 1) は、強さ 1 の仮想の相手に 1 勝 1 敗したとする事前分布で、一度も現れない特徴の強さを 1 に保つ
+// 更新前の強さでの、打たれた手の対数尤度の合計を返す
+// 距離の区分 0 と、有無の特徴の「無い」方は、基準として 1 のまま更新しない
+double UpdateGroup(const TrainingSet& set, const FeatureLayout& layout, uint8 group, uint32 threadCount, vec<double>& gammas)
+{
+	const uint32 WorkerCount = static_cast<uint32>(std::min<autosize>(threadCount, set.positions.size()));
+	vec<vec<double>> denominators(WorkerCount, vec<double>(layout.featureCount, 0.0));
+	vec<vec<double>> wins(WorkerCount, vec<double>(layout.featureCount, 0.0));
+	vec<double> logLikelihoods(WorkerCount, 0.0);
+
+	// 局面を、スレッドの数で等分して集計する
+	vec<std::future<void>> futures;
+	futures.reserve(WorkerCount);
+	for (uint32 w = 0; w < WorkerCount; ++w)
+	{
+		futures.emplace_back(std::async(std::launch::async,
+			[&, w]()
+			{
+				vec<double>& denominator = denominators[w];
+				vec<double>& win = wins[w];
+				const autosize Begin = set.positions.size() * w / WorkerCount;
+				const autosize End = set.positions.size() * (w + 1) / WorkerCount;
+
+				vec<double> strengths;
+				for (autosize p = Begin; p < End; ++p)
+				{
+					const TrainingPosition& Position = set.positions[p];
+
+					// 候補手の強さは、グループごとの特徴の強さの積
+					strengths.resize(Position.end - Position.begin);
+					double total = 0.0;
+					for (autosize c = Position.begin; c < Position.end; ++c)
+					{
+						double strength = 1.0;
+						for (uint8 g = 0; g < GroupCount; ++g)
+							strength *= gammas[layout.GetFeature(set.candidates[c], g)];
+						strengths[c - Position.begin] = strength;
+						total += strength;
+					}
+
+					logLikelihoods[w] += std::log(strengths[Position.played - Position.begin] / total);
+					win[layout.GetFeature(set.candidates[Position.played], group)] += 1.0;
+					for (autosize c = Position.begin; c < Position.end; ++c)
+					{
+						const uint32 Feature = layout.GetFeature(set.candidates[c], group);
+						denominator[Feature] += strengths[c - Position.begin] / gammas[Feature] / total;
+					}
+				}
+			}
+		));
+	}
+	for (auto& future : futures)
+		future.get();
+
+	// スレッドごとの集計を足し合わせ、強さを更新する
+	const uint32 First = group == 0 ? 0 : layout.offsets[group] + 1;
+	const uint32 End = group + 1 < GroupCount ? layout.offsets[group + 1] : layout.featureCount;
+	for (uint32 f = First; f < End; ++f)
+	{
+		double win = 1.0, denominator = 2.0 / (gammas[f] + 1.0);
+		for (uint32 w = 0; w < WorkerCount; ++w)
+		{
+			win += wins[w][f];
+			denominator += denominators[w][f];
+		}
+		gammas[f] = win / denominator;
+	}
+
+	double logLikelihood = 0.0;
+	for (const double Value : logLikelihoods)
+		logLikelihood += Value;
+	return logLikelihood;
+}
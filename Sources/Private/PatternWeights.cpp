@@ -0,0 +1,55 @@
+﻿#include <PatternWeights.hpp>
+
+using namespace Shusaku;
+
+bool PatternWeights::Load(const str& path)
+{
+	weights = nullptr;
+	if (!file.Open(path)) return false;
+
+	// ヘッダを確かめる
+	if (file.GetSize() < sizeof(Header)) return false;
+	std::memcpy(&header, file.GetData(), sizeof(Header));
+	if (header.magic != MagicValue || header.version != Version || header.codeCount != Pattern3x3::CodeCount) return false;
+	if (file.GetSize() != sizeof(Header) + Pattern3x3::CodeCount * sizeof(uint16)) return false;
+
+	weights = reinterpret_cast<const uint16*>(file.GetData() + sizeof(Header));
+	return true;
+}
+
+bool PatternWeights::Write(const str& path, const vec<double>& patternGammas, const Header& gammas)
+{
+	if (patternGammas.size() != Pattern3x3::CodeCount) return false;
+
+	double maxGamma = 0.0;
+	for (const double Gamma : patternGammas)
+		maxGamma = std::max(maxGamma, Gamma);
+	if (maxGamma <= 0.0) return false;
+
+	// 黒番から見た全てのコードについて、正規形の強さを引いて丸める
+	// 自分の眼は、Pattern3x3 の重みと同じく 0 にする (Board::IsEye と同じ判定)
+	vec<uint16> table(Pattern3x3::CodeCount);
+	for (autosize i = 0; i < Pattern3x3::CodeCount; ++i)
+	{
+		const uint16 Code = static_cast<uint16>(i);
+		if (Pattern3x3::GetWeight(Code, Stone::Black) == 0)
+		{
+			table[i] = 0;
+			continue;
+		}
+
+		const double Scaled = patternGammas[Pattern3x3::GetCanonical(Code)] / maxGamma * MAX_uint16;
+		table[i] = static_cast<uint16>(std::clamp(std::round(Scaled), 1.0, static_cast<double>(MAX_uint16)));
+	}
+
+	Header header = gammas;
+	header.magic = MagicValue;
+	header.version = Version;
+	header.codeCount = Pattern3x3::CodeCount;
+
+	std::ofstream ofs(path, std::ios::binary);
+	if (!ofs) return false;
+	ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	ofs.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(table.size() * sizeof(uint16)));
+	return static_cast<bool>(ofs);
+}
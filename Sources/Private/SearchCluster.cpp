@@ -0,0 +1,431 @@
+﻿#include <SearchCluster.hpp>
+#include <EvalCache.hpp>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+using namespace Shusaku;
+
+// コーディネーターとワーカーの間でやり取りするメッセージの種類
+// メッセージは、ヘッダ (種類と本体のバイト数) と本体からなる
+enum class MessageType : uint32
+{
+	Search = 1,  // コーディネーター -> ワーカー : 盤面 (棋譜) と試行回数を渡して、探索を指示する
+	Stats = 2,  // ワーカー -> コーディネーター : 1 ラウンド分の集計結果
+	Quit = 3,  // コーディネーター -> ワーカー : 終了を指示する
+};
+
+struct MessageHeader final
+{
+	MessageType type;
+	uint32 size;
+};
+
+static Board CreateBoard(uint8 size);
+static void WriteSearchMessage(Stone stone, const Board& board, uint32 roundCount, uint64 tryCount, bool withOwnership, vec<uint8>& outPayload);
+static bool ReadSearchMessage(const vec<uint8>& payload, Stone& outStone, vec<Board>& outBoard, uint32& outRoundCount, uint64& outTryCount, bool& outWithOwnership);
+static void WriteStatsMessage(const RootStats& stats, vec<uint8>& outPayload);
+static bool ReadStatsMessage(const vec<uint8>& payload, RootStats& outStats);
+template <typename T>
+static void Write(vec<uint8>& buffer, const T& value);
+template <typename T>
+static bool Read(const vec<uint8>& buffer, autosize& offset, T& outValue);
+#ifndef _WIN32
+static bool SendAll(int32 socket, const void* data, autosize size);
+static bool ReceiveAll(int32 socket, void* data, autosize size);
+static bool SendMessage(int32 socket, MessageType type, const vec<uint8>& payload);
+static bool ReceiveMessage(int32 socket, MessageType& outType, vec<uint8>& outPayload);
+#endif
+
+SearchCluster::SearchCluster(const SearchClusterOptions& clusterOptions, const SimulatorOptions& simulatorOptions)
+	: clusterOptions(clusterOptions), simulatorOptions(simulatorOptions)
+{
+	if (!IsSupported() || clusterOptions.workerCount == 0) return;
+
+#ifndef _WIN32
+	// ワーカーからの接続を待ち受けるまでの時間 (ms)
+	constexpr int32 AcceptTimeout = 10000;
+
+	const uint32 WorkerCount = clusterOptions.workerCount;
+
+	// コーディネーターのソケットを作り、ワーカーからの接続を待ち受ける
+	const str SocketPath = "/tmp/Shusaku_" + std::to_string(getpid()) + ".sock";
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	if (SocketPath.size() >= sizeof(address.sun_path)) return;
+	std::memcpy(address.sun_path, SocketPath.c_str(), SocketPath.size() + 1);
+
+	const int32 ListenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (ListenSocket < 0) return;
+	unlink(SocketPath.c_str());
+	if (bind(ListenSocket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+		|| listen(ListenSocket, static_cast<int32>(WorkerCount)) != 0)
+	{
+		close(ListenSocket);
+		return;
+	}
+
+	// ワーカーを立てる
+	// 固定しない場合は、CPU を取り合わないように、ハードウェアのスレッドをワーカーの数で等分する
+	const uint32 HardwareThreads = std::max<uint32>(std::thread::hardware_concurrency(), 1);
+	for (uint32 w = 0; w < WorkerCount; ++w)
+	{
+		const pid_t Pid = fork();
+		if (Pid < 0) break;
+		if (Pid == 0)
+		{
+			close(ListenSocket);
+
+			// CPU の番号が指定されていればそれを、無ければこのプロセスが使える CPU を等分して、このワーカーに割り当てる
+			// 番号が指定されている場合は、ワーカーの中の各スレッドも、割り当てた CPU に 1 つずつ固定する
+			SimulatorOptions workerOptions = simulatorOptions;
+			const vec<uint32> Cpus = CpuAffinity::GetShare(simulatorOptions.cpus.empty() ? CpuAffinity::GetAvailableCpus() : simulatorOptions.cpus, w, WorkerCount);
+			const bool IsPinned = clusterOptions.pinWorkers && CpuAffinity::PinCurrentThread(Cpus);
+			workerOptions.cpus = IsPinned && !simulatorOptions.cpus.empty() ? Cpus : vec<uint32>{};
+			workerOptions.evalCache = nullptr;  // 評価キャッシュは、足し合わせた結果を、このプロセスで読み書きする
+			if (workerOptions.threadCount == 0)
+				workerOptions.threadCount = IsPinned ? static_cast<uint32>(Cpus.size()) : std::max<uint32>(HardwareThreads / WorkerCount, 1);
+
+			RunWorker(SocketPath, workerOptions);
+			_exit(0);
+		}
+		workerPids.push_back(Pid);
+	}
+
+	// 立てたワーカーからの接続を受け付ける
+	for (autosize i = 0; i < workerPids.size(); ++i)
+	{
+		pollfd listenPoll{ ListenSocket, POLLIN, 0 };
+		if (poll(&listenPoll, 1, AcceptTimeout) <= 0) break;
+
+		const int32 WorkerSocket = accept(ListenSocket, nullptr, nullptr);
+		if (WorkerSocket < 0) break;
+		workerSockets.push_back(WorkerSocket);
+	}
+
+	// 全員繋がったので、待ち受けは終わり
+	close(ListenSocket);
+	unlink(SocketPath.c_str());
+#endif
+}
+
+SearchCluster::~SearchCluster()
+{
+	StopWorkers();
+}
+
+bool SearchCluster::IsSupported()
+{
+#ifdef _WIN32
+	return false;
+#else
+	return true;
+#endif
+}
+
+Pos SearchCluster::Think(Stone stone, const Board& board, double* outWinRate, vec<double>* outOwnership, std::pair<double, double>* outConfidenceInterval)
+{
+	TRACE_SCOPE("SearchCluster::Think");
+
+#ifndef _WIN32
+	// 定石・終盤の読み切りで決められるなら、ワーカーに頼まず、このプロセスで決める
+	Pos shortcutPos;
+	if (!workerSockets.empty() && Simulator::TryThinkWithoutSearch(stone, board, simulatorOptions, shortcutPos, outWinRate, outOwnership, outConfidenceInterval))
+		return shortcutPos;
+
+	if (!workerSockets.empty())
+	{
+		const uint32 RoundCount = std::max<uint32>(clusterOptions.roundCount, 1);
+		const uint64 TryCount = std::max<uint64>(Simulator::GetThinkCount(simulatorOptions) / RoundCount, 1);
+
+		// 全てのワーカーに、同じ盤面の探索を指示する
+		vec<uint8> payload;
+		WriteSearchMessage(stone, board, RoundCount, TryCount, outOwnership != nullptr, payload);
+		for (int32& workerSocket : workerSockets)
+			if (!SendMessage(workerSocket, MessageType::Search, payload))
+			{
+				close(workerSocket);
+				workerSocket = -1;
+			}
+
+		// 各ワーカーから、ラウンドごとの集計結果を受け取り、足し合わせる
+		// 評価キャッシュに前回までの成績があれば、それに足し合わせる
+		RootStats stats, roundStats;
+		stats.Reset(board.GetPositionsCount(), outOwnership != nullptr);
+		if (simulatorOptions.evalCache) simulatorOptions.evalCache->WarmStart(stone, board, stats);
+		vec<uint32> receivedRounds(workerSockets.size(), 0);
+		vec<pollfd> polls;
+		while (true)
+		{
+			polls.clear();
+			for (autosize w = 0; w < workerSockets.size(); ++w)
+				if (workerSockets[w] >= 0 && receivedRounds[w] < RoundCount)
+					polls.push_back({ workerSockets[w], POLLIN, 0 });
+			if (polls.empty()) break;
+
+			if (poll(polls.data(), polls.size(), -1) < 0) break;
+
+			for (const pollfd& workerPoll : polls)
+			{
+				if (workerPoll.revents == 0) continue;
+
+				const autosize W = std::find(workerSockets.begin(), workerSockets.end(), workerPoll.fd) - workerSockets.begin();
+				MessageType type;
+				if (!ReceiveMessage(workerPoll.fd, type, payload) || type != MessageType::Stats || !ReadStatsMessage(payload, roundStats))
+				{
+					// ワーカーが落ちたので、以降は使わない (それまでの集計結果はそのまま使う)
+					close(workerPoll.fd);
+					workerSockets[W] = -1;
+					continue;
+				}
+
+				stats.Merge(roundStats);
+				++receivedRounds[W];
+			}
+		}
+
+		// 落ちたワーカーを取り除く
+		workerSockets.erase(std::remove(workerSockets.begin(), workerSockets.end(), -1), workerSockets.end());
+
+		if (stats.totalTryCount > 0)
+		{
+			if (simulatorOptions.evalCache) simulatorOptions.evalCache->Store(stone, board, stats);
+			return Simulator::SelectBest(stone, board, simulatorOptions, stats, outWinRate, outOwnership, outConfidenceInterval);
+		}
+	}
+#endif
+
+	// ワーカーがいないので、このプロセスで考える
+	return Simulator::Think(stone, board, simulatorOptions, outWinRate, outOwnership, outConfidenceInterval);
+}
+
+void SearchCluster::RunWorker(UNUSED const str& socketPath, UNUSED const SimulatorOptions& options)
+{
+#ifndef _WIN32
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	if (socketPath.size() >= sizeof(address.sun_path)) return;
+	std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+	const int32 Socket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (Socket < 0) return;
+	if (connect(Socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+	{
+		close(Socket);
+		return;
+	}
+
+	vec<uint8> payload;
+	vec<Board> boards;  // Board はデフォルト構築できないので、vec に入れて受け取る
+	RootStats stats;
+	while (true)
+	{
+		MessageType type;
+		if (!ReceiveMessage(Socket, type, payload) || type != MessageType::Search) break;
+
+		Stone stone;
+		uint32 roundCount;
+		uint64 tryCount;
+		bool withOwnership;
+		if (!ReadSearchMessage(payload, stone, boards, roundCount, tryCount, withOwnership)) break;
+
+		// ラウンドごとに探索して、その集計結果を送る
+		bool sent = true;
+		for (uint32 r = 0; r < roundCount && sent; ++r)
+		{
+			stats.Reset(boards[0].GetPositionsCount(), withOwnership);
+			Simulator::Search(stone, boards[0], options, tryCount, stats);
+
+			WriteStatsMessage(stats, payload);
+			sent = SendMessage(Socket, MessageType::Stats, payload);
+		}
+		if (!sent) break;
+	}
+
+	close(Socket);
+#endif
+}
+
+void SearchCluster::StopWorkers()
+{
+#ifndef _WIN32
+	for (const int32 WorkerSocket : workerSockets)
+	{
+		SendMessage(WorkerSocket, MessageType::Quit, {});
+		close(WorkerSocket);
+	}
+	workerSockets.clear();
+
+	for (const int32 Pid : workerPids)
+		waitpid(Pid, nullptr, 0);
+	workerPids.clear();
+#endif
+}
+
+// 一辺が size の、空の盤面を作る
+Board CreateBoard(uint8 size)
+{
+	switch (size)
+	{
+	case 13: return Board::Create13x13();
+	case 19: return Board::Create19x19();
+	case 9:
+	default: return Board::Create9x9();
+	}
+}
+
+// 探索の指示 : 手番, ラウンド数, 1 ラウンドの試行回数, 帰属を集計するか, 盤面の一辺, 棋譜の手数, 棋譜 (x, y, 石)
+// 盤面は棋譜から並べ直すので、直前の着手・同形反復の判定も、コーディネーターと同じになる
+void WriteSearchMessage(Stone stone, const Board& board, uint32 roundCount, uint64 tryCount, bool withOwnership, vec<uint8>& outPayload)
+{
+	const vec<PosStone>& History = board.GetHistory();
+
+	outPayload.clear();
+	Write(outPayload, static_cast<uint8>(stone));
+	Write(outPayload, roundCount);
+	Write(outPayload, tryCount);
+	Write(outPayload, static_cast<uint8>(withOwnership));
+	Write(outPayload, board.GetSize());
+	Write(outPayload, static_cast<uint32>(History.size()));
+	for (const PosStone& move : History)
+	{
+		Write(outPayload, move.pos.x);
+		Write(outPayload, move.pos.y);
+		Write(outPayload, static_cast<uint8>(move.stone));
+	}
+}
+
+bool ReadSearchMessage(const vec<uint8>& payload, Stone& outStone, vec<Board>& outBoard, uint32& outRoundCount, uint64& outTryCount, bool& outWithOwnership)
+{
+	autosize offset = 0;
+	uint8 stone, withOwnership, size;
+	uint32 historyCount;
+	if (!Read(payload, offset, stone) || !Read(payload, offset, outRoundCount) || !Read(payload, offset, outTryCount)
+		|| !Read(payload, offset, withOwnership) || !Read(payload, offset, size) || !Read(payload, offset, historyCount))
+		return false;
+	outStone = static_cast<Stone>(stone);
+	outWithOwnership = withOwnership != 0;
+
+	outBoard.clear();
+	outBoard.push_back(CreateBoard(size));
+	for (uint32 i = 0; i < historyCount; ++i)
+	{
+		uint8 x, y, moveStone;
+		if (!Read(payload, offset, x) || !Read(payload, offset, y) || !Read(payload, offset, moveStone)) return false;
+		if (!outBoard[0].PutStone(x, y, static_cast<Stone>(moveStone))) return false;
+	}
+	return true;
+}
+
+// 集計結果 : 点の数, 全ての試行回数, 試行で打った手の数, 打ち切った試行の回数, 各点の (試行回数, 勝った回数), 帰属の数, 各点の帰属
+void WriteStatsMessage(const RootStats& stats, vec<uint8>& outPayload)
+{
+	outPayload.clear();
+	Write(outPayload, static_cast<uint32>(stats.tryCounts.size()));
+	Write(outPayload, stats.totalTryCount);
+	Write(outPayload, stats.playoutMoveCount);
+	Write(outPayload, stats.mercyTryCount);
+	for (autosize i = 0; i < stats.tryCounts.size(); ++i)
+	{
+		Write(outPayload, stats.tryCounts[i]);
+		Write(outPayload, stats.winCounts[i]);
+	}
+	Write(outPayload, static_cast<uint32>(stats.ownershipCounts.size()));
+	for (const int64 OwnershipCount : stats.ownershipCounts)
+		Write(outPayload, OwnershipCount);
+}
+
+bool ReadStatsMessage(const vec<uint8>& payload, RootStats& outStats)
+{
+	autosize offset = 0;
+	uint32 positionsCount, ownershipCount;
+	if (!Read(payload, offset, positionsCount)) return false;
+
+	outStats.tryCounts.resize(positionsCount);
+	outStats.winCounts.resize(positionsCount);
+	if (!Read(payload, offset, outStats.totalTryCount) || !Read(payload, offset, outStats.playoutMoveCount) || !Read(payload, offset, outStats.mercyTryCount)) return false;
+	for (uint32 i = 0; i < positionsCount; ++i)
+		if (!Read(payload, offset, outStats.tryCounts[i]) || !Read(payload, offset, outStats.winCounts[i])) return false;
+
+	if (!Read(payload, offset, ownershipCount)) return false;
+	outStats.ownershipCounts.resize(ownershipCount);
+	for (uint32 i = 0; i < ownershipCount; ++i)
+		if (!Read(payload, offset, outStats.ownershipCounts[i])) return false;
+	return true;
+}
+
+// buffer の末尾に value を追加する (同じマシン上でやり取りするので、バイト順はそのまま)
+template <typename T>
+void Write(vec<uint8>& buffer, const T& value)
+{
+	const autosize Offset = buffer.size();
+	buffer.resize(Offset + sizeof(T));
+	std::memcpy(buffer.data() + Offset, &value, sizeof(T));
+}
+
+// buffer の offset の位置から value を読み、offset を進める (足りなければ false)
+template <typename T>
+bool Read(const vec<uint8>& buffer, autosize& offset, T& outValue)
+{
+	if (offset + sizeof(T) > buffer.size()) return false;
+	std::memcpy(&outValue, buffer.data() + offset, sizeof(T));
+	offset += sizeof(T);
+	return true;
+}
+
+#ifndef _WIN32
+// size バイトを全て送る (相手が落ちていたら false. SIGPIPE は発生させない)
+bool SendAll(int32 socket, const void* data, autosize size)
+{
+#ifdef MSG_NOSIGNAL
+	constexpr int32 Flags = MSG_NOSIGNAL;
+#else
+	constexpr int32 Flags = 0;
+#endif
+
+	const uint8* bytes = static_cast<const uint8*>(data);
+	while (size > 0)
+	{
+		const ssize_t Sent = send(socket, bytes, size, Flags);
+		if (Sent <= 0) return false;
+		bytes += Sent;
+		size -= static_cast<autosize>(Sent);
+	}
+	return true;
+}
+
+// size バイトを全て受け取る (相手が落ちていたら false)
+bool ReceiveAll(int32 socket, void* data, autosize size)
+{
+	uint8* bytes = static_cast<uint8*>(data);
+	while (size > 0)
+	{
+		const ssize_t Received = recv(socket, bytes, size, 0);
+		if (Received <= 0) return false;
+		bytes += Received;
+		size -= static_cast<autosize>(Received);
+	}
+	return true;
+}
+
+bool SendMessage(int32 socket, MessageType type, const vec<uint8>& payload)
+{
+	const MessageHeader Header = { type, static_cast<uint32>(payload.size()) };
+	return SendAll(socket, &Header, sizeof(Header)) && SendAll(socket, payload.data(), payload.size());
+}
+
+bool ReceiveMessage(int32 socket, MessageType& outType, vec<uint8>& outPayload)
+{
+	MessageHeader header;
+	if (!ReceiveAll(socket, &header, sizeof(header))) return false;
+
+	outType = header.type;
+	outPayload.resize(header.size);
+	return ReceiveAll(socket, outPayload.data(), outPayload.size());
+}
+#endif
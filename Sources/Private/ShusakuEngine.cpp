@@ -0,0 +1,164 @@
+﻿#include <ShusakuEngine.h>
+#include <Engine.hpp>
+#include <OpeningBook.hpp>
+#include <PatternWeights.hpp>
+#include <EvalCache.hpp>
+
+using namespace Shusaku;
+
+// C の API から見えるエンジン (読み込んだファイルは、Engine より長く生きるように、先に並べる)
+struct ShusakuEngine final
+{
+	OpeningBook openingBook;
+	PatternWeights patternWeights;
+	EvalCache evalCache;
+	std::optional<Engine> engine;
+};
+
+static bool ToBoardSize(int32_t size, BoardSize& outBoardSize);
+static bool ToStone(int32_t value, Stone& outStone);
+
+void ShusakuGetDefaultOptions(ShusakuEngineOptions* outOptions)
+{
+	if (!outOptions) return;
+
+	const SimulatorOptions Defaults;
+	outOptions->workerCount = 0;
+	outOptions->thinkCount = Defaults.thinkCount;
+	outOptions->playoutPolicy = static_cast<int32_t>(Defaults.playoutPolicy);
+	outOptions->playoutTactics = Defaults.playoutTactics ? 1 : 0;
+	outOptions->lastGoodReply = Defaults.lastGoodReply ? 1 : 0;
+	outOptions->playoutMercyThreshold = Defaults.playoutMercyThreshold;
+	outOptions->patternWeightsPath = nullptr;
+	outOptions->openingBookPath = nullptr;
+	outOptions->evalCachePath = nullptr;
+}
+
+ShusakuEngine* ShusakuCreateEngine(const ShusakuEngineOptions* options)
+{
+	ShusakuEngineOptions engineOptions;
+	ShusakuGetDefaultOptions(&engineOptions);
+	if (options) engineOptions = *options;
+
+	// 例外は C の呼び出し元に投げられないので、ここで止める
+	try
+	{
+		std::unique_ptr<ShusakuEngine> engine = std::make_unique<ShusakuEngine>();
+
+		SimulatorOptions simulatorOptions;
+		simulatorOptions.thinkCount = engineOptions.thinkCount;
+		simulatorOptions.playoutPolicy =
+			engineOptions.playoutPolicy == static_cast<int32_t>(PlayoutPolicy::Pattern) ? PlayoutPolicy::Pattern :
+			engineOptions.playoutPolicy == static_cast<int32_t>(PlayoutPolicy::Random) ? PlayoutPolicy::Random : PlayoutPolicy::EyeAware;
+		simulatorOptions.playoutTactics = engineOptions.playoutTactics != 0;
+		simulatorOptions.lastGoodReply = engineOptions.lastGoodReply != 0;
+		simulatorOptions.playoutMercyThreshold = static_cast<uint16>(std::clamp<int32_t>(engineOptions.playoutMercyThreshold, 0, MAX_uint16));
+		if (engineOptions.patternWeightsPath && engine->patternWeights.Load(engineOptions.patternWeightsPath))
+			simulatorOptions.patternWeights = &engine->patternWeights;
+		if (engineOptions.openingBookPath && engine->openingBook.Load(engineOptions.openingBookPath))
+			simulatorOptions.openingBook = &engine->openingBook;
+		if (engineOptions.evalCachePath && engine->evalCache.Open(engineOptions.evalCachePath))
+			simulatorOptions.evalCache = &engine->evalCache;
+
+		engine->engine.emplace(simulatorOptions, engineOptions.workerCount);
+		return engine.release();
+	}
+	catch (...)
+	{
+		return nullptr;
+	}
+}
+
+void ShusakuDestroyEngine(ShusakuEngine* engine)
+{
+	delete engine;
+}
+
+int32_t ShusakuEvaluate(ShusakuEngine* engine, const ShusakuPosition* positions, ShusakuResult* results, int32_t count)
+{
+	if (!engine || count < 0 || (count > 0 && (!positions || !results))) return -1;
+
+	try
+	{
+		// 局面を作れないもの (盤面の一辺・手番・着手の石が不正) は、評価を頼まずに無効とする
+		vec<EngineRequest> requests;
+		vec<int32_t> requestIndices;  // 各要求の、positions でのインデックス
+		requests.reserve(count);
+		requestIndices.reserve(count);
+		for (int32_t i = 0; i < count; ++i)
+		{
+			const ShusakuPosition& Position = positions[i];
+			results[i].isValid = 0;
+			results[i].x = 0;
+			results[i].y = 0;
+			results[i].winRate = -1.0;
+
+			EngineRequest request;
+			if (!ToBoardSize(Position.boardSize, request.boardSize) || !ToStone(Position.stone, request.stone)) continue;
+			if (Position.moveCount < 0 || (Position.moveCount > 0 && !Position.moves)) continue;
+
+			bool isValid = true;
+			request.history.reserve(Position.moveCount);
+			for (int32_t m = 0; m < Position.moveCount && isValid; ++m)
+			{
+				const ShusakuMove& Move = Position.moves[m];
+				Stone stone;
+				isValid = ToStone(Move.stone, stone) && 1 <= Move.x && Move.x <= Position.boardSize && 1 <= Move.y && Move.y <= Position.boardSize;
+				if (isValid) request.history.push_back({ { static_cast<uint8>(Move.x), static_cast<uint8>(Move.y) }, stone });
+			}
+			if (!isValid) continue;
+
+			request.thinkCount = Position.thinkCount;
+			request.withOwnership = results[i].ownership != nullptr;
+			requests.push_back(std::move(request));
+			requestIndices.push_back(i);
+		}
+
+		const vec<EngineResult> EngineResults = engine->engine->Evaluate(requests);
+
+		int32_t validCount = 0;
+		for (autosize r = 0; r < EngineResults.size(); ++r)
+		{
+			const EngineResult& Result = EngineResults[r];
+			ShusakuResult& result = results[requestIndices[r]];
+			if (!Result.isValid) continue;
+
+			result.isValid = 1;
+			result.x = Result.bestPos.x;
+			result.y = Result.bestPos.y;
+			result.winRate = Result.winRate >= 0.0 ? Result.winRate : -1.0;
+			if (result.ownership)
+			{
+				const autosize PositionsCount = static_cast<autosize>(positions[requestIndices[r]].boardSize) * positions[requestIndices[r]].boardSize;
+				for (autosize p = 0; p < PositionsCount; ++p)
+					result.ownership[p] = p < Result.ownership.size() ? Result.ownership[p] : 0.0;
+			}
+			++validCount;
+		}
+		return validCount;
+	}
+	catch (...)
+	{
+		return -1;
+	}
+}
+
+// 盤面の一辺を、BoardSize に直す
+bool ToBoardSize(int32_t size, BoardSize& outBoardSize)
+{
+	switch (size)
+	{
+	case 9: outBoardSize = BoardSize::_9x9; return true;
+	case 13: outBoardSize = BoardSize::_13x13; return true;
+	case 19: outBoardSize = BoardSize::_19x19; return true;
+	default: return false;
+	}
+}
+
+// 1 (黒), 2 (白) を、Stone に直す
+bool ToStone(int32_t value, Stone& outStone)
+{
+	if (value != static_cast<int32_t>(Stone::Black) && value != static_cast<int32_t>(Stone::White)) return false;
+	outStone = static_cast<Stone>(value);
+	return true;
+}
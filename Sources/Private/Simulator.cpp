@@ -1,198 +1,874 @@
 ﻿#include <Simulator.hpp>
+#include <Tactics.hpp>
+#include <OpeningBook.hpp>
+#include <EndgameSolver.hpp>
+#include <LockstepPlayout.hpp>
+#include <PatternWeights.hpp>
+#include <EvalCache.hpp>
 
 using namespace Shusaku;
 
-Stone Simulator::Judge(const Board& board)
+// Think での候補手 1 つ分の情報 (思考ごとのアリーナに置く)
+struct Candidate final
 {
-	constexpr uint8 Comi = 7;  // コミ (黒が出す)
+	Pos pos;
+	uint64 tryCount = 0;  // この候補手について試行した回数
+};
+
+// 終局までの試行の中身の集計 (ワーカーごとに持ち、最後に RootStats に加算する)
+struct PlayoutCounts final
+{
+	uint64 moveCount = 0;  // 打った手の数
+	uint64 mercyCount = 0;  // 石の数の差で打ち切った回数
+};
+
+// 終局までの試行で覚えた、直前の手への応手 (Last-Good-Reply with Forgetting)
+// 勝った試行で、相手の手の直後に打った手を覚え、負けた試行でその手を打っていたら忘れる
+// 試行では、直前の手への応手を覚えていて、打てるなら、それを優先する
+// ワーカー (スレッド) ごとに持つので、試行の間で取り合うことはない
+struct LastGoodReplies final
+{
+	static constexpr uint16 NoReply = MAX_uint16;
+
+	uint16 positionsCount = 0;  // 覚えた時の盤面の交点数 (変わったら忘れる)
+	arr<arr<uint16, Board::MaxPositionsCount>, 2> replies;  // [応手を打つ側 (0 が黒、1 が白)][直前の手のインデックス] = 応手のインデックス
+
+	inline LastGoodReplies() { Clear(0); }
+
+	inline void Clear(uint16 positionsCount)
+	{
+		this->positionsCount = positionsCount;
+		for (auto& colorReplies : replies)
+			colorReplies.fill(NoReply);
+	}
+};
+
+// 終局までの試行で使う、スレッドごとの作業領域
+// 試行のたびに確保し直さないように、中身を上書きして容量を使いまわす (確保は、各スレッドの最初の数回の試行だけで済む)
+struct PlayoutScratch final
+{
+	std::optional<Board> board;  // __Try で試行する盤面
+	vec<Pos> emptyPositions;  // UniformPolicy の空き点
+	vec<Pos> tacticalMoves;  // 戦術的な手の候補
+	WeightTree weightTrees[2];  // PatternPolicy の、手番ごとの各点の重み
+	vec<autosize> rejectedIndices;  // PatternPolicy で打てなかった点
+	vec<autosize> boostedIndices;  // PatternPolicy で、直前の着手からの距離の強さを掛けた点
+	vec<Stone> stones;  // Judge で、死石を取り除いた盤面
+	vec<bool> visited;  // ScoreStones で探索済みの空き点
+	vec<autosize> stack;  // ScoreStones で探索中の空き点
+	vec<autosize> region;  // ScoreStones で探索した空き点
+	LastGoodReplies replies;  // __Try で覚えた応手 (options.lastGoodReply の時だけ使う)
+};
+
+static PlayoutScratch& GetPlayoutScratch();
+static autosize GetCursorMemorySize(autosize size);
+static void GetEmptyPositions(const Board& board, vec<Pos>& outEmptyPositions);
+static Stone PlayOutAndJudge(Stone turn, Board& board, const SimulatorOptions& options, int32* outOwnershipCounts, LastGoodReplies* replies, PlayoutCounts* outCounts);
+template <class Policy> static Stone PlayOut(Stone turn, Board& board, const SimulatorOptions& options, int32* outOwnershipCounts, LastGoodReplies* replies, PlayoutCounts* outCounts);
+static bool IsMercy(const Board& board, const SimulatorOptions& options);
+static bool TryTacticalMove(Stone turn, Board& board, const Pos& lastPos, vec<Pos>& tacticalMoves, Pos& outPos);
+static bool TryReply(Stone turn, Board& board, const Pos& lastPos, const LastGoodReplies& replies, Pos& outPos);
+static void UpdateReplies(const Board& board, autosize firstMoveIdx, Stone winner, LastGoodReplies& replies);
+static Pos GetLastPos(const Board& board);
+static std::pair<double, double> GetConfidenceInterval(double winCount, double tryCount);
+static Stone JudgeStones(const vec<Stone>& stones, uint8 size, int32* outOwnershipCounts = nullptr);
+static int32 ScoreStones(const vec<Stone>& stones, uint8 size, int32* outOwnershipCounts = nullptr);
+
+// 終局までの試行の、着手の選び方・打ち切り・判定 (PlayOut のテンプレート引数)
+// 仮想関数は使わず、PlayOut<Policy> ごとに静的に解決するので、試行の 1 手ごとの呼び出しはインライン展開される
+// 各方策は、これを継承し、次のものを持つ
+//   Policy(Board& board, const SimulatorOptions& options, PlayoutScratch& scratch) : 試行を始める準備をする
+//   bool PutMove(Stone turn, const Pos& lastPos, Pos& outPos) : 方策に従って着手し、その座標を outPos に格納する (打てる手が無ければ false)
+// 次のものは、必要なら同じ名前で隠す
+//   OnForcedPut : 戦術的な手・覚えた応手を、方策を通さずに打った後に呼ぶ
+//   OnPut : 着手した後に呼ぶ (取った石は board.GetLastTakenStones() にある)
+//   IsDecided : 着手した後に呼び、true なら勝負が付いたとして打ち切る
+//   Judge : 終局した盤面の勝敗を判定する
+class PlayoutPolicyBase
+{
+public:
+
+	inline PlayoutPolicyBase(Board& board, const SimulatorOptions& options) : board(board), options(options) {}
+
+	inline void OnForcedPut(UNUSED const Pos& pos) {}
+	inline void OnPut(UNUSED const Pos& pos) {}
+
+	// 石の数の差で打ち切る (options.playoutMercyThreshold を参照)
+	inline bool IsDecided() const { return IsMercy(board, options); }
+
+	// 石の数と、一方の石だけに囲まれた空き点の数の合計で判定する
+	inline Stone Judge(int32* outOwnershipCounts) const { return JudgeStones(board.GetBoard(), board.GetSize(), outOwnershipCounts); }
+
+protected:
+
+	Board& board;
+	const SimulatorOptions& options;
+};
+
+// 空き点から一様ランダムに選ぶ方策
+// AvoidsOwnEyes なら、自分の眼は潰さない (潰さないと、最大手数まで打ち続けることが多い)
+// 打てなかった点 (自分の眼・着手禁止点・同形反復) は候補の末尾に退避し、残りの候補から選び直す
+template <bool AvoidsOwnEyes>
+class UniformPolicy final : public PlayoutPolicyBase
+{
+public:
+
+	inline UniformPolicy(Board& board, const SimulatorOptions& options, PlayoutScratch& scratch)
+		: PlayoutPolicyBase(board, options), emptyPositions(scratch.emptyPositions)
+	{
+		// 空き点の位置を調べる (この中からランダムに着手を試行する)
+		emptyPositions.reserve(board.GetPositionsCount());
+		GetEmptyPositions(board, emptyPositions);
+	}
+
+	inline bool PutMove(Stone turn, UNUSED const Pos& lastPos, Pos& outPos)
+	{
+		autosize candidateCount = emptyPositions.size();
+		while (candidateCount > 0)
+		{
+			const autosize Idx = static_cast<autosize>(Rand::Range(0, static_cast<int32>(candidateCount) - 1));
+			const Pos pos = emptyPositions[Idx];
+
+			// 着手を試行する
+			if ((!AvoidsOwnEyes || !board.IsEye(pos, turn)) && board.PutStone(pos, turn))
+			{
+				// 空き点から削除 (順番は気にしないので、末尾と入れ替えて削除する)
+				emptyPositions[Idx] = emptyPositions.back();
+				emptyPositions.pop_back();
+				outPos = pos;
+				return true;
+			}
+
+			--candidateCount;
+			std::swap(emptyPositions[Idx], emptyPositions[candidateCount]);
+		}
+		return false;
+	}
+
+	inline void OnForcedPut(const Pos& pos)
+	{
+		// 空き点から削除 (順番は気にしないので、末尾と入れ替えて削除する)
+		auto it = std::find(emptyPositions.begin(), emptyPositions.end(), pos);
+		if (it != emptyPositions.end())
+		{
+			*it = emptyPositions.back();
+			emptyPositions.pop_back();
+		}
+	}
+
+	inline void OnPut(UNUSED const Pos& pos)
+	{
+		// 石を取ったなら、その分だけ空き点が増える
+		for (const Pos& takenPos : board.GetLastTakenStones())
+			emptyPositions.push_back(takenPos);
+	}
+
+private:
+
+	vec<Pos>& emptyPositions;  // 空き点 (PlayoutScratch のものを使いまわす)
+};
+
+using RandomPolicy = UniformPolicy<false>;
+using EyeAwarePolicy = UniformPolicy<true>;
+
+// 周囲 3x3 のパターンの重みに比例して選ぶ方策 (自分の眼の重みは 0)
+// 重みは手番ごとに WeightTree で持ち、着手した点・取った石の周囲だけを更新する
+// options.patternWeights が読み込まれていれば、パターンの重みはそれを使い、直前の着手の近くの点には、さらに距離の強さを掛ける
+class PatternPolicy final : public PlayoutPolicyBase
+{
+public:
+
+	inline PatternPolicy(Board& board, const SimulatorOptions& options, PlayoutScratch& scratch)
+		: PlayoutPolicyBase(board, options)
+		, size(board.GetSize())
+		, learnedWeights(options.patternWeights && options.patternWeights->IsLoaded() ? options.patternWeights : nullptr)
+		, weightTrees(scratch.weightTrees)
+		, rejectedIndices(scratch.rejectedIndices)
+		, boostedIndices(scratch.boostedIndices)
+	{
+		const uint16 PositionsCount = board.GetPositionsCount();
+		weightTrees[0].Reset(PositionsCount);
+		weightTrees[1].Reset(PositionsCount);
+		for (uint8 x = 1; x <= size; ++x)
+			for (uint8 y = 1; y <= size; ++y)
+				UpdateWeight(x, y);
+
+		rejectedIndices.clear();
+		rejectedIndices.reserve(PositionsCount);
+		boostedIndices.clear();
+	}
+
+	inline bool PutMove(Stone turn, const Pos& lastPos, Pos& outPos)
+	{
+		WeightTree& weightTree = weightTrees[turn == Stone::Black ? 0 : 1];
+
+		// 学習した重みなら、直前の着手の近く (距離の区分が 0 でない点) の重みに、距離の強さを掛ける
+		if (learnedWeights && lastPos != Pos(0, 0))
+		{
+			const PatternWeights::Header& Gammas = learnedWeights->GetHeader();
+			for (int32 dy = -2; dy <= 2; ++dy)
+				for (int32 dx = -2; dx <= 2; ++dx)
+				{
+					const int32 nx = lastPos.x + dx, ny = lastPos.y + dy;
+					if (nx < 1 || size < nx || ny < 1 || size < ny) continue;
+
+					const Pos Near = { static_cast<uint8>(nx), static_cast<uint8>(ny) };
+					const uint8 Bucket = PatternWeights::GetDistanceBucket(Near, lastPos);
+					const autosize Idx = (nx - 1) + (ny - 1) * size;
+					if (Bucket == 0 || weightTree.GetWeight(Idx) == 0) continue;
+
+					weightTree.Set(Idx, static_cast<uint32>(std::max(weightTree.GetWeight(Idx) * Gammas.distanceGammas[Bucket], 1.0f)));
+					boostedIndices.push_back(Idx);
+				}
+		}
+
+		// 重みに比例して選び、着手を試行する
+		// 打てなかった点 (着手禁止点・同形反復) は、その手番の間だけ重みを 0 にしておく
+		bool couldPut = false;
+		while (weightTree.GetTotal() > 0)
+		{
+			const uint64 Value = static_cast<uint64>(Rand::Range(0, static_cast<int32>(weightTree.GetTotal()) - 1));
+			const autosize Idx = weightTree.Find(Value);
+			outPos = { static_cast<uint8>(Idx % size + 1), static_cast<uint8>(Idx / size + 1) };
+
+			if (board.PutStone(outPos, turn))
+			{
+				couldPut = true;
+				break;
+			}
+
+			rejectedIndices.push_back(Idx);
+			weightTree.Set(Idx, 0);
+		}
+
+		// 打てなかった点・距離の強さを掛けた点の重みを戻す
+		for (const autosize Idx : rejectedIndices)
+			UpdateWeight(static_cast<uint8>(Idx % size + 1), static_cast<uint8>(Idx / size + 1));
+		rejectedIndices.clear();
+		for (const autosize Idx : boostedIndices)
+			UpdateWeight(static_cast<uint8>(Idx % size + 1), static_cast<uint8>(Idx / size + 1));
+		boostedIndices.clear();
+
+		return couldPut;
+	}
+
+	inline void OnPut(const Pos& pos)
+	{
+		// 着手した点と、取った石の周囲は、3x3 パターンが変わっているので、重みを更新する
+		UpdateWeightsAround(pos.x, pos.y);
+		for (const Pos& takenPos : board.GetLastTakenStones())
+			UpdateWeightsAround(takenPos.x, takenPos.y);
+	}
+
+private:
+
+	const uint8 size;
+	const PatternWeights* learnedWeights;  // 学習した重み (読み込まれていなければ nullptr)
+
+	// 手番ごとの、各点の重み ([0] が黒番、[1] が白番)
+	// index = (x-1)+(y-1)*size で計算する
+	WeightTree (&weightTrees)[2];
+	vec<autosize>& rejectedIndices;  // 打てなかった点
+	vec<autosize>& boostedIndices;  // 直前の着手からの距離の強さを掛けた点
+
+	// (x, y) の重みを、現在の盤面から計算し直す (石がある点は 0)
+	inline void UpdateWeight(uint8 x, uint8 y)
+	{
+		const autosize Idx = (x - 1) + (y - 1) * size;
+		if (board.GetStone(x, y) != Stone::Empty)
+		{
+			weightTrees[0].Set(Idx, 0);
+			weightTrees[1].Set(Idx, 0);
+			return;
+		}
 
+		const uint16 Code = board.GetPattern(x, y);
+		if (learnedWeights)
+		{
+			weightTrees[0].Set(Idx, learnedWeights->GetWeight(Code, Stone::Black));
+			weightTrees[1].Set(Idx, learnedWeights->GetWeight(Code, Stone::White));
+			return;
+		}
+		weightTrees[0].Set(Idx, Pattern3x3::GetWeight(Code, Stone::Black));
+		weightTrees[1].Set(Idx, Pattern3x3::GetWeight(Code, Stone::White));
+	}
+
+	// (x, y) と、その周囲 8 点の重みを計算し直す
+	inline void UpdateWeightsAround(uint8 x, uint8 y)
+	{
+		UpdateWeight(x, y);
+		for (uint8 dir = 0; dir < Pattern3x3::DirectionCount; ++dir)
+		{
+			const int32 nx = x + Pattern3x3::DirectionX[dir], ny = y + Pattern3x3::DirectionY[dir];
+			if (nx < 1 || size < nx || ny < 1 || size < ny) continue;
+			UpdateWeight(static_cast<uint8>(nx), static_cast<uint8>(ny));
+		}
+	}
+};
+
+Stone Simulator::Judge(const Board& board)
+{
 	// アゲハマの数を取得
 	UNUSED const uint64 hamaBlack = board.GetHamaBlack();
 	UNUSED const uint64 hamaWhite = board.GetHamaWhite();
 
-	// 黒石と白石の数、空き点の数をカウントする
-	autosize blackStoneCount = 0, whiteStoneCount = 0, emptyCount = 0;
-	for (const Stone& stone : board.GetBoard())
+	return JudgeStones(board.GetBoard(), board.GetSize());
+}
+
+int32 Simulator::GetScore(const Board& board)
+{
+	return ScoreStones(board.GetBoard(), board.GetSize());
+}
+
+Stone Simulator::Judge(const Board& board, const vec<double>& ownership)
+{
+	// 帰属の値がこれを越えて相手側に寄っている石は、死石とみなす
+	constexpr double DeadStoneThreshold = 0.5;
+
+	// 死石を取り除いた盤面で判定する
+	vec<Stone>& stones = GetPlayoutScratch().stones;
+	stones = board.GetBoard();
+	for (autosize i = 0; i < stones.size() && i < ownership.size(); ++i)
 	{
-		if (stone == Stone::Black)
-			++blackStoneCount;
-		else if (stone == Stone::White)
-			++whiteStoneCount;
-		else if (stone == Stone::Empty)
-			++emptyCount;
+		if (stones[i] == Stone::Black && ownership[i] < -DeadStoneThreshold) stones[i] = Stone::Empty;
+		else if (stones[i] == Stone::White && ownership[i] > DeadStoneThreshold) stones[i] = Stone::Empty;
 	}
 
-	// 簡易的に、盤面上の石の数が多かった方を勝ちとする
-	// (中国ルールから着想を得た)
+	return JudgeStones(stones, board.GetSize());
+}
 
-	autosize blackScore = blackStoneCount;
-	autosize whiteScore = whiteStoneCount + Comi;  // コミを白に加算する
+Pos Simulator::Think(Stone stone, const Board& board, const SimulatorOptions& options, double* outWinRate, vec<double>* outOwnership, std::pair<double, double>* outConfidenceInterval)
+{
+	TRACE_SCOPE("Simulator::Think");
 
-	if (blackScore > whiteScore) return Stone::Black;
-	if (blackScore < whiteScore) return Stone::White;
-	return Stone::Empty;
+	// 定石・終盤の読み切りで決められるなら、探索しない
+	Pos shortcutPos;
+	if (TryThinkWithoutSearch(stone, board, options, shortcutPos, outWinRate, outOwnership, outConfidenceInterval))
+		return shortcutPos;
+
+	// 各候補手について GetThinkCount() 回ずつ試行し、その結果から最善の着手を選ぶ
+	RootStats stats;
+	stats.Reset(board.GetPositionsCount(), outOwnership != nullptr);
+	Search(stone, board, options, GetThinkCount(options), stats);
+	return SelectBest(stone, board, options, stats, outWinRate, outOwnership, outConfidenceInterval);
+}
+
+bool Simulator::TryThinkWithoutSearch(Stone stone, const Board& board, const SimulatorOptions& options, Pos& outPos, double* outWinRate, vec<double>* outOwnership, std::pair<double, double>* outConfidenceInterval)
+{
+	// 定石ファイルに載っている局面なら、定石手を返す
+	uint32 bookTryCount, bookWinCount;
+	if (options.openingBook && options.openingBook->Probe(stone, board, outPos, outWinRate, &bookTryCount, &bookWinCount))
+	{
+		if (outOwnership) outOwnership->clear();
+		if (outConfidenceInterval) *outConfidenceInterval = GetConfidenceInterval(bookWinCount, bookTryCount);
+		return true;
+	}
+
+	// 空き点が少なければ、終局まで読み切る
+	if (options.endgameSolverEmptyCount > 0)
+	{
+		autosize emptyCount = 0;
+		for (const Stone s : board.GetBoard())
+			if (s == Stone::Empty) ++emptyCount;
+
+		int32 result;
+		if (emptyCount <= options.endgameSolverEmptyCount && EndgameSolver::Solve(stone, board, options.endgameSolverTimeLimit, outPos, &result))
+		{
+			// 読み切れたので、勝率は 1 (勝ち), 0.5 (引き分け), 0 (負け) のどれか
+			const double WinRate = result > 0 ? 1.0 : result < 0 ? 0.0 : 0.5;
+			if (outWinRate) *outWinRate = WinRate;
+			if (outOwnership) outOwnership->clear();
+			if (outConfidenceInterval) *outConfidenceInterval = { WinRate, WinRate };
+			return true;
+		}
+	}
+
+	return false;
 }
 
-Pos Simulator::Think(Stone stone, const Board& board, double* outWinRate)
+uint32 Simulator::GetThreadCount(const SimulatorOptions& options)
 {
 	// ハードウェアのスレッド数
-	static const uint32 HardwareThreads = std::thread::hardware_concurrency();
+	static const uint32 HardwareThreads = std::max<uint32>(std::thread::hardware_concurrency(), 1);
+
+	return options.threadCount > 0 ? options.threadCount : HardwareThreads;
+}
+
+uint64 Simulator::GetThinkCount(const SimulatorOptions& options)
+{
+	if (options.thinkCount > 0) return options.thinkCount;
 
-	// 着手を考えるとき、それぞれの空き点で、何回終局まで試行するか
-	// ハードウェアのスレッド数を元に動的に設定
+	// スレッド数を元に動的に設定
 	// 数値は何となく
-	static const uint64 ThinkCount = std::max<uint32>(HardwareThreads << 2, 8);
+	return std::max<uint64>(static_cast<uint64>(GetThreadCount(options)) << 2, 8);
+}
 
-	const uint8 Size = board.GetSize();
+autosize Simulator::GetSearchMemorySize(const Board& board, const SimulatorOptions& options, bool withOwnership)
+{
 	const autosize PositionsCount = board.GetPositionsCount();
+	constexpr autosize Padding = alignof(std::max_align_t);  // 1 回の確保で、アラインメントのために空けうる大きさ
 
-	// 勝率を格納 (0.0が最低、1.0が最高)
-	// index = (x-1)+(y-1)*Size で計算する
-	vec<double> winRates(PositionsCount, MIN_double);
+	// 候補手の情報 (1 つのカーソルで、点の数まで)
+	const autosize CandidatesSize = PositionsCount * sizeof(Candidate) + Padding;
+
+	// ワーカーごとのバッファ (ワーカーごとに別のカーソルで)
+	autosize workerSize = PositionsCount * sizeof(uint32) + sizeof(PlayoutCounts) + Padding * 2;
+	if (withOwnership) workerSize += PositionsCount * sizeof(int32) + Padding;
+	if (options.lastGoodReply) workerSize += sizeof(LastGoodReplies) + Padding;
+
+	return GetCursorMemorySize(CandidatesSize) + GetCursorMemorySize(workerSize) * GetThreadCount(options);
+}
+
+void Simulator::Search(Stone stone, const Board& board, const SimulatorOptions& options, uint64 tryCount, RootStats& outStats)
+{
+	TRACE_SCOPE("Simulator::Search");
+
+	const uint32 ThreadCount = GetThreadCount(options);
+
+	const uint8 size = board.GetSize();
+	const autosize PositionsCount = board.GetPositionsCount();
+	const bool WithOwnership = !outStats.ownershipCounts.empty();
+	if (outStats.tryCounts.size() != PositionsCount)
+		outStats.Reset(PositionsCount, WithOwnership);
 
-	// 空き点の場所を順に見ていき、勝率を求める
-	for (uint8 x = 1; x <= Size; ++x)
-		for (uint8 y = 1; y <= Size; ++y)
+	// 評価キャッシュに、この局面の前回までの成績があれば、outStats に足してから始める (warm start)
+	// 帰属を求めない探索で、既に予算 (対称な手をまとめた候補手ごとに tryCount 回) 以上の試行が集まっていれば、探索しない
+	// キャッシュは対称な手をまとめて 1 つと数えるので、options.symmetryReduction に依らず、対称な手の代表の数と比べる
+	uint64 cachedTryCount = 0;
+	if (options.evalCache && options.evalCache->WarmStart(stone, board, outStats, &cachedTryCount) && !WithOwnership)
+	{
+		const uint8 CacheSymmetryMask = board.GetSymmetryMask();
+		uint64 candidateCount = 0;
+		for (uint8 x = 1; x <= size; ++x)
+			for (uint8 y = 1; y <= size; ++y)
+				if (board.IsLegal(x, y, stone) && Symmetry::GetRepresentative({ x, y }, size, CacheSymmetryMask) == Pos(x, y))
+					++candidateCount;
+		if (cachedTryCount >= candidateCount * tryCount) return;
+	}
+
+	// 思考中に使う領域 (候補手の情報・ワーカーごとの集計用バッファ) は、アリーナからまとめて確保し、思考の終了時にまとめて解放する
+	// アリーナは、使う分 (GetSearchMemorySize) だけ予約する. それが上限 options.searchMemoryLimit を越えるなら、上限の分だけ予約し、
+	// 確保できなかった候補手は展開せず、確保できなかったワーカーは立てない (候補手を先に確保する)
+	Arena arena(std::min(options.searchMemoryLimit, GetSearchMemorySize(board, options, WithOwnership)));
+
+	// 盤面が対称なら、対称な候補手のうち 1 つ (代表) だけを試行し、残りには代表の結果を写す
+	const uint8 SymmetryMask = options.symmetryReduction ? board.GetSymmetryMask() : 1;
+	const bool UsesSymmetry = SymmetryMask != 1;
+
+	// 候補手 (着手できる空き点) を列挙する
+	Arena::Cursor cursor(arena);
+	vec<Candidate*> candidates;
+	candidates.reserve(PositionsCount);
+	{
+		bool isMemoryFull = false;
+		for (uint8 x = 1; x <= size && !isMemoryFull; ++x)
+			for (uint8 y = 1; y <= size && !isMemoryFull; ++y)
+			{
+				if (!board.IsLegal(x, y, stone)) continue;
+				if (UsesSymmetry && Symmetry::GetRepresentative({ x, y }, size, SymmetryMask) != Pos(x, y)) continue;
+
+				// メモリの上限に達したので、これ以上は展開しない
+				Candidate* candidate = cursor.Create<Candidate>();
+				isMemoryFull = candidate == nullptr;
+				if (isMemoryFull) continue;
+
+				candidate->pos = { x, y };
+				candidates.push_back(candidate);
+			}
+	}
+	const autosize CandidateCount = candidates.size();
+
+	// 勝ち数と帰属 (終局時に、各点が黒と白のどちらのものになったか) は、ワーカーごとのバッファに集計し、最後にまとめる
+	// バッファはワーカーごとに別のチャンクから確保するので、同じキャッシュラインを取り合うことはない
+	// 候補手の数は盤面の点の数以下なので、その大きさで確保する
+	vec<Arena::Cursor> workerCursors(ThreadCount, Arena::Cursor(arena));
+	// 試行の中身の集計も、ワーカーごとに持つ
+	// options.lastGoodReply なら、覚えた応手もワーカーごとに持ち、この探索の間 (全てのラウンド) 使い続ける
+	vec<uint32*> winCountsByWorker;
+	vec<int32*> ownershipCountsByWorker;
+	vec<PlayoutCounts*> playoutCountsByWorker;
+	vec<LastGoodReplies*> repliesByWorker;
+	winCountsByWorker.reserve(ThreadCount);
+	ownershipCountsByWorker.reserve(ThreadCount);
+	playoutCountsByWorker.reserve(ThreadCount);
+	repliesByWorker.reserve(ThreadCount);
+	for (Arena::Cursor& workerCursor : workerCursors)
+	{
+		uint32* winCounts = workerCursor.CreateArray<uint32>(PositionsCount);
+		int32* ownershipCounts = WithOwnership ? workerCursor.CreateArray<int32>(PositionsCount) : nullptr;
+		PlayoutCounts* playoutCounts = workerCursor.Create<PlayoutCounts>();
+		LastGoodReplies* replies = options.lastGoodReply ? workerCursor.Create<LastGoodReplies>() : nullptr;
+		if (!winCounts || (WithOwnership && !ownershipCounts) || !playoutCounts || (options.lastGoodReply && !replies)) break;
+
+		if (replies) replies->Clear(static_cast<uint16>(PositionsCount));
+		winCountsByWorker.push_back(winCounts);
+		ownershipCountsByWorker.push_back(ownershipCounts);
+		playoutCountsByWorker.push_back(playoutCounts);
+		repliesByWorker.push_back(replies);
+	}
+
+	// 試行の予算 (全ての候補手に tryCount 回ずつ試行するのと同じ回数) を、options.rootAllocation に従って候補手に割り振る
+	// 1 つのラウンドでは、activeCandidates の各候補手について triesPerCandidate 回ずつ、終局まで試行する
+	// 全ての試行を通し番号で表し、バッファを確保できた数だけ立てたワーカーが、前から順に取り合って処理する
+	// options.lockstepPlayouts なら、同じ候補手の試行を LockstepPlayout::LaneCount 回ずつまとめ、1 まとまりを 1 つの通し番号で表す
+	const uint32 WorkerCount = static_cast<uint32>(std::min<autosize>(CandidateCount * tryCount, winCountsByWorker.size()));
+	const bool UsesLockstep = options.lockstepPlayouts && options.playoutPolicy == PlayoutPolicy::EyeAware && !options.playoutTactics && !options.lastGoodReply && options.playoutMercyThreshold == 0;
+	const auto RunRound = [&](const vec<autosize>& activeCandidates, uint64 triesPerCandidate)
 		{
-			if (board.GetStone(x, y) != Stone::Empty) continue;
+			TRACE_SCOPE("Simulator::Search::Round");
+
+			const uint64 TriesPerBatch = UsesLockstep ? LockstepPlayout::LaneCount : 1;
+			const uint64 BatchesPerCandidate = (triesPerCandidate + TriesPerBatch - 1) / TriesPerBatch;
+			const autosize RoundBatchCount = activeCandidates.size() * BatchesPerCandidate;
+			std::atomic<autosize> nextBatch = 0;
+
+			// ワーカー w の処理 (通し番号を前から順に取り合い、試行する)
+			const auto RunWorker = [&](uint32 w)
+				{
+					TRACE_SCOPE("Simulator::Search::Worker");
+
+					uint32* winCounts = winCountsByWorker[w];
+					int32* ownershipCounts = ownershipCountsByWorker[w];
+					PlayoutCounts* playoutCounts = playoutCountsByWorker[w];
+					LastGoodReplies* replies = repliesByWorker[w];
+
+					// 試行する盤面 (試行ごとにコピーし直すが、容量を使いまわすので、確保は最初の 1 回だけで済む)
+					Board tryBoard = board;
+
+					arr<Stone, LockstepPlayout::LaneCount> winners;
+					for (autosize i = nextBatch++; i < RoundBatchCount; i = nextBatch++)
+					{
+						TRACE_SCOPE("Simulator::Search::Candidate");
+
+						const autosize CandidateIdx = activeCandidates[i / BatchesPerCandidate];
+
+						tryBoard = board;
+						tryBoard.PutStone(candidates[CandidateIdx]->pos, stone);
+						if (!UsesLockstep)
+						{
+							if (PlayOutAndJudge(ReverseStone(stone), tryBoard, options, ownershipCounts, replies, playoutCounts) == stone)
+								++winCounts[CandidateIdx];
+							continue;
+						}
+
+						// 候補手の最後のまとまりは、残りの回数だけ試行する
+						const uint32 GameCount = static_cast<uint32>(std::min(TriesPerBatch, triesPerCandidate - (i % BatchesPerCandidate) * TriesPerBatch));
+						LockstepPlayout::Run(ReverseStone(stone), tryBoard, options, GameCount, winners, ownershipCounts);
+						for (uint32 g = 0; g < GameCount; ++g)
+							if (winners[g] == stone) ++winCounts[CandidateIdx];
+					}
+				};
+
+			// ワーカーが 1 つで、CPU を固定しないなら、スレッドを立てずに、呼び出したスレッドで行う
+			// (Engine のように、スレッドプールの各スレッドで 1 局面ずつ考える場合は、ラウンドごとにスレッドを立てずに済む)
+			if (WorkerCount == 1 && options.cpus.empty())
+				RunWorker(0);
+			else
+			{
+				vec<std::future<void>> futures;
+				futures.reserve(WorkerCount);
+				for (uint32 w = 0; w < WorkerCount; ++w)
+				{
+					TRACE_SCOPE("Simulator::Search::SpawnWorker");
+					futures.emplace_back(std::async(std::launch::async,
+						[&, w]()
+						{
+							// CPU の番号が指定されていれば、このスレッドを固定する
+							if (!options.cpus.empty())
+								CpuAffinity::PinCurrentThread({ options.cpus[w % options.cpus.size()] });
 
-			// ここに着手した場合の勝率を、シミュレーションする
+							RunWorker(w);
+						}
+					));
+				}
+				for (auto& future : futures)
+					future.get();
+			}
+
+			for (const autosize CandidateIdx : activeCandidates)
+				candidates[CandidateIdx]->tryCount += triesPerCandidate;
+		};
 
-			// 盤面をコピーして、着手してみる
-			Board tempBoard = board;
-			if (!tempBoard.PutStone(x, y, stone)) continue;
+	// ワーカーを 1 つも立てられなかった (メモリの上限に達した) なら、どの候補手も試行しない
+	vec<autosize> activeCandidates(WorkerCount > 0 ? CandidateCount : 0);
+	for (autosize c = 0; c < activeCandidates.size(); ++c)
+		activeCandidates[c] = c;
 
-			// 非同期で並列シミュレーション
-			vec<std::future<Stone>> futures;
-			futures.reserve(ThinkCount);
-			for (UNUSED autosize i = 0; i < ThinkCount; ++i)
+	if (options.rootAllocation == RootAllocation::SuccessiveHalving && CandidateCount > 1)
+	{
+		// 予算をラウンド数で等分し、ラウンドごとに、勝率の高い半分の候補手だけを残す
+		// 見込みのない候補手に使うはずだった試行を、順位がまだ決まらない上位の候補手に回す
+		const uint64 Budget = CandidateCount * tryCount;
+		uint32 roundCount = 0;
+		for (autosize remaining = CandidateCount; remaining > 1; remaining = (remaining + 1) >> 1)
+			++roundCount;
+
+		for (uint32 r = 0; r < roundCount && !activeCandidates.empty(); ++r)
+		{
+			const uint64 TriesPerCandidate = std::max<uint64>(Budget / (static_cast<uint64>(activeCandidates.size()) * roundCount), 1);
+			RunRound(activeCandidates, TriesPerCandidate);
+			if (r + 1 == roundCount) break;
+
+			// 勝率の高い順に並べ、上位の半分を残す
+			vec<double> winRates(CandidateCount, 0.0);
+			for (const autosize CandidateIdx : activeCandidates)
 			{
-				futures.emplace_back(std::async(std::launch::async,
-					[stone, tempBoardCopy = tempBoard]() -> Stone { return Simulator::__Try(ReverseStone(stone), tempBoardCopy); }
-				));
+				uint64 winCount = 0;
+				for (uint32 w = 0; w < WorkerCount; ++w)
+					winCount += winCountsByWorker[w][CandidateIdx];
+				winRates[CandidateIdx] = static_cast<double>(winCount) / candidates[CandidateIdx]->tryCount;
 			}
+			std::stable_sort(activeCandidates.begin(), activeCandidates.end(),
+				[&](autosize a, autosize b) { return winRates[a] > winRates[b]; });
+			activeCandidates.resize((activeCandidates.size() + 1) >> 1);
+		}
+	}
+	else
+	{
+		// 全ての候補手について、tryCount 回ずつ試行する
+		RunRound(activeCandidates, tryCount);
+	}
 
-			// シミュレーションの結果を取得し、勝率を算出する
-			autosize winCount = 0;
-			for (auto& future : futures)
-				if (future.get() == stone)
-					++winCount;
-			double winRate = std::clamp(1.0 * winCount / ThinkCount, 0.0, 1.0);  // 最終数値
+	uint64 actualTryCount = 0;  // 実際に試行した回数
+	for (autosize c = 0; c < CandidateCount; ++c)
+		actualTryCount += candidates[c]->tryCount;
 
-			// 勝率を格納
-			winRates[(x - 1) + (y - 1) * Size] = winRate;
+	// ワーカーごとの集計を、outStats に加算する
+	// 対称性を使ったなら、代表の結果を、代表と対称な全ての点に写す
+	vec<int32> candidateIdxByPosition(PositionsCount, -1);
+	for (autosize c = 0; c < CandidateCount; ++c)
+		candidateIdxByPosition[(candidates[c]->pos.x - 1) + (candidates[c]->pos.y - 1) * size] = static_cast<int32>(c);
+
+	uint64 mirroredTryCount = 0;  // 代表の結果を写した点も含めた、試行回数
+	for (uint8 x = 1; x <= size; ++x)
+		for (uint8 y = 1; y <= size; ++y)
+		{
+			if (board.GetStone(x, y) != Stone::Empty) continue;
+
+			const Pos Representative = UsesSymmetry ? Symmetry::GetRepresentative({ x, y }, size, SymmetryMask) : Pos(x, y);
+			const int32 CandidateIdx = candidateIdxByPosition[(Representative.x - 1) + (Representative.y - 1) * size];
+			if (CandidateIdx < 0) continue;
+
+			const autosize Idx = (x - 1) + (y - 1) * size;
+			outStats.tryCounts[Idx] += candidates[CandidateIdx]->tryCount;
+			for (uint32 w = 0; w < WorkerCount; ++w)
+				outStats.winCounts[Idx] += winCountsByWorker[w][CandidateIdx];
+			mirroredTryCount += candidates[CandidateIdx]->tryCount;
 		}
 
-	// 勝率が最大の場所を探す
+	if (WithOwnership && actualTryCount > 0)
+	{
+		vec<int64> ownershipCounts(PositionsCount, 0);
+		for (uint32 w = 0; w < WorkerCount; ++w)
+			for (autosize i = 0; i < PositionsCount; ++i)
+				ownershipCounts[i] += ownershipCountsByWorker[w][i];
+
+		// 対称性を使ったなら、盤面は対称なので、帰属も対称になるように、対称な点同士で平均し、
+		// 写した分も含めた試行回数に合わせて拡大する
+		uint8 symmetryCount = 0;
+		for (uint8 symmetry = 0; symmetry < Symmetry::Count; ++symmetry)
+			if (SymmetryMask & (1 << symmetry)) ++symmetryCount;
+		const double Scale = static_cast<double>(mirroredTryCount) / (static_cast<double>(actualTryCount) * symmetryCount);
+
+		for (uint8 x = 0; x < size; ++x)
+			for (uint8 y = 0; y < size; ++y)
+			{
+				int64 sum = 0;
+				for (uint8 symmetry = 0; symmetry < Symmetry::Count; ++symmetry)
+				{
+					if (!(SymmetryMask & (1 << symmetry))) continue;
+
+					uint8 tx = x, ty = y;
+					Symmetry::Apply(symmetry, size, tx, ty);
+					sum += ownershipCounts[tx + ty * size];
+				}
+				outStats.ownershipCounts[x + y * size] += std::llround(sum * Scale);
+			}
+	}
+	outStats.totalTryCount += mirroredTryCount;
+
+	// 試行の中身の集計も、写した分も含めた試行回数に合わせて拡大する
+	if (actualTryCount > 0)
+	{
+		PlayoutCounts playoutCounts;
+		for (uint32 w = 0; w < WorkerCount; ++w)
+		{
+			playoutCounts.moveCount += playoutCountsByWorker[w]->moveCount;
+			playoutCounts.mercyCount += playoutCountsByWorker[w]->mercyCount;
+		}
+
+		const double Scale = static_cast<double>(mirroredTryCount) / actualTryCount;
+		outStats.playoutMoveCount += std::llround(playoutCounts.moveCount * Scale);
+		outStats.mercyTryCount += std::llround(playoutCounts.mercyCount * Scale);
+	}
+
+	// 前回までの成績と足し合わせた結果を、評価キャッシュに書き戻す
+	if (options.evalCache) options.evalCache->Store(stone, board, outStats);
+}
+
+Pos Simulator::SelectBest(Stone stone, const Board& board, const SimulatorOptions& options, const RootStats& stats, double* outWinRate, vec<double>* outOwnership, std::pair<double, double>* outConfidenceInterval)
+{
+	TRACE_SCOPE("Simulator::SelectBest");
+
+	// 戦術的な事前評価を、何回分の試行とみなして勝率に混ぜるか
+	// 良い手は勝率 HighPriorWinRate、悪い手は勝率 LowPriorWinRate の試行が、これだけあったものとみなす
+	const uint64 PriorCount = std::max<uint64>(GetThinkCount(options) >> 2, 1);
+	constexpr double HighPriorWinRate = 0.75;
+	constexpr double LowPriorWinRate = 0.25;
+
+	const uint8 size = board.GetSize();
+	const autosize PositionsCount = board.GetPositionsCount();
+
+	// 勝率の信頼区間の下限が最大の候補手を探す
+	// 試行回数の少ない候補手 (Successive Halving で早めに外れたものなど) が、たまたま高い勝率で選ばれないようにする
 
 	Pos bestPos = { 0, 0 };
 	double bestWinRate = MIN_double;
+	double bestLowerBound = MIN_double;
+	std::pair<double, double> bestConfidenceInterval = { 0.0, 0.0 };
 
-	for (uint8 x = 1; x <= Size; ++x)
-		for (uint8 y = 1; y <= Size; ++y)
+	for (uint8 x = 1; x <= size; ++x)
+		for (uint8 y = 1; y <= size; ++y)
 		{
-			if (board.GetStone(x, y) != Stone::Empty) continue;
+			const autosize Idx = (x - 1) + (y - 1) * size;
+			if (Idx >= stats.tryCounts.size() || stats.tryCounts[Idx] == 0) continue;
+
+			// 戦術的な事前評価 (アタリ・石取り・シチョウ)
+			const int8 Evaluation = options.rootPriors ? Tactics::EvaluateMove(stone, board, { x, y }) : 0;
+			const double PriorWins =
+				Evaluation > 0 ? PriorCount * HighPriorWinRate :
+				Evaluation < 0 ? PriorCount * LowPriorWinRate : 0.0;
+			const uint64 PriorTotal = Evaluation != 0 ? PriorCount : 0;
 
-			double winRate = winRates[(x - 1) + (y - 1) * Size];
-			if (winRate > bestWinRate)
+			// 試行の結果を集計し、勝率と、その信頼区間を算出する
+			const double WinCount = stats.winCounts[Idx] + PriorWins;
+			const double TryCount = static_cast<double>(stats.tryCounts[Idx] + PriorTotal);
+			const double WinRate = std::clamp(WinCount / TryCount, 0.0, 1.0);  // 最終数値
+			const std::pair<double, double> ConfidenceInterval = GetConfidenceInterval(WinCount, TryCount);
+
+			if (ConfidenceInterval.first > bestLowerBound)
 			{
-				bestWinRate = winRate;
+				bestLowerBound = ConfidenceInterval.first;
+				bestWinRate = WinRate;
+				bestConfidenceInterval = ConfidenceInterval;
 				bestPos = { x, y };
 			}
 		}
 
+	// 帰属を集計し、-1.0 (白のもの) から 1.0 (黒のもの) の値にする
+	if (outOwnership)
+	{
+		outOwnership->assign(PositionsCount, 0.0);
+		if (stats.totalTryCount > 0 && stats.ownershipCounts.size() == PositionsCount)
+			for (autosize i = 0; i < PositionsCount; ++i)
+				(*outOwnership)[i] = static_cast<double>(stats.ownershipCounts[i]) / stats.totalTryCount;
+	}
+
 	// 値を返す
 	if (outWinRate)
 		*outWinRate = bestWinRate;
+	if (outConfidenceInterval)
+		*outConfidenceInterval = bestConfidenceInterval;
 	return bestPos;
 }
 
-Stone Simulator::__Try(Stone stone, const Board& boardTemplate, Board* outResultBoard)
+Stone Simulator::__Try(Stone stone, const Board& boardTemplate, const SimulatorOptions& options, Board* outResultBoard, vec<int32>* outOwnershipCounts)
 {
-	Stone turn = stone;
-	Board board = boardTemplate;
+	TRACE_SCOPE("Simulator::__Try");
 
-	const uint8 Size = board.GetSize();
-	const uint16 PositionsCount = board.GetPositionsCount();
-	constexpr double EarlyGameFilledRateLimit = 0.8;  // 序盤の埋まり具合の閾値 (これを越えたら、終盤とみなす)
+	PlayoutScratch& scratch = GetPlayoutScratch();
 
-	// 対局の最大手数 (同形反復の無限ループなどを回避、という理由もある)
-	// 処理コストを考慮して、上限値を設定する
-	const uint16 MaxTurns = static_cast<uint16>(std::min<uint32>(PositionsCount << 1, 200));
+	// 試行する盤面 (スレッドごとに使いまわし、コピーし直す)
+	// 最初は、棋譜などの容量を確保した空の盤面を作ってから代入する (コピーで作ると、容量が中身の分しかなく、着手するたびに確保し直す)
+	std::optional<Board>& scratchBoard = scratch.board;
+	if (!scratchBoard) scratchBoard.emplace(Board::Create(boardTemplate.GetBoardSize()));
+	*scratchBoard = boardTemplate;
+	Board& board = *scratchBoard;
 
-	// 空き点の数がこれ以下になった段階で、シミュレーションを終了する
-	// 自分の眼を潰す、などの行為を避けるため
-	constexpr uint8 EmptyCountLimit = 6;
+	// options.lastGoodReply なら、このスレッドで覚えた応手を使う (盤面の大きさが変わったら忘れる)
+	LastGoodReplies* replies = nullptr;
+	if (options.lastGoodReply)
+	{
+		replies = &scratch.replies;
+		if (replies->positionsCount != board.GetPositionsCount()) replies->Clear(board.GetPositionsCount());
+	}
 
-	// 序盤では全交点の中からランダムに、終盤では先に空き点を探しその中からランダムに、着手を試行する
-	const uint32 MaxPutChecksOnEarlyGame = PositionsCount << 1;  // 着手の最大試行回数 (序盤)
-	const uint32 MaxPutChecksOnLateGame = PositionsCount >> 2;  // 着手の最大試行回数 (終盤)
+	// 終局まで着手して、勝敗を判定する
+	const Stone Win = PlayOutAndJudge(stone, board, options, outOwnershipCounts ? outOwnershipCounts->data() : nullptr, replies, nullptr);
 
-	// 空き点の位置を調べる (終盤のみならず、盤面が埋まって来たら終局にするところでも使うので、最初に調べておく)
-	vec<Pos> emptyPositions;  // これに格納
-	emptyPositions.reserve(PositionsCount);
-	for (uint8 x = 1; x <= Size; ++x)
-		for (uint8 y = 1; y <= Size; ++y)
-			if (board.GetStone(x, y) == Stone::Empty)
-				emptyPositions.emplace_back(x, y);
+	// 値を返す
+	if (outResultBoard)
+		*outResultBoard = board;
+	return Win;
+}
+
+// 1 つのカーソル (Arena::Cursor) で、合わせて size バイトを確保するときに、アリーナから切り出すチャンクの大きさの合計
+// 1 つのチャンクに収まらなければ、チャンクの末尾の使い残しを見込んで、2 倍に見積もる (1 回の確保は、チャンクより小さいものとする)
+autosize GetCursorMemorySize(autosize size)
+{
+	const autosize ChunkCount = (size + Arena::DefaultChunkSize - 1) / Arena::DefaultChunkSize;
+	return (ChunkCount <= 1 ? 1 : ChunkCount * 2) * Arena::DefaultChunkSize;
+}
+
+// board を終局まで進め (turn の手番から)、勝った方の石の種類を返す (着手の選び方は options.playoutPolicy に従う)
+// 方策ごとに PlayOut を実体化したものを、ここで 1 回だけ選ぶ (試行の中の 1 手ごとには分岐しない)
+// 引数は PlayOut と同じ
+Stone PlayOutAndJudge(Stone turn, Board& board, const SimulatorOptions& options, int32* outOwnershipCounts, LastGoodReplies* replies, PlayoutCounts* outCounts)
+{
+	TRACE_SCOPE("Simulator::PlayOut");
+
+	switch (options.playoutPolicy)
+	{
+	case PlayoutPolicy::Random:
+		return PlayOut<RandomPolicy>(turn, board, options, outOwnershipCounts, replies, outCounts);
+	case PlayoutPolicy::Pattern:
+		return PlayOut<PatternPolicy>(turn, board, options, outOwnershipCounts, replies, outCounts);
+	case PlayoutPolicy::EyeAware:
+	default:
+		return PlayOut<EyeAwarePolicy>(turn, board, options, outOwnershipCounts, replies, outCounts);
+	}
+}
+
+// board を終局まで進め (turn の手番から)、勝った方の石の種類を返す
+// 着手の選び方・打ち切り・判定は Policy に従う (PlayoutPolicyBase を参照)
+// options.playoutTactics なら、直前の着手に応じた戦術的な手を優先する
+// replies が nullptr でないなら、その次に、直前の着手への覚えた応手を優先し、終局後にこの試行の結果で覚え直す
+// outOwnershipCounts が nullptr でないなら、終局時に黒のものとなった点に +1、白のものとなった点に -1 を加算する
+// outCounts が nullptr でないなら、打った手の数と、勝負が付いて打ち切ったか (Policy::IsDecided) を加算する
+template <class Policy>
+Stone PlayOut(Stone turn, Board& board, const SimulatorOptions& options, int32* outOwnershipCounts, LastGoodReplies* replies, PlayoutCounts* outCounts)
+{
+	const autosize FirstMoveIdx = board.GetHistory().size();
+
+	// 対局の最大手数 (options.playoutMaxTurnsRate を参照)
+	const uint32 MaxTurns = static_cast<uint32>(board.GetPositionsCount()) * options.playoutMaxTurnsRate;
+
+	PlayoutScratch& scratch = GetPlayoutScratch();
+	Policy policy(board, options, scratch);
+
+	Pos lastPos = GetLastPos(board);  // 直前の着手 (パスなら (0, 0))
+	vec<Pos>& tacticalMoves = scratch.tacticalMoves;  // 戦術的な手の候補 (使いまわす)
 
 	// 打つところがなかったら、パスする
 	// 双方がパスしたら終局
 	bool passed = false;
+	bool isDecided = false;
 
-	for (UNUSED uint64 i = 0; i < MaxTurns; ++i)
+	for (UNUSED uint32 i = 0; i < MaxTurns; ++i)
 	{
-		bool couldPut = false;
+		Pos putPos;
 
-		const double BoardFilledRate = 1.0 * board.GetHistory().size() / PositionsCount;  // 簡単に、盤面の埋まり具合を計算する
-		const bool IsEarlyGame = BoardFilledRate < EarlyGameFilledRateLimit;  // 序盤かどうか判定する
-		if (IsEarlyGame)
+		// 戦術的な手・覚えた応手があれば、優先して打つ
+		// 無ければ、方策に従って打つ
+		bool couldPut = false;
+		if ((options.playoutTactics && TryTacticalMove(turn, board, lastPos, tacticalMoves, putPos)) ||
+			(replies && TryReply(turn, board, lastPos, *replies, putPos)))
 		{
-			for (UNUSED uint32 j = 0; j < MaxPutChecksOnEarlyGame; ++j)
-			{
-				// ランダムに交点を選ぶ
-				uint8 x, y;
-				do
-				{
-					x = static_cast<uint8>(Rand::Range(1, Size + 1));
-					y = static_cast<uint8>(Rand::Range(1, Size + 1));
-				} while (board.GetStone(x, y) != Stone::Empty);
-
-				// 着手を試行する
-				if (!board.PutStone(x, y, turn)) continue;
-
-				// 着手できた
-				{
-					// 空き点から削除
-					auto it = std::find(emptyPositions.begin(), emptyPositions.end(), Pos(x, y));
-					if (it != emptyPositions.end())
-						emptyPositions.erase(it);
-				}
-				couldPut = true;
-				break;
-			}
+			policy.OnForcedPut(putPos);
+			couldPut = true;
 		}
 		else
-		{
-			// 空き点があるならば、そこからランダムに着手を試行する
-			if (!emptyPositions.empty())
-			{
-				for (UNUSED uint32 j = 0; j < MaxPutChecksOnLateGame; ++j)
-				{
-					// ランダムに空き点を選ぶ
-					const autosize Idx = Rand::Range(0, emptyPositions.size() - 1);
-					const Pos& pos = emptyPositions[Idx];
-
-					// 着手を試行する
-					if (!board.PutStone(pos, turn)) continue;
-
-					// 着手できた
-					emptyPositions.erase(emptyPositions.begin() + Idx);  // 空き点から削除
-					couldPut = true;
-					break;
-				}
-			}
-		}
+			couldPut = policy.PutMove(turn, lastPos, putPos);
 
 		// 着手箇所がなかった
 		if (!couldPut)
@@ -202,6 +878,7 @@ Stone Simulator::__Try(Stone stone, const Board& boardTemplate, Board* outResult
 			{
 				// パスする
 				passed = true;
+				lastPos = { 0, 0 };
 				turn = ReverseStone(turn);
 				continue;
 			}
@@ -210,21 +887,230 @@ Stone Simulator::__Try(Stone stone, const Board& boardTemplate, Board* outResult
 			passed = false;
 
 		// 着手できた
+		lastPos = putPos;
+		policy.OnPut(putPos);
 
-		// 終局判定
+		// 勝負が付いたなら、打ち切る
+		if (policy.IsDecided())
 		{
-			const autosize EmptyCount = emptyPositions.size();
-			if (EmptyCount <= EmptyCountLimit)
-				break;
+			isDecided = true;
+			break;
 		}
 
 		turn = ReverseStone(turn);
 	}
 
+	if (outCounts)
+	{
+		outCounts->moveCount += board.GetHistory().size() - FirstMoveIdx;
+		if (isDecided) ++outCounts->mercyCount;
+	}
+
 	// 終局した
+	const Stone Winner = policy.Judge(outOwnershipCounts);
+	if (replies) UpdateReplies(board, FirstMoveIdx, Winner, *replies);
+	return Winner;
+}
 
-	// 値を返す
-	if (outResultBoard)
-		*outResultBoard = board;
-	return Judge(board);
+// 盤上の黒石と白石の数の差が options.playoutMercyThreshold 以上になり、試行を打ち切ってよいか (0 なら打ち切らない)
+bool IsMercy(const Board& board, const SimulatorOptions& options)
+{
+	return options.playoutMercyThreshold > 0 && std::abs(board.GetStoneBalance()) >= options.playoutMercyThreshold;
+}
+
+// 呼び出したスレッドの、終局までの試行用の作業領域を返す
+PlayoutScratch& GetPlayoutScratch()
+{
+	thread_local PlayoutScratch scratch;
+	return scratch;
+}
+
+// 盤面の空き点の位置を、outEmptyPositions に格納する (中身は上書きされる)
+// 左上角が (1, 1), 右下角が (size, size) の座標系
+void GetEmptyPositions(const Board& board, vec<Pos>& outEmptyPositions)
+{
+	const uint8 size = board.GetSize();
+
+	outEmptyPositions.clear();
+	for (uint8 x = 1; x <= size; ++x)
+		for (uint8 y = 1; y <= size; ++y)
+			if (board.GetStone(x, y) == Stone::Empty)
+				outEmptyPositions.emplace_back(x, y);
+}
+
+// 直前の着手 lastPos に応じた戦術的な手 (Tactics::GetTacticalMoves) を、順に試行する
+// 着手できたら true を返し、その座標を outPos に格納する
+// tacticalMoves は候補を格納するための作業用
+bool TryTacticalMove(Stone turn, Board& board, const Pos& lastPos, vec<Pos>& tacticalMoves, Pos& outPos)
+{
+	Tactics::GetTacticalMoves(turn, board, lastPos, tacticalMoves);
+
+	for (const Pos& pos : tacticalMoves)
+	{
+		if (!board.PutStone(pos, turn)) continue;
+
+		outPos = pos;
+		return true;
+	}
+	return false;
+}
+
+// 直前の着手 lastPos への、覚えた応手 replies を試行する (自分の眼は潰さない)
+// 着手できたら true を返し、その座標を outPos に格納する
+bool TryReply(Stone turn, Board& board, const Pos& lastPos, const LastGoodReplies& replies, Pos& outPos)
+{
+	if (lastPos == Pos(0, 0)) return false;
+
+	const uint8 size = board.GetSize();
+	const uint16 Reply = replies.replies[turn == Stone::Black ? 0 : 1][(lastPos.x - 1) + (lastPos.y - 1) * size];
+	if (Reply == LastGoodReplies::NoReply) return false;
+
+	const Pos ReplyPos = { static_cast<uint8>(Reply % size + 1), static_cast<uint8>(Reply / size + 1) };
+	if (!board.IsLegal(ReplyPos, turn) || board.IsEye(ReplyPos, turn)) return false;
+	if (!board.PutStone(ReplyPos, turn)) return false;
+
+	outPos = ReplyPos;
+	return true;
+}
+
+// 終局した試行の棋譜 (board の棋譜の firstMoveIdx 手目以降と、その直前の手) から、応手を覚え直す
+// 勝った側の応手は覚え、負けた側 (引き分けなら両方) の応手は、覚えていたものと同じなら忘れる
+// パスを挟んで同じ側が続けて打った手は、応手とみなさない
+void UpdateReplies(const Board& board, autosize firstMoveIdx, Stone winner, LastGoodReplies& replies)
+{
+	const vec<PosStone>& History = board.GetHistory();
+	const uint8 size = board.GetSize();
+
+	for (autosize i = std::max<autosize>(firstMoveIdx, 1); i < History.size(); ++i)
+	{
+		const PosStone& Previous = History[i - 1];
+		const PosStone& Reply = History[i];
+		if (Previous.stone == Reply.stone) continue;
+
+		uint16& stored = replies.replies[Reply.stone == Stone::Black ? 0 : 1][(Previous.pos.x - 1) + (Previous.pos.y - 1) * size];
+		const uint16 ReplyIdx = static_cast<uint16>((Reply.pos.x - 1) + (Reply.pos.y - 1) * size);
+		if (Reply.stone == winner) stored = ReplyIdx;
+		else if (stored == ReplyIdx) stored = LastGoodReplies::NoReply;
+	}
+}
+
+// 盤面の、直前の着手の座標を返す (まだ着手が無いなら (0, 0))
+Pos GetLastPos(const Board& board)
+{
+	const vec<PosStone>& History = board.GetHistory();
+	return History.empty() ? Pos(0, 0) : History.back().pos;
+}
+
+// 盤面の石の配置 stones (一辺 size) について、勝敗判定を行う (Simulator::Judge を参照)
+// outOwnershipCounts が nullptr でないなら、黒のものとなった点に +1、白のものとなった点に -1 を加算する
+Stone JudgeStones(const vec<Stone>& stones, uint8 size, int32* outOwnershipCounts)
+{
+	TRACE_SCOPE("Simulator::Judge");
+
+	const int32 Score = ScoreStones(stones, size, outOwnershipCounts);
+	if (Score > 0) return Stone::Black;
+	if (Score < 0) return Stone::White;
+	return Stone::Empty;
+}
+
+// 盤面の石の配置 stones (一辺 size) について、黒から見た、コミを含めた点数の差を返す (Simulator::GetScore を参照)
+// outOwnershipCounts が nullptr でないなら、黒のものとなった点に +1、白のものとなった点に -1 を加算する
+int32 ScoreStones(const vec<Stone>& stones, uint8 size, int32* outOwnershipCounts)
+{
+	constexpr uint8 Comi = 7;  // コミ (黒が出す)
+
+	const autosize PositionsCount = stones.size();
+
+	// 黒石と白石の数、及び、一方の石だけに囲まれた空き点 (地) の数をカウントする
+	// (中国ルールの、面積計算から着想を得た. 死石の判定は行わない)
+	autosize blackScore = 0, whiteScore = 0;
+
+	PlayoutScratch& scratch = GetPlayoutScratch();
+	vec<bool>& visited = scratch.visited;  // 探索済みの空き点
+	visited.assign(PositionsCount, false);
+	vec<autosize>& stack = scratch.stack;  // 探索中の空き点のインデックス
+	stack.clear();
+	stack.reserve(PositionsCount);
+	vec<autosize>& region = scratch.region;  // 探索した空き点のインデックス
+	region.clear();
+	region.reserve(PositionsCount);
+
+	for (autosize i = 0; i < PositionsCount; ++i)
+	{
+		const Stone stone = stones[i];
+		if (stone == Stone::Black)
+		{
+			++blackScore;
+			if (outOwnershipCounts) ++outOwnershipCounts[i];
+			continue;
+		}
+		if (stone == Stone::White)
+		{
+			++whiteScore;
+			if (outOwnershipCounts) --outOwnershipCounts[i];
+			continue;
+		}
+		if (visited[i]) continue;
+
+		// 空き点の領域を探索し、その領域が接している石の種類を調べる
+		autosize regionSize = 0;
+		bool touchesBlack = false, touchesWhite = false;
+		const autosize RegionBegin = region.size();  // 帰属を加算するために、領域の点も記録しておく
+
+		visited[i] = true;
+		stack.push_back(i);
+		while (!stack.empty())
+		{
+			const autosize idx = stack.back();
+			stack.pop_back();
+			++regionSize;
+			region.push_back(idx);
+
+			const autosize x = idx % size, y = idx / size;
+			const autosize neighbors[4] = { idx - size, idx + size, idx - 1, idx + 1 };  // 上下左右
+			const bool valid[4] = { y > 0, y < size - 1u, x > 0, x < size - 1u };
+			for (uint8 j = 0; j < 4; ++j)
+			{
+				if (!valid[j]) continue;
+
+				const autosize n = neighbors[j];
+				const Stone neighborStone = stones[n];
+				if (neighborStone == Stone::Black) touchesBlack = true;
+				else if (neighborStone == Stone::White) touchesWhite = true;
+				else if (!visited[n])
+				{
+					visited[n] = true;
+					stack.push_back(n);
+				}
+			}
+		}
+
+		// 一方の石だけに接しているなら、その石の地とする
+		const int32 Owner = (touchesBlack && !touchesWhite) ? 1 : (touchesWhite && !touchesBlack) ? -1 : 0;
+		if (Owner > 0) blackScore += regionSize;
+		else if (Owner < 0) whiteScore += regionSize;
+
+		if (outOwnershipCounts && Owner != 0)
+			for (autosize j = RegionBegin; j < region.size(); ++j)
+				outOwnershipCounts[region[j]] += Owner;
+	}
+
+	whiteScore += Comi;  // コミを白に加算する
+
+	return static_cast<int32>(blackScore) - static_cast<int32>(whiteScore);
+}
+
+// tryCount 回中 winCount 回勝ったときの、勝率の 95% 信頼区間 (下限, 上限) を返す (Wilson score interval)
+// 試行回数が少ないほど広くなり、勝率が 0 や 1 に近くても、区間が [0, 1] からはみ出さない
+std::pair<double, double> GetConfidenceInterval(double winCount, double tryCount)
+{
+	constexpr double Z = 1.96;  // 95% に対応する、標準正規分布の値
+
+	if (tryCount <= 0.0) return { 0.0, 1.0 };
+
+	const double WinRate = std::clamp(winCount / tryCount, 0.0, 1.0);
+	const double Denominator = 1.0 + Z * Z / tryCount;
+	const double Center = (WinRate + Z * Z / (2.0 * tryCount)) / Denominator;
+	const double Radius = Z * std::sqrt(WinRate * (1.0 - WinRate) / tryCount + Z * Z / (4.0 * tryCount * tryCount)) / Denominator;
+	return { std::max(Center - Radius, 0.0), std::min(Center + Radius, 1.0) };
 }
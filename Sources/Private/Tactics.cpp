@@ -0,0 +1,258 @@
+﻿#include <Tactics.hpp>
+
+using namespace Shusaku;
+
+// 読みの 1 段分の作業領域 (盤面のコピーと、呼吸点などを格納する配列)
+// 読みの深さごとに 1 つずつ、スレッドごとに使いまわすので、確保は最初の数回の読みだけで済む
+struct ReadingFrame final
+{
+	std::optional<Board> board;  // 着手してみるための盤面
+	vec<Pos> liberties;
+	vec<Pos> chain;
+	vec<Pos> positions;
+};
+
+// ReadingFrame を 1 つ借り、スコープを抜けたら返す
+// 読みの関数が再帰するたびに、1 段深い ReadingFrame を借りる
+class ScopedReadingFrame final
+{
+public:
+
+	ScopedReadingFrame();
+	~ScopedReadingFrame();
+
+	ScopedReadingFrame(const ScopedReadingFrame&) = delete;
+	ScopedReadingFrame& operator=(const ScopedReadingFrame&) = delete;
+
+	inline ReadingFrame* operator->() const { return frame; }
+
+	// 作業用の盤面に board をコピーして返す
+	Board& CopyBoard(const Board& board);
+
+private:
+
+	// スレッドごとの、読みの深さ分の ReadingFrame (借りている間に追加されても、アドレスが変わらないように、個別に確保する)
+	static vec<std::unique_ptr<ReadingFrame>>& GetFrames();
+	static autosize& GetDepth();
+
+	ReadingFrame* frame;
+};
+
+static bool HasCapturableNeighbor(const Board& board, const Pos& chainPos, vec<Pos>* outCapturePositions = nullptr);
+static void AddUnique(vec<Pos>& positions, const Pos& pos);
+
+void Tactics::GetTacticalMoves(Stone stone, const Board& board, const Pos& lastPos, vec<Pos>& outMoves, int32 ladderBudget)
+{
+	outMoves.clear();
+
+	// 直前の着手がない (パスした・最初の手番) か、直前の着手の石が既に無い
+	const Stone OppoStone = ReverseStone(stone);
+	if (lastPos == Pos(0, 0) || board.GetStone(lastPos) != OppoStone) return;
+
+	ScopedReadingFrame frame;
+	vec<Pos>& liberties = frame->liberties;
+
+	// 1. 直前の着手の石がアタリなら、取る
+	if (board.GetLiberties(lastPos, liberties, 2) == 1)
+		AddUnique(outMoves, liberties[0]);
+
+	// 2. 直前の着手に接する自分の連がアタリなら、逃げる
+	arr<Pos, 4> neighbors;
+	const uint8 NeighborCount = board.GetNeighbors(lastPos, neighbors);
+	vec<Pos>& handledLiberties = frame->chain;  // 同じ連を何度も調べないように、調べたアタリの連の呼吸点を記録する
+	handledLiberties.clear();
+	for (uint8 i = 0; i < NeighborCount; ++i)
+	{
+		const Pos& chainPos = neighbors[i];
+		if (board.GetStone(chainPos) != stone) continue;
+		if (board.GetLiberties(chainPos, liberties, 2) != 1) continue;
+
+		const Pos Liberty = liberties[0];
+		if (std::find(handledLiberties.begin(), handledLiberties.end(), Liberty) != handledLiberties.end()) continue;
+		handledLiberties.push_back(Liberty);
+
+		// 2a. 周りの相手の連でアタリのものがあれば、取って逃げる
+		vec<Pos>& capturePositions = frame->positions;
+		if (HasCapturableNeighbor(board, chainPos, &capturePositions))
+			for (const Pos& pos : capturePositions)
+				AddUnique(outMoves, pos);
+
+		// 2b. 呼吸点に伸びて逃げる (伸びた後に呼吸点が 2 つなら、シチョウで取られないことを確認する)
+		Board& escapedBoard = frame.CopyBoard(board);
+		if (!escapedBoard.PutStone(Liberty, stone)) continue;
+
+		const uint16 LibertyCount = escapedBoard.GetLiberties(Liberty, liberties, 3);
+		if (LibertyCount >= 3 || (LibertyCount == 2 && !CanCaptureByLadder(escapedBoard, Liberty, ladderBudget)))
+			AddUnique(outMoves, Liberty);
+	}
+}
+
+int8 Tactics::EvaluateMove(Stone stone, const Board& board, const Pos& pos, int32 ladderBudget)
+{
+	ScopedReadingFrame frame;
+	vec<Pos>& liberties = frame->liberties;
+
+	Board& movedBoard = frame.CopyBoard(board);
+	if (!movedBoard.PutStone(pos, stone)) return 0;
+
+	// 相手の石を取る手
+	if (!movedBoard.GetLastTakenStones().empty()) return 1;
+
+	// 着手前に、接する自分の連がアタリだったか (= 逃げる手か)
+	bool isEscape = false;
+	{
+		arr<Pos, 4> neighbors;
+		const uint8 NeighborCount = board.GetNeighbors(pos, neighbors);
+		for (uint8 i = 0; i < NeighborCount; ++i)
+		{
+			if (board.GetStone(neighbors[i]) != stone) continue;
+			if (board.GetLiberties(neighbors[i], liberties, 2) == 1)
+			{
+				isEscape = true;
+				break;
+			}
+		}
+	}
+
+	const uint16 LibertyCount = movedBoard.GetLiberties(pos, liberties, 3);
+
+	// 自分からアタリになる手 (逃げ損ねた手も含む)
+	if (LibertyCount <= 1) return -1;
+
+	// 逃げる手は、シチョウで取られないなら良い手
+	if (isEscape)
+	{
+		if (LibertyCount >= 3) return 1;
+		return CanCaptureByLadder(movedBoard, pos, ladderBudget) ? -1 : 1;
+	}
+
+	return 0;
+}
+
+bool Tactics::CanCaptureByLadder(const Board& board, const Pos& chainPos, int32& budget)
+{
+	const Stone Defender = board.GetStone(chainPos);
+	if (Defender == Stone::Empty) return true;  // 既に取られている
+	const Stone Attacker = ReverseStone(Defender);
+
+	ScopedReadingFrame frame;
+	vec<Pos>& liberties = frame->liberties;
+	const uint16 LibertyCount = board.GetLiberties(chainPos, liberties, 3);
+	if (LibertyCount >= 3) return false;
+	if (LibertyCount <= 1) return true;
+
+	// どちらかの呼吸点から当てて、逃げられなくなれば取れる
+	for (const Pos& liberty : liberties)
+	{
+		if (--budget < 0) return false;  // 読み切れなかった
+
+		Board& attackedBoard = frame.CopyBoard(board);
+		if (!attackedBoard.PutStone(liberty, Attacker)) continue;
+
+		if (!CanEscapeFromAtari(attackedBoard, chainPos, budget))
+			return true;
+	}
+	return false;
+}
+
+bool Tactics::CanEscapeFromAtari(const Board& board, const Pos& chainPos, int32& budget)
+{
+	const Stone Defender = board.GetStone(chainPos);
+	if (Defender == Stone::Empty) return false;  // 既に取られている
+
+	ScopedReadingFrame frame;
+	vec<Pos>& liberties = frame->liberties;
+	const uint16 LibertyCount = board.GetLiberties(chainPos, liberties, 2);
+	if (LibertyCount >= 2) return true;
+	if (LibertyCount == 0) return false;
+
+	// 周りの相手の連を取れるなら、呼吸点が増えるので逃げられるものとみなす
+	if (HasCapturableNeighbor(board, chainPos)) return true;
+
+	if (--budget < 0) return true;  // 読み切れなかった
+
+	// 呼吸点に伸びて、それでも取られるかどうか
+	Board& escapedBoard = frame.CopyBoard(board);
+	if (!escapedBoard.PutStone(liberties[0], Defender)) return false;
+
+	return !CanCaptureByLadder(escapedBoard, chainPos, budget);
+}
+
+// chainPos の連に接する相手の連の中に、アタリのもの (取れるもの) があるかどうかを返す
+// outCapturePositions が nullptr でないなら、取るための着手点を全て格納する (中身は上書きされる)
+bool HasCapturableNeighbor(const Board& board, const Pos& chainPos, vec<Pos>* outCapturePositions)
+{
+	if (outCapturePositions) outCapturePositions->clear();
+
+	const Stone OppoStone = ReverseStone(board.GetStone(chainPos));
+
+	ScopedReadingFrame frame;
+	vec<Pos>& chain = frame->chain;
+	vec<Pos>& liberties = frame->liberties;
+	board.GetChain(chainPos, chain);
+
+	bool found = false;
+	arr<Pos, 4> neighbors;
+	for (const Pos& stonePos : chain)
+	{
+		const uint8 NeighborCount = board.GetNeighbors(stonePos, neighbors);
+		for (uint8 i = 0; i < NeighborCount; ++i)
+		{
+			if (board.GetStone(neighbors[i]) != OppoStone) continue;
+			if (board.GetLiberties(neighbors[i], liberties, 2) != 1) continue;
+
+			found = true;
+			if (!outCapturePositions) return true;
+			AddUnique(*outCapturePositions, liberties[0]);
+		}
+	}
+	return found;
+}
+
+// positions に pos がまだ含まれていなければ、追加する
+void AddUnique(vec<Pos>& positions, const Pos& pos)
+{
+	if (std::find(positions.begin(), positions.end(), pos) == positions.end())
+		positions.push_back(pos);
+}
+
+ScopedReadingFrame::ScopedReadingFrame()
+{
+	vec<std::unique_ptr<ReadingFrame>>& frames = GetFrames();
+	autosize& depth = GetDepth();
+	if (depth == frames.size())
+	{
+		// 呼吸点などの配列は、盤面の点の数を越えないので、最大の盤面の分を確保しておく
+		std::unique_ptr<ReadingFrame>& newFrame = frames.emplace_back(std::make_unique<ReadingFrame>());
+		newFrame->liberties.reserve(Board::MaxPositionsCount);
+		newFrame->chain.reserve(Board::MaxPositionsCount);
+		newFrame->positions.reserve(Board::MaxPositionsCount);
+	}
+	frame = frames[depth++].get();
+}
+
+ScopedReadingFrame::~ScopedReadingFrame()
+{
+	--GetDepth();
+}
+
+Board& ScopedReadingFrame::CopyBoard(const Board& board)
+{
+	// コピー代入なら、盤面の配列の容量を使いまわせる
+	// 最初は、棋譜などの容量を確保した空の盤面を作ってから代入する (コピーで作ると、容量が中身の分しかなく、着手するたびに確保し直す)
+	if (!frame->board) frame->board.emplace(Board::Create(board.GetBoardSize()));
+	*frame->board = board;
+	return *frame->board;
+}
+
+vec<std::unique_ptr<ReadingFrame>>& ScopedReadingFrame::GetFrames()
+{
+	thread_local vec<std::unique_ptr<ReadingFrame>> frames;
+	return frames;
+}
+
+autosize& ScopedReadingFrame::GetDepth()
+{
+	thread_local autosize depth = 0;
+	return depth;
+}
@@ -0,0 +1,244 @@
+﻿#include <Tournament.hpp>
+#include <Simulator.hpp>
+
+using namespace Shusaku;
+
+// 1 つのエンジンの、思考の集計
+struct EngineUsage final
+{
+	uint64 moveCount = 0;
+	uint64 playoutCount = 0;
+	uint64 playoutMoveCount = 0;  // 試行で打った手の数の合計
+	uint64 mercyCount = 0;  // 石の数の差で打ち切った試行の回数
+	double seconds = 0.0;
+};
+
+static Stone PlayGame(BoardSize boardSize, const arr<const SimulatorOptions*, 2>& options, const arr<uint64, 2>& tryCounts, const TournamentOptions& tournamentOptions, arr<EngineUsage, 2>& outUsages);
+static Pos ThinkCounted(Stone stone, const Board& board, const SimulatorOptions& options, uint64 tryCount, double& outWinRate, EngineUsage& outUsage);
+static void UpdateStatistics(const TournamentOptions& tournamentOptions, TournamentResult& outResult);
+static double ScoreToElo(double score);
+static double EloToScore(double elo);
+
+TournamentResult Tournament::Run(BoardSize boardSize, const SimulatorOptions& optionsA, const SimulatorOptions& optionsB, const TournamentOptions& tournamentOptions, std::ostream* progress)
+{
+	// 各対局の探索は 1 スレッドで行い、対局の間で並列にする
+	// 試行回数は、元の設定 (のスレッド数) で決まる回数のままにする
+	const arr<uint64, 2> TryCounts = { Simulator::GetThinkCount(optionsA), Simulator::GetThinkCount(optionsB) };
+	arr<SimulatorOptions, 2> gameOptions = { optionsA, optionsB };
+	for (SimulatorOptions& options : gameOptions)
+	{
+		options.threadCount = 1;
+		options.cpus.clear();
+	}
+
+	TournamentResult result;
+	arr<EngineUsage, 2> usages{};
+	std::mutex resultMutex;
+	std::atomic<uint32> nextGame = 0;
+	std::atomic<bool> isDecided = false;
+
+	const uint32 HardwareThreads = std::max<uint32>(std::thread::hardware_concurrency(), 1);
+	const uint32 ParallelCount = tournamentOptions.parallelGameCount > 0 ? tournamentOptions.parallelGameCount : HardwareThreads;
+	const uint32 WorkerCount = std::min(ParallelCount, tournamentOptions.maxGameCount);
+
+	vec<std::future<void>> futures;
+	futures.reserve(WorkerCount);
+	for (uint32 w = 0; w < WorkerCount; ++w)
+	{
+		futures.emplace_back(std::async(std::launch::async,
+			[&, w]()
+			{
+				// CPU の番号が指定されていれば、このスレッドを固定する (探索のスレッドも引き継ぐ)
+				if (!optionsA.cpus.empty())
+					CpuAffinity::PinCurrentThread({ optionsA.cpus[w % optionsA.cpus.size()] });
+
+				for (uint32 g = nextGame++; g < tournamentOptions.maxGameCount && !isDecided; g = nextGame++)
+				{
+					// 偶数局目は A が黒番、奇数局目は B が黒番
+					const bool IsABlack = (g & 1) == 0;
+					const arr<const SimulatorOptions*, 2> Players = IsABlack ?
+						arr<const SimulatorOptions*, 2>{ &gameOptions[0], &gameOptions[1] } :
+						arr<const SimulatorOptions*, 2>{ &gameOptions[1], &gameOptions[0] };
+					const arr<uint64, 2> PlayerTryCounts = IsABlack ?
+						arr<uint64, 2>{ TryCounts[0], TryCounts[1] } :
+						arr<uint64, 2>{ TryCounts[1], TryCounts[0] };
+
+					arr<EngineUsage, 2> gameUsages{};
+					const Stone Win = PlayGame(boardSize, Players, PlayerTryCounts, tournamentOptions, gameUsages);
+					const Stone AStone = IsABlack ? Stone::Black : Stone::White;
+
+					// 結論が出た時点で進んでいた対局も、結果には含める (結論は変えない)
+					std::lock_guard<std::mutex> lock(resultMutex);
+					if (Win == Stone::Empty) ++result.drawCount;
+					else if (Win == AStone) ++result.winCount;
+					else ++result.lossCount;
+					for (uint32 p = 0; p < 2; ++p)
+					{
+						EngineUsage& usage = usages[(p == 0) == IsABlack ? 0 : 1];
+						usage.moveCount += gameUsages[p].moveCount;
+						usage.playoutCount += gameUsages[p].playoutCount;
+						usage.playoutMoveCount += gameUsages[p].playoutMoveCount;
+						usage.mercyCount += gameUsages[p].mercyCount;
+						usage.seconds += gameUsages[p].seconds;
+					}
+
+					UpdateStatistics(tournamentOptions, result);
+					if (!isDecided && result.decision != TournamentResult::Decision::None)
+						isDecided = true;
+
+					if (progress)
+					{
+						*progress << "Game " << (result.winCount + result.lossCount + result.drawCount) << ": ";
+						Print(*progress, result);
+					}
+				}
+			}
+		));
+	}
+	for (auto& future : futures)
+		future.get();
+
+	// 1 手あたりの思考時間と、1 秒あたりの試行回数
+	const auto GetSecondsPerMove = [](const EngineUsage& usage) { return usage.moveCount > 0 ? usage.seconds / usage.moveCount : 0.0; };
+	const auto GetPlayoutsPerSecond = [](const EngineUsage& usage) { return usage.seconds > 0.0 ? usage.playoutCount / usage.seconds : 0.0; };
+	result.secondsPerMoveA = GetSecondsPerMove(usages[0]);
+	result.secondsPerMoveB = GetSecondsPerMove(usages[1]);
+	result.playoutsPerSecondA = GetPlayoutsPerSecond(usages[0]);
+	result.playoutsPerSecondB = GetPlayoutsPerSecond(usages[1]);
+
+	// 1 回の試行の平均の手数と、石の数の差で打ち切った試行の割合
+	const auto GetPlayoutLength = [](const EngineUsage& usage) { return usage.playoutCount > 0 ? static_cast<double>(usage.playoutMoveCount) / usage.playoutCount : 0.0; };
+	const auto GetMercyRate = [](const EngineUsage& usage) { return usage.playoutCount > 0 ? static_cast<double>(usage.mercyCount) / usage.playoutCount : 0.0; };
+	result.playoutLengthA = GetPlayoutLength(usages[0]);
+	result.playoutLengthB = GetPlayoutLength(usages[1]);
+	result.mercyRateA = GetMercyRate(usages[0]);
+	result.mercyRateB = GetMercyRate(usages[1]);
+	return result;
+}
+
+void Tournament::Print(std::ostream& output, const TournamentResult& result)
+{
+	const str Decision =
+		result.decision == TournamentResult::Decision::AcceptH1 ? "H1 accepted" :
+		result.decision == TournamentResult::Decision::AcceptH0 ? "H0 accepted" : "undecided";
+
+	output << "W " << result.winCount << " L " << result.lossCount << " D " << result.drawCount
+		<< std::fixed << std::setprecision(1) << " Elo " << std::showpos << result.elo << std::noshowpos << " +- " << result.eloMargin
+		<< std::setprecision(2) << " LLR " << result.llr << " [" << result.llrLower << ", " << result.llrUpper << "] " << Decision;
+	if (result.secondsPerMoveA > 0.0 || result.secondsPerMoveB > 0.0)
+	{
+		output << std::setprecision(3) << " | s/move A " << result.secondsPerMoveA << " B " << result.secondsPerMoveB
+			<< std::setprecision(0) << " | playouts/s A " << result.playoutsPerSecondA << " B " << result.playoutsPerSecondB;
+	}
+	if (result.playoutLengthA > 0.0 || result.playoutLengthB > 0.0)
+	{
+		output << std::setprecision(1) << " | playout moves A " << result.playoutLengthA << " B " << result.playoutLengthB
+			<< " | mercy A " << result.mercyRateA * 100.0 << "% B " << result.mercyRateB * 100.0 << "%";
+	}
+	output << std::endl;
+}
+
+// options[0] (黒番) と options[1] (白番) で 1 局打ち、勝った方の石の種類を返す (引き分けなら Stone::Empty)
+// 双方がパスするか、最大手数に達したら、Simulator::Judge で判定する. 勝率が閾値を下回った側は投了する
+Stone PlayGame(BoardSize boardSize, const arr<const SimulatorOptions*, 2>& options, const arr<uint64, 2>& tryCounts, const TournamentOptions& tournamentOptions, arr<EngineUsage, 2>& outUsages)
+{
+	Board board = Board::Create(boardSize);
+	const autosize MaxTurns = static_cast<autosize>(board.GetPositionsCount()) * tournamentOptions.maxTurnsRate;
+
+	Stone turn = Stone::Black;
+	bool passed = false;
+	for (autosize t = 0; t < MaxTurns; ++t)
+	{
+		const uint32 Player = turn == Stone::Black ? 0 : 1;
+
+		// 着手を考える (時間を計る)
+		double winRate = MIN_double;
+		EngineUsage& usage = outUsages[Player];
+		const auto Begin = std::chrono::steady_clock::now();
+		const Pos NextPos = ThinkCounted(turn, board, *options[Player], tryCounts[Player], winRate, usage);
+		usage.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - Begin).count();
+		++usage.moveCount;
+
+		// 有効手が無い・パスするのが最善なら、パスする. 双方がパスしたら、終局する
+		if (NextPos == Pos(0, 0))
+		{
+			if (passed) break;
+			passed = true;
+			turn = ReverseStone(turn);
+			continue;
+		}
+
+		// 勝ち目がないので、投了する
+		if (winRate < tournamentOptions.resignThreshold)
+			return ReverseStone(turn);
+
+		passed = false;
+		if (!board.PutStone(NextPos, turn)) break;  // 発生しないはず
+		turn = ReverseStone(turn);
+	}
+
+	return Simulator::Judge(board);
+}
+
+// Simulator::Think と同じように着手を選び、そのために行った試行の回数・手数・打ち切った回数を outUsage に加算する
+// 定石・終盤の読み切りで決めた場合は、何も加算しない
+Pos ThinkCounted(Stone stone, const Board& board, const SimulatorOptions& options, uint64 tryCount, double& outWinRate, EngineUsage& outUsage)
+{
+	Pos shortcutPos;
+	if (Simulator::TryThinkWithoutSearch(stone, board, options, shortcutPos, &outWinRate))
+		return shortcutPos;
+
+	RootStats stats;
+	stats.Reset(board.GetPositionsCount(), false);
+	Simulator::Search(stone, board, options, tryCount, stats);
+	outUsage.playoutCount += stats.totalTryCount;
+	outUsage.playoutMoveCount += stats.playoutMoveCount;
+	outUsage.mercyCount += stats.mercyTryCount;
+	return Simulator::SelectBest(stone, board, options, stats, &outWinRate);
+}
+
+// 勝ち・負け・引き分けの数から、Elo 差と SPRT の対数尤度比を求め、結論が出ていれば outResult.decision に格納する
+// 対数尤度比は、1 局の得点 (勝ち 1, 引き分け 0.5, 負け 0) の平均が正規分布に従うとした近似 (GSPRT) で求める
+// 全勝・全敗で分散が 0 にならないように、勝ちと負けを 0.5 局ずつ足して求める
+void UpdateStatistics(const TournamentOptions& tournamentOptions, TournamentResult& outResult)
+{
+	const double Wins = outResult.winCount + 0.5;
+	const double Losses = outResult.lossCount + 0.5;
+	const double Draws = outResult.drawCount;
+	const double Games = Wins + Losses + Draws;
+
+	const double Score = (Wins + 0.5 * Draws) / Games;
+	const double Variance = (Wins * (1.0 - Score) * (1.0 - Score) + Losses * Score * Score + Draws * (0.5 - Score) * (0.5 - Score)) / Games;
+
+	// Elo 差と、その 95% 信頼区間
+	const double Margin = 1.96 * std::sqrt(Variance / Games);
+	outResult.elo = ScoreToElo(Score);
+	outResult.eloMargin = (ScoreToElo(Score + Margin) - ScoreToElo(Score - Margin)) * 0.5;
+
+	// SPRT
+	const double Score0 = EloToScore(tournamentOptions.elo0);
+	const double Score1 = EloToScore(tournamentOptions.elo1);
+	const uint32 GameCount = outResult.winCount + outResult.lossCount + outResult.drawCount;
+	outResult.llr = GameCount * (Score1 - Score0) * (2.0 * Score - Score0 - Score1) / (2.0 * Variance);
+	outResult.llrLower = std::log(tournamentOptions.beta / (1.0 - tournamentOptions.alpha));
+	outResult.llrUpper = std::log((1.0 - tournamentOptions.beta) / tournamentOptions.alpha);
+
+	if (outResult.decision == TournamentResult::Decision::None)
+	{
+		if (outResult.llr >= outResult.llrUpper) outResult.decision = TournamentResult::Decision::AcceptH1;
+		else if (outResult.llr <= outResult.llrLower) outResult.decision = TournamentResult::Decision::AcceptH0;
+	}
+}
+
+// 平均得点から Elo 差を求める (0, 1 に近すぎる得点は丸める)
+double ScoreToElo(double score)
+{
+	const double Clamped = std::clamp(score, 1e-6, 1.0 - 1e-6);
+	return -400.0 * std::log10(1.0 / Clamped - 1.0);
+}
+
+// Elo 差から、期待される平均得点を求める
+double EloToScore(double elo)
+{
+	return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+}
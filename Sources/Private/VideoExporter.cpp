@@ -0,0 +1,142 @@
+﻿#include <VideoExporter.hpp>
+#include <BoardRenderer.hpp>
+#include <GraphRenderer.hpp>
+
+using namespace Shusaku;
+
+// フレームのサイズ (px). 左に盤面、右に勝率のグラフ (上下中央揃え) を並べる
+static constexpr uint16 FrameWidth = BoardRenderer::ImageSize + GraphRenderer::Width;
+static constexpr uint16 FrameHeight = std::max(BoardRenderer::ImageSize, GraphRenderer::Height);
+
+VideoExporter::VideoExporter(double framesPerSecond, autosize maxQueuedFrames)
+	: framesPerSecond(framesPerSecond)
+	, maxQueuedFrames(std::max<autosize>(maxQueuedFrames, 1))
+{
+	encoder = std::thread(&VideoExporter::RunEncoder, this);
+}
+
+VideoExporter::~VideoExporter()
+{
+	// 書き出しスレッドは、予約された処理を全て終えてから止まる
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		isStopping = true;
+	}
+	queueChanged.notify_all();
+	encoder.join();
+}
+
+bool VideoExporter::Export(const str& path, BoardSize boardSize, const vec<PosStone>& history, const vec<double>& winRates)
+{
+	Push({ Job::Type::Open, "../Outputs/" + path + ".mp4", {} });
+
+	Board board = Board::Create(boardSize);
+	BoardRenderer boardRenderer;
+	GraphRenderer graph(winRates.size());
+
+	// 今の盤面と、勝率の先頭から graphPointCount 個を描いたグラフを並べて、フレームを作る
+	// 盤面もグラフも、前のフレームからの差分だけを描き足す
+	const auto MakeFrame = [&](autosize graphPointCount)
+		{
+			while (graph.GetAddedCount() < std::min(graphPointCount, winRates.size()))
+				graph.AddPoint(winRates[graph.GetAddedCount()]);
+
+			// フレームは書き出しスレッドに渡すので、毎回新しく作る
+			cv::Mat frame(FrameHeight, FrameWidth, CV_8UC3, GraphRenderer::BackgroundColor);
+			boardRenderer.Render(board).copyTo(frame(cv::Rect(0, (FrameHeight - BoardRenderer::ImageSize) >> 1, BoardRenderer::ImageSize, BoardRenderer::ImageSize)));
+			graph.GetImage().copyTo(frame(cv::Rect(BoardRenderer::ImageSize, (FrameHeight - GraphRenderer::Height) >> 1, GraphRenderer::Width, GraphRenderer::Height)));
+			return frame;
+		};
+
+	// 各着手の前の盤面
+	bool succeeded = true;
+	for (autosize i = 0; i < history.size(); ++i)
+	{
+		Push({ Job::Type::Frame, {}, MakeFrame(i) });
+
+		if (!board.PutStone(history[i].pos, history[i].stone))
+		{
+			succeeded = false;
+			break;
+		}
+	}
+
+	// 最後の盤面は、全ての勝率をグラフに描き (パスした手の勝率も含む)、少し長く表示する
+	// 同じ画像を何度か渡すだけなので、コピーはしない
+	const cv::Mat LastFrame = MakeFrame(succeeded ? winRates.size() : board.GetHistory().size());
+	for (uint32 i = 0; i < LastFrameRepeatCount; ++i)
+		Push({ Job::Type::Frame, {}, LastFrame });
+
+	Push({ Job::Type::Close, {}, {} });
+	return succeeded;
+}
+
+bool VideoExporter::Wait()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	queueChanged.wait(lock, [this]() { return jobs.empty() && !isEncoding; });
+
+	const bool Succeeded = !hasFailed;
+	hasFailed = false;
+	return Succeeded;
+}
+
+void VideoExporter::Push(Job&& job)
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (job.type == Job::Type::Frame)
+		{
+			queueChanged.wait(lock, [this]() { return queuedFrameCount < maxQueuedFrames; });
+			++queuedFrameCount;
+		}
+		jobs.push(std::move(job));
+	}
+	queueChanged.notify_all();
+}
+
+void VideoExporter::RunEncoder()
+{
+	cv::VideoWriter writer;
+
+	while (true)
+	{
+		// 次の処理を取り出す
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			queueChanged.wait(lock, [this]() { return !jobs.empty() || isStopping; });
+			if (jobs.empty()) break;  // 止める指示があり、予約された処理は全て終えた
+
+			job = std::move(jobs.front());
+			jobs.pop();
+			if (job.type == Job::Type::Frame) --queuedFrameCount;
+			isEncoding = true;
+		}
+		queueChanged.notify_all();
+
+		// 符号化して書き出す
+		bool failed = false;
+		switch (job.type)
+		{
+		case Job::Type::Open:
+			writer.open(job.path, cv::VideoWriter::fourcc('m', 'p', '4', 'v'), framesPerSecond, cv::Size(FrameWidth, FrameHeight));
+			failed = !writer.isOpened();
+			break;
+		case Job::Type::Frame:
+			if (writer.isOpened()) writer.write(job.frame);
+			break;
+		case Job::Type::Close:
+		default:
+			writer.release();
+			break;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (failed) hasFailed = true;
+			isEncoding = false;
+		}
+		queueChanged.notify_all();
+	}
+}
@@ -0,0 +1,77 @@
+﻿#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <Core.hpp>
+
+// 盤面の画像を、前回描画した盤面との差分だけ描き直して作る
+// 盤面の背景 (線・星) と石の画像は、盤面の大きさごとに 1 回だけ描いておき (全ての BoardRenderer で共有する)、
+// 前回から状態 (石・手番の数字・最新の着手かどうか) が変わった点だけ、その 1 マス分を貼り直す
+// 同じ対局を 1 手ずつ描画するなら、1 回あたりのコストは、着手した石と取った石の数に比例する程度で済む
+// 左上角が (1, 1), 右下角が (size, size) の座標系
+class BoardRenderer final
+{
+public:
+
+	// 盤面の画像のサイズ (px)
+	static constexpr uint16 ImageSize = 720;
+
+	inline BoardRenderer() = default;
+
+	BoardRenderer(const BoardRenderer&) = delete;
+	BoardRenderer& operator=(const BoardRenderer&) = delete;
+
+	// board を描画した画像を返す (次に Render を呼ぶまで有効. 描き足す・取っておく場合は、コピーすること)
+	// bWithHistory なら、棋譜に基づいて、石の上に手番の数字を描画する
+	// 前回と盤面の大きさが違うなら、全ての点を描き直す
+	const cv::Mat& Render(const Shusaku::Board& board, bool bWithHistory = true);
+
+	// 次の Render で、全ての点を描き直す
+	void Invalidate();
+
+	// 一辺 lineCount 本の盤面の画像の、1マスのサイズと、盤面の外側の余白の大きさ (px) を求める
+	static void GetLayout(uint8 lineCount, uint8& outCellSize, uint8& outMargin);
+
+private:
+
+	// 盤面の大きさごとに 1 回だけ描いておく画像
+	struct Assets final
+	{
+		uint8 cellSize = 0;  // 1マスのサイズ (px)
+		uint8 margin = 0;  // 盤面の外側の余白の大きさ (px)
+		uint16 stoneRadius = 0;  // 石の半径 (px)
+
+		cv::Mat background;  // 石のない盤面 (線・星)
+
+		// 1 マス分の石の画像 (色と不透明度) と、その種類 (GetSpriteIndex を参照)
+		// 最新の着手の石は、赤いアウトラインで囲んだものになる
+		static constexpr uint8 SpriteCount = 4;
+		arr<cv::Mat, SpriteCount> spriteColors;
+		arr<cv::Mat, SpriteCount> spriteAlphas;
+	};
+
+	// 1 つの点の、描画した状態
+	struct CellState final
+	{
+		Shusaku::Stone stone = Shusaku::Stone::Empty;
+		uint16 number = 0;  // 石の上の手番の数字 (0 なら描画しない)
+		bool isLatest = false;  // 最新の着手の石か
+
+		inline bool operator==(const CellState& other) const = default;
+	};
+
+	// boardSize の盤面の画像を、まだ描いていなければ描いて返す
+	static const Assets& GetAssets(Shusaku::BoardSize boardSize);
+	static void CreateAssets(Shusaku::BoardSize boardSize, Assets& outAssets);
+	static inline uint8 GetSpriteIndex(Shusaku::Stone stone, bool isLatest) { return (stone == Shusaku::Stone::White ? 1 : 0) + (isLatest ? 2 : 0); }
+
+	// (x, y) の 1 マス分を、背景から描き直す
+	void DrawCell(uint8 x, uint8 y, const CellState& state);
+
+	const Assets* assets = nullptr;
+	Shusaku::BoardSize boardSize = Shusaku::BoardSize::_9x9;
+
+	cv::Mat frame;  // 前回描画した画像
+	vec<CellState> cellStates;  // 前回描画した各点の状態 (空なら、全ての点を描き直す)
+	vec<uint16> numbers;  // 各点の手番の数字を求めるための作業用
+};
@@ -0,0 +1,27 @@
+﻿#pragma once
+
+#include <Core.hpp>
+
+// 空き点が少なくなった終盤の盤面を、終局まで読み切る
+// 置換表付きのアルファベータ探索で、Simulator::GetScore と同じ数え方 (面積計算, コミ込み) で、双方が最善を尽くした場合の勝ち・引き分け・負けを求める
+// 探索窓は 0 の周りの幅のないもの (-1, 1) なので、点数の差そのものは求めない (勝ち負けだけなら、その方がずっと速い)
+// 自分の眼 (1 目の真眼) を潰す手は読まない. したがって、求める結果が正確なのは、双方が自分の眼を潰さないという制限の下での最善に対してだけ
+// (眼を潰す手は、ほとんどが悪手だが、コウで手を待つ (パスと違い、続けて相手がパスしても終局しない) のに使えることがある. 読むと探索がかなり遅くなるので、読まない)
+// セキは、双方がパスして終局した盤面として数える
+// 置換表は、盤面・手番・直前の手がパスだったか・コウの状態 (コウの点と、そこに打てない手番) で引く
+// 同形反復による無限ループを避けるため、読む手数には上限を設け、そこで打ち切った盤面はそのまま数える
+// 左上角が (1, 1), 右下角が (size, size) の座標系
+class EndgameSolver final
+{
+public:
+
+	inline EndgameSolver() = delete;
+
+	// 置換表のエントリ数 (2 のべき乗)
+	static constexpr autosize TableSize = static_cast<autosize>(1) << 18;
+
+	// stone の手番で board を終局まで読み切り、最善の着手を outPos に格納する ((0, 0) ならパスが最善)
+	// 読み切れたら true を返し、outResult に、双方が最善を尽くした場合の、stone から見た結果を格納する (1 なら勝ち, 0 なら引き分け, -1 なら負け. nullptr なら行わない)
+	// timeLimit (ms) を越えたら、読むのをやめて false を返す
+	static bool Solve(Shusaku::Stone stone, const Shusaku::Board& board, uint32 timeLimit, Shusaku::Pos& outPos, int32* outResult = nullptr);
+};
@@ -0,0 +1,59 @@
+﻿#pragma once
+
+#include <Core.hpp>
+
+#include <SimulatorOptions.hpp>
+
+// Engine に評価を頼む、1 局面分
+struct EngineRequest final
+{
+	Shusaku::BoardSize boardSize = Shusaku::BoardSize::_9x9;
+	vec<Shusaku::PosStone> history;  // 空の盤面から順に打った手 (左上角が (1, 1), 右下角が (size, size) の座標系)
+	Shusaku::Stone stone = Shusaku::Stone::Black;  // 手番
+	uint64 thinkCount = 0;  // 予算 (各候補手について試行する回数. 0 なら Engine の options に従う)
+	bool withOwnership = false;  // 帰属も求めるか
+};
+
+// 1 局面分の評価結果
+struct EngineResult final
+{
+	bool isValid = false;  // 局面を作れたか (history に打てない手があったら false で、他は意味を持たない)
+	Shusaku::Pos bestPos;  // 最善手 (打てる手が無ければ (0, 0))
+	double winRate = MIN_double;  // 最善手を打った場合の、手番側の勝率 (打てる手が無ければ MIN_double)
+	vec<double> ownership;  // 帰属 (Simulator::Think を参照. withOwnership でなければ空)
+};
+
+// 画像の出力などを含まない、組み込み用のエンジン
+// 局面をまとめて受け取り、最初に立てたスレッドプールで、局面ごとに 1 スレッドずつ割り当てて評価する
+// 呼び出しのたびにスレッドを立てないので、サービスなどに組み込み、短い評価を何度も頼むのに向く
+// 複数のスレッドから同時に Evaluate を呼んでもよい (局面は同じプールで順に評価する)
+// C から使う場合は、ShusakuEngine.h を参照
+class Engine final
+{
+public:
+
+	// options の設定で評価するエンジンを作り、workerCount 本のスレッドを立てる (0 なら Simulator::GetThreadCount(options))
+	// options の定石ファイル・学習した重み・評価キャッシュは、Engine より長く生きていること
+	explicit Engine(const SimulatorOptions& options = {}, uint32 workerCount = 0);
+
+	Engine(const Engine&) = delete;
+	Engine& operator=(const Engine&) = delete;
+
+	inline const SimulatorOptions& GetOptions() const { return options; }
+	inline uint32 GetWorkerCount() const { return pool.GetThreadCount(); }
+
+	// requests の各局面を評価し、同じ順番で結果を返す
+	// 1 つの局面は 1 スレッドで Simulator::Think し (定石・終盤の読み切りも使う)、局面の間で並列にする
+	vec<EngineResult> Evaluate(const vec<EngineRequest>& requests);
+
+	// 1 つの局面を評価する
+	EngineResult Evaluate(const EngineRequest& request);
+
+private:
+
+	SimulatorOptions options;  // 局面ごとの設定 (1 スレッドで考えるようにしたもの)
+	Shusaku::ThreadPool pool;
+
+	// 1 つの局面を、呼び出したスレッドで評価する
+	EngineResult EvaluateOnCurrentThread(const EngineRequest& request) const;
+};
@@ -0,0 +1,84 @@
+﻿#pragma once
+
+#include <Core.hpp>
+
+#include <SimulatorOptions.hpp>
+#include <SearchCluster.hpp>
+#include <Tournament.hpp>
+
+// 対局の設定
+// コマンドライン引数 (--key value, --key=value) と、設定ファイル (1 行に 1 つの key = value. # 以降はコメント) から読み取る
+// 両方で指定された項目は、コマンドライン引数の値を使う
+// 指定されなかった項目は、下の初期値を使う
+struct EngineConfig final
+{
+	// 盤面のサイズ (size)
+	Shusaku::BoardSize boardSize = Shusaku::BoardSize::_9x9;
+
+	// true なら自動、false なら手動で着手する (black, white)
+	bool blackAuto = true;
+	bool whiteAuto = true;
+
+	// パス・終局を判定する際の、勝率の閾値 (win-rate-threshold)
+	double winRateThreshold = 0.1;
+	// 帰属の絶対値がこれ以上の点を、どちらのものか決まった点とみなす (settled-ownership-threshold)
+	double settledOwnershipThreshold = 0.9;
+	// 盤上の点のうち、この割合以上が決まったなら、これ以上打っても変わらないので、パスする (settled-rate-threshold)
+	// 駄目は決まらないので、1 未満にする
+	double settledRateThreshold = 0.95;
+
+	// 定石ファイルの設定
+	// bookGameCount が 0 より大きければ、対局の前に、その数だけ自己対局して定石ファイルを作り直す (book-games)
+	uint32 bookGameCount = 0;
+	uint16 bookMoveCount = 8;  // 定石ファイルに載せる、各対局の最初の手数 (book-moves)
+	uint32 bookMinTryCount = 2;  // 定石ファイルに載せる手の、打たれた対局の数の下限 (book-min-tries)
+
+	// コンピュータが着手を考える際の設定
+	// (think-count, threads, cpus, playout-policy, playout-tactics, lockstep-playouts, playout-max-turns-rate)
+	SimulatorOptions simulatorOptions{};
+
+	// 着手を考えるワーカープロセスの設定 (workers, pin-workers)
+	SearchClusterOptions clusterOptions{};
+
+	// 空でなければ、対局する代わりに、このパスの棋譜を解析する (analyze. GameAnalyzer を参照)
+	str analyzePath;
+
+	// 空でなければ、対局する代わりに、この設定 (エンジン A) と、このパスの設定ファイルで上書きした設定 (エンジン B) を対局させる (tournament. Tournament を参照)
+	str tournamentConfigPath;
+
+	// 対局させる際の設定 (tournament-games, tournament-parallel, sprt-elo0, sprt-elo1)
+	// 投了の閾値は、winRateThreshold を使う
+	TournamentOptions tournamentOptions{};
+
+	// プレイアウト用の、学習した重みのファイル (pattern-weights). 読めれば、PlayoutPolicy::Pattern で使う
+	str patternWeightsPath = "../Outputs/PatternWeights.bin";
+
+	// 空でなければ、対局する代わりに、このディレクトリの棋譜から重みを学習し、patternWeightsPath に書き出す (train-patterns. PatternTrainer を参照)
+	str trainPatternsPath;
+	uint32 trainIterationCount = 16;  // MM 法の反復回数 (train-iterations)
+
+	// 空でなければ、このパスの評価キャッシュを開き (無ければ作り)、探索で使う (eval-cache. EvalCache を参照)
+	// エンジン同士の対局では、どちらのエンジンも使わない (他の探索の結果で打つことになるため)
+	str evalCachePath;
+	uint64 evalCacheBucketCount = 65536;  // 評価キャッシュを作る時の、バケットの数 (eval-cache-buckets. 2 の冪に切り下げる)
+
+	// 使い方の表示を求められたか (help)
+	bool showHelp = false;
+
+	inline EngineConfig()
+	{
+		simulatorOptions.playoutPolicy = PlayoutPolicy::Pattern;  // 終局までの試行で、着手を選ぶ方法
+	}
+
+	// argv (argv[0] はプログラム名) から設定を読み取り、outConfig に格納する
+	// --config path が指定されていれば、先にその設定ファイルを読み取る
+	// 読み取れなかったら false を返し、outError に理由を格納する
+	static bool Parse(int argc, const char* const* argv, EngineConfig& outConfig, str* outError = nullptr);
+
+	// path の設定ファイルを読み取り、outConfig に上書きする
+	// 読み取れなかったら false を返し、outError に理由を格納する
+	static bool LoadFile(const str& path, EngineConfig& outConfig, str* outError = nullptr);
+
+	// 使い方 (指定できる項目の一覧)
+	static str GetUsage();
+};
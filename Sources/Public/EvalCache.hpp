@@ -0,0 +1,117 @@
+﻿#pragma once
+
+#include <Core.hpp>
+
+#include <RootStats.hpp>
+
+// 探索の結果 (候補手ごとの試行回数・勝ち数) を、対局・実行をまたいで残しておく、ファイル上の評価キャッシュ
+// 局面は、手番と、対称変換で正規化した盤面のハッシュ値をまとめたキー (OpeningBook::GetKey) で表す
+// ファイルは固定長のバケットの並びで、キーの下位ビットでバケットを決め、その中の数スロットから探す
+// ファイルはメモリにマップして、他のプロセスと共有したまま読み書きする
+// 各スロットはシーケンスロック (書き込み中は奇数になる番号) で守り、読む側は書き込みと重なったら読み直し、書く側は他の書き込みと重なったら諦める
+// ロックで待つことはないので、複数のスレッド・プロセスから同時に使ってよい (書き込みが重なった分は、残らないことがある)
+// 左上角が (1, 1), 右下角が (size, size) の座標系
+class EvalCache final
+{
+public:
+
+	// ファイルの先頭に置くヘッダ (64 バイト)
+	struct Header final
+	{
+		arr<char, 8> magic;  // MagicValue
+		uint32 version;  // Version
+		uint32 slotsPerBucket;  // SlotsPerBucket
+		uint64 bucketCount;  // バケットの数 (2 の冪)
+		arr<uint8, 40> reserved;
+	};
+
+	// 1 つの手の成績 (手は、正規形の盤面の上での、対称な手の代表 (Symmetry::GetCanonicalRepresentative) の座標で持つ)
+	struct Move final
+	{
+		uint8 x;
+		uint8 y;
+		arr<uint8, 2> padding;
+		uint32 tryCount;  // この手を打って試行した回数
+		uint32 winCount;  // そのうち、この手を打った側が勝った回数
+	};
+
+	// 1 つの局面の記録
+	// 手は試行回数の多い順に、最大 MaxMoveCount 個まで持つ (先頭が、最も多く試行した手 = 最善手)
+	struct Record final
+	{
+		static constexpr uint8 MaxMoveCount = 8;
+
+		uint64 key;  // 局面のキー
+		uint8 boardSize;  // 盤面の一辺 (0 なら空のスロット)
+		uint8 moveCount;
+		arr<uint8, 6> padding;
+		arr<Move, MaxMoveCount> moves;
+
+		// 記録した手の試行回数の合計
+		inline uint64 GetTryCount() const
+		{
+			uint64 tryCount = 0;
+			for (uint8 i = 0; i < moveCount; ++i)
+				tryCount += moves[i].tryCount;
+			return tryCount;
+		}
+	};
+
+	// 1 つのスロット (記録を、64 bit ずつ不可分に読み書きする語の並びとして持つ)
+	struct alignas(64) Slot final
+	{
+		static constexpr autosize WordCount = sizeof(Record) / sizeof(uint64);
+
+		uint32 sequence;  // シーケンスロックの番号 (奇数なら書き込み中)
+		uint32 padding;
+		arr<uint64, WordCount> words;
+	};
+
+	static constexpr arr<char, 8> MagicValue = { 'S', 'H', 'S', 'K', 'E', 'V', 'A', 'L' };
+	static constexpr uint32 Version = 2;  // 2: 対称な手を代表 1 つにまとめて記録する
+	static constexpr uint32 SlotsPerBucket = 4;
+	static constexpr uint64 DefaultBucketCount = static_cast<uint64>(1) << 16;  // 32 MiB
+
+	inline EvalCache() = default;
+
+	EvalCache(const EvalCache&) = delete;
+	EvalCache& operator=(const EvalCache&) = delete;
+
+	// path のキャッシュファイルを、書き込めるようにメモリにマップする
+	// 無ければ、bucketCount 個 (2 の冪に切り下げる) のバケットを持つ、空のファイルを作る (既にあるなら、そのファイルのバケットの数に従う)
+	// 開けなかった・作れなかった・形式が違った場合は false を返し、何も使わないものとして扱う
+	bool Open(const str& path, uint64 bucketCount = DefaultBucketCount);
+
+	inline bool IsOpen() const { return slots != nullptr; }
+	inline uint64 GetBucketCount() const { return bucketCount; }
+
+	// stone の手番で、board の局面の記録を引き、outRecord に格納する (O(1))
+	// 載っていない・他のプロセスが書き込み中で読めなかった場合は false を返す
+	// outSymmetry が nullptr でないなら、board を正規形に移す変換を格納する
+	bool Probe(Shusaku::Stone stone, const Shusaku::Board& board, Record& outRecord, uint8* outSymmetry = nullptr) const;
+
+	// stone の手番で、board の局面の記録を引き、その成績を outStats の各点に加算する (warm start)
+	// 記録した手は、board の上でそれと対称な全ての点に加算する. 打てない手 (コウなど) は加算しない. outStats.totalTryCount は変えない (帰属の平均に使うため)
+	// 載っていれば true を返し、加算した試行回数の合計 (対称な手はまとめて 1 つと数える) を outTryCount に格納する (nullptr なら行わない)
+	bool WarmStart(Shusaku::Stone stone, const Shusaku::Board& board, RootStats& outStats, uint64* outTryCount = nullptr) const;
+
+	// stone の手番での、board の局面の探索結果 stats のうち、試行回数の多い手を書き込む
+	// 同じ局面の記録があれば、それより試行回数の合計が少なくない場合だけ置き換える (WarmStart した結果を書き戻せば、成績が積み重なる)
+	// 無ければ、バケットの中で試行回数の合計が最も少ない記録を置き換える
+	void Store(Shusaku::Stone stone, const Shusaku::Board& board, const RootStats& stats);
+
+private:
+
+	Shusaku::MappedFile file;
+	Slot* slots = nullptr;
+	uint64 bucketCount = 0;
+
+	// slot の記録を読み、outRecord に格納する (書き込みと重なり続けたら false)
+	static bool ReadSlot(const Slot& slot, Record& outRecord);
+
+	// slot に record を書き込む (他の書き込みと重なったら、書かずに false)
+	static bool WriteSlot(Slot& slot, const Record& record);
+
+	// bucketCount 個のバケットを持つ空のファイルを、path に作る (既にあれば何もしない)
+	static bool CreateEmptyFile(const str& path, uint64 bucketCount);
+};
@@ -0,0 +1,44 @@
+﻿#pragma once
+
+#include <Core.hpp>
+
+#include <SimulatorOptions.hpp>
+
+// 棋譜の 1 手分の解析結果
+struct MoveAnalysis final
+{
+	Shusaku::PosStone played;  // 実際に打たれた手
+	Shusaku::Pos bestPos;  // 最善手 (有効手が見つからなければ (0, 0))
+	double bestWinRate = MIN_double;  // 最善手を打った場合の、手番側の勝率
+	double playedWinRate = MIN_double;  // 実際に打たれた手の、手番側の勝率 (試行されなかった手なら MIN_double)
+	uint64 playedTryCount = 0;  // 実際に打たれた手を試行した回数
+};
+
+// 打ち終えた対局の棋譜を読み込み、全ての局面について、最善手と勝率を求める
+// 局面どうしは独立なので、局面ごとに 1 スレッドずつ割り当て、全てのコアで並列に解析する
+class GameAnalyzer final
+{
+public:
+
+	inline GameAnalyzer() = delete;
+
+	// path の棋譜を読み込み、着手を順に outHistory に格納する
+	// ImageWriter::WriteHistory の形式 ("B x,y" の行) と、SGF (拡張子 .sgf. 本譜 (最初の変化) だけを読む) を読める
+	// SGF に盤面のサイズ (SZ) が書かれていれば、outBoardSize に格納する (nullptr なら行わない)
+	// 開けなかった・読み取れない行があった・置き石 (AB, AW) のある SGF だった場合は、false を返す
+	// パスは棋譜に残らない (SGF のパスは読み飛ばす) ので、黒白交互になっているとは限らない
+	static bool LoadGame(const str& path, vec<Shusaku::PosStone>& outHistory, Shusaku::BoardSize* outBoardSize = nullptr);
+
+	// history の各手を打つ前の局面について、Simulator::Search と Simulator::SelectBest で、最善手と勝率を求める
+	// 各局面の予算は、Simulator::Think と同じ (各候補手について Simulator::GetThinkCount 回ずつ試行する)
+	// Simulator::GetThreadCount 個のスレッドで、局面を前から取り合って解析する (1 つの局面の探索は、1 スレッドで行う)
+	// 定石・終盤の読み切りは使わない
+	// 途中で打てない手があったら、その手の前までを返す
+	static vec<MoveAnalysis> Analyze(Shusaku::BoardSize boardSize, const vec<Shusaku::PosStone>& history, const SimulatorOptions& options);
+
+	// 解析結果から、ImageWriter::WriteGraph に渡す勝率 (1 手目は黒番の、2 手目は白番の、と交互に見た、最善手の勝率) を作る
+	static vec<double> GetWinRates(const vec<MoveAnalysis>& analyses);
+
+	// 解析結果を、1 手 1 行のテキストで書き出す (最善手と、実際の手との勝率の差)
+	static bool WriteReport(const str& path, const vec<MoveAnalysis>& analyses);
+};
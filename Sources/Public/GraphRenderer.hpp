@@ -0,0 +1,35 @@
+﻿#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <Core.hpp>
+
+// 勝率のグラフを描画する
+// 左にメモリ、右にグラフを描画する. メモリは 10 刻みで、下が 0.0、上が 1.0 (1.0 なら黒が優勢、0.0 なら白が優勢, 0.5 なら互角)
+// 点の数を先に決めておき、点を 1 つずつ描き足していく (動画で、グラフが伸びていく様子を描くため)
+class GraphRenderer final
+{
+public:
+
+	static constexpr uint16 Width = 640;  // 画像の幅 (px)
+	static constexpr uint16 Height = 480;  // 画像の高さ (px)
+
+	// 背景色 (BGR)
+	static const cv::Scalar BackgroundColor;
+
+	// 点を pointCount 個まで描き足せる、メモリだけのグラフを作る
+	explicit GraphRenderer(autosize pointCount);
+
+	// 次の点を描き足す (pointCount 個を越えた分は無視する)
+	// winRate は、その手番の側 (1 点目は黒、2 点目は白、... と交互) にとっての勝率で、グラフには黒にとっての勝率として描く
+	void AddPoint(double winRate);
+
+	inline autosize GetAddedCount() const { return points.size(); }
+	inline const cv::Mat& GetImage() const { return image; }
+
+private:
+
+	autosize pointCount;
+	vec<cv::Point> points;  // 描き足した点の座標
+	cv::Mat image;
+};
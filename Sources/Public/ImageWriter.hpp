@@ -17,4 +17,10 @@ public:
 	static void ShowGraph(const vec<double>& winRates, bool waitKey = true);
 
 	static void WriteHistory(const str& path, const vec<Shusaku::PosStone>& history);
+
+	// 帰属 (Simulator::Think を参照) を、盤面に重ねたヒートマップとして描画する
+	// 黒のものになりやすい点ほど黒く、白のものになりやすい点ほど白い四角で示す
+	static void WriteOwnership(const str& path, const Shusaku::Board& board, const vec<double>& ownership);
+	// 帰属 (Simulator::Think を参照) を、盤面に重ねたヒートマップとして描画する
+	static void ShowOwnership(const Shusaku::Board& board, const vec<double>& ownership, bool waitKey = true);
 };
@@ -0,0 +1,29 @@
+﻿#pragma once
+
+#include <Core.hpp>
+
+#include <SimulatorOptions.hpp>
+
+// 同じ盤面から、複数局の終局までの試行 (プレイアウト) を、1 手ずつ足並みを揃えて同時に進める
+// 各局 (レーン) の盤面は、黒石・白石の位置のビットボードを、レーンを最も内側にして並べた形 (Structure of Arrays) で持つ
+// 着手の合法判定・石の取り上げ・勝敗判定は、全てのレーンに同じビット演算を行う形で書いているので、
+// AVX2 / AVX-512 を有効にしてビルドすれば、レーン方向のループがそのままベクトル命令になる (無効なら、スカラーで同じ結果になる)
+// 着手の選び方は PlayoutPolicy::EyeAware (options.playoutTactics が false のもの) と同じで、勝敗判定は Simulator::Judge と同じ
+class LockstepPlayout final
+{
+public:
+
+	// 同時に進める局の数
+#ifdef __AVX512F__
+	static constexpr uint32 LaneCount = 16;
+#else
+	static constexpr uint32 LaneCount = 8;
+#endif
+
+	inline LockstepPlayout() = delete;
+
+	// 与えられた盤面から、gameCount 局 (LaneCount 以下) の試行を同時に行い (stone の手番)、各局で勝った方の石の種類を outWinners の先頭から格納する
+	// 勝敗が付かなかった局は、Stone::Empty になる
+	// outOwnershipCounts が nullptr でないなら、各局の終局時に黒のものとなった点に +1、白のものとなった点に -1 を加算する (Simulator::__Try と同じ)
+	static void Run(Shusaku::Stone stone, const Shusaku::Board& board, const SimulatorOptions& options, uint32 gameCount, arr<Shusaku::Stone, LaneCount>& outWinners, int32* outOwnershipCounts = nullptr);
+};
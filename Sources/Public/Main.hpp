@@ -2,24 +2,165 @@
 
 #include <Core.hpp>
 
+#include <EngineConfig.hpp>
 #include <Simulator.hpp>
+#include <SearchCluster.hpp>
+#include <OpeningBook.hpp>
 #include <ImageWriter.hpp>
+#include <VideoExporter.hpp>
 #include <PathMaker.hpp>
+#include <GameAnalyzer.hpp>
+#include <Tournament.hpp>
+#include <PatternWeights.hpp>
+#include <PatternTrainer.hpp>
+#include <EvalCache.hpp>
 
-inline int Main()
+// path の棋譜を解析し、勝率のグラフと、各手の最善手を保存する (EngineConfig::analyzePath を参照)
+inline int Analyze(const str& path, Shusaku::BoardSize boardSize, const SimulatorOptions& options)
 {
 	using namespace Shusaku;
 
-	// true なら自動、false なら手動で着手する
-	constexpr bool BlackAuto = true;
-	constexpr bool WhiteAuto = true;
+	// 棋譜を読み込む (SGF なら、盤面のサイズも棋譜に従う)
+	vec<PosStone> history;
+	if (!GameAnalyzer::LoadGame(path, history, &boardSize))
+	{
+		std::cerr << "Cannot read game record: " << path << std::endl;
+		return 1;
+	}
+
+	// 全ての局面を、並列に解析する
+	const auto Begin = std::chrono::steady_clock::now();
+	const vec<MoveAnalysis> Analyses = GameAnalyzer::Analyze(boardSize, history, options);
+	const double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Begin).count();
+	std::cout << "Analyzed " << Analyses.size() << " / " << history.size() << " moves in "
+		<< std::fixed << std::setprecision(1) << Seconds << " s" << std::endl;
+
+	// 勝率のグラフと、各手の解析結果を保存する
+	const str Identifier = PathMaker::GetIdentifier({ std::to_string(Board::Create(boardSize).GetSize()), "Analysis" });
+	const vec<double> WinRates = GameAnalyzer::GetWinRates(Analyses);
+	ImageWriter::WriteGraph(PathMaker::CreateWithDatetime("WinRateGraph", Identifier), WinRates);
+	GameAnalyzer::WriteReport(PathMaker::CreateWithDatetime("Analysis", Identifier), Analyses);
+
+	// 勝率のグラフを表示する
+	ImageWriter::ShowGraph(WinRates);
+
+	return 0;
+}
+
+// path のディレクトリにある棋譜 (.txt, .sgf) から、プレイアウト用の重みを学習し、outputPath に書き出す (EngineConfig::trainPatternsPath を参照)
+inline int TrainPatterns(const str& path, Shusaku::BoardSize boardSize, const str& outputPath, uint32 iterationCount, uint32 threadCount)
+{
+	// 棋譜の一覧を作る (順番を揃えるため、名前順にする)
+	vec<str> gamePaths;
+	std::error_code error;
+	for (const auto& Entry : std::filesystem::directory_iterator(path, error))
+	{
+		const str Extension = Entry.path().extension().string();
+		if (Entry.is_regular_file() && (Extension == ".txt" || Extension == ".sgf" || Extension == ".SGF"))
+			gamePaths.push_back(Entry.path().string());
+	}
+	std::sort(gamePaths.begin(), gamePaths.end());
+	if (gamePaths.empty())
+	{
+		std::cerr << "No game records in: " << path << std::endl;
+		return 1;
+	}
+
+	std::cout << "Training from " << gamePaths.size() << " games" << std::endl;
+	if (!PatternTrainer::Train(gamePaths, boardSize, outputPath, iterationCount, threadCount, &std::cout))
+	{
+		std::cerr << "Cannot train pattern weights (no usable positions, or cannot write " << outputPath << ")" << std::endl;
+		return 1;
+	}
+	std::cout << "Wrote " << outputPath << std::endl;
+	return 0;
+}
+
+// argv で対局を設定する (EngineConfig を参照)
+inline int Main(int argc, const char* const* argv)
+{
+	using namespace Shusaku;
+
+	// 対局の設定を読み取る
+	EngineConfig config{};
+	str configError;
+	if (!EngineConfig::Parse(argc, argv, config, &configError))
+	{
+		std::cerr << configError << std::endl << EngineConfig::GetUsage();
+		return 1;
+	}
+	if (config.showHelp)
+	{
+		std::cout << EngineConfig::GetUsage();
+		return 0;
+	}
 
-	// パス・終局を判定する際の、勝率の閾値
-	constexpr double WinRateThreshold = 0.1;
+	// 重みの学習を求められたら、対局はしない
+	if (!config.trainPatternsPath.empty())
+		return TrainPatterns(config.trainPatternsPath, config.boardSize, config.patternWeightsPath, config.trainIterationCount, config.simulatorOptions.threadCount);
 
-	Board board = Board::Create9x9();
+	// 学習したプレイアウト用の重みを読み込む (無ければ、手で決めた重みを使う)
+	PatternWeights patternWeights;
+	if (patternWeights.Load(config.patternWeightsPath))
+		config.simulatorOptions.patternWeights = &patternWeights;
+
+	// 評価キャッシュを開く (無ければ作る. 開けなければ使わない)
+	EvalCache evalCache;
+	if (!config.evalCachePath.empty() && evalCache.Open(config.evalCachePath, config.evalCacheBucketCount))
+		config.simulatorOptions.evalCache = &evalCache;
+
+	// 棋譜の解析を求められたら、対局はしない
+	if (!config.analyzePath.empty())
+		return Analyze(config.analyzePath, config.boardSize, config.simulatorOptions);
+
+	// エンジン同士の対局を求められたら、画面に出さずに対局させ、結果だけを出力する
+	// エンジン B の設定は、この設定を設定ファイルで上書きしたもの
+	if (!config.tournamentConfigPath.empty())
+	{
+		EngineConfig configB = config;
+		if (!EngineConfig::LoadFile(config.tournamentConfigPath, configB, &configError))
+		{
+			std::cerr << configError << std::endl;
+			return 1;
+		}
+
+		// エンジン B の重みは、B の設定のパスから読み込む
+		PatternWeights patternWeightsB;
+		configB.simulatorOptions.patternWeights = patternWeightsB.Load(configB.patternWeightsPath) ? &patternWeightsB : nullptr;
+
+		// 評価キャッシュは、どちらのエンジンにも使わせない
+		// キャッシュには着手の評価が残るので、使わせると、一方のエンジンが他方 (あるいは過去の自分) の探索結果で打つことになり、
+		// 勝敗も思考時間も、エンジン自身の強さを表さなくなる
+		config.simulatorOptions.evalCache = nullptr;
+		configB.simulatorOptions.evalCache = nullptr;
+
+		TournamentOptions tournamentOptions = config.tournamentOptions;
+		tournamentOptions.resignThreshold = config.winRateThreshold;
+		const TournamentResult Result = Tournament::Run(config.boardSize, config.simulatorOptions, configB.simulatorOptions, tournamentOptions, &std::cout);
+		std::cout << "Result: ";
+		Tournament::Print(std::cout, Result);
+		return 0;
+	}
+
+	const bool BlackAuto = config.blackAuto;
+	const bool WhiteAuto = config.whiteAuto;
+	SimulatorOptions& simulatorOptions = config.simulatorOptions;
+
+	Board board = Board::Create(config.boardSize);
 	const uint8 Size = board.GetSize();
 
+	// 定石ファイルを読み込む (無ければ使わない)
+	const str BookPath = "../Outputs/OpeningBook_" + std::to_string(Size) + ".bin";
+	if (config.bookGameCount > 0)
+		OpeningBook::Generate(BookPath, board.GetBoardSize(), config.bookGameCount, config.bookMoveCount, config.bookMinTryCount, simulatorOptions);
+	OpeningBook openingBook;
+	if (openingBook.Load(BookPath))
+		simulatorOptions.openingBook = &openingBook;
+
+	// 着手を考えるワーカープロセス (workerCount が 0 なら、このプロセスだけで考える)
+	// ワーカーは fork で立てるので、他のスレッドを立てる前に作っておく
+	SearchCluster cluster(config.clusterOptions, simulatorOptions);
+
 	Stone turn = Stone::Black;
 	bool dontWannaPut = false;  // 着手した際の自分の勝率がかなり低いので、パスしたというフラグ
 	double winRate = MIN_double;  // 勝率をメモ (この変数のポインタを使いまわす)
@@ -27,6 +168,11 @@ inline int Main()
 	// 1 手目は黒番が、2 手目は白番が、3 手目は黒番が、交互に算出する
 	// 終局まで何手かかるか読みにくいので、reserve はしないでおく
 	vec<double> winRates{};
+	// コンピュータが算出した、直近の着手における各点の帰属 (Simulator::Think を参照)
+	// 手動での着手の際は更新されない
+	vec<double> ownership{};
+	// コンピュータが算出した、直近の着手における勝率の 95% 信頼区間 (下限, 上限)
+	std::pair<double, double> confidenceInterval{};
 	Stone forcibleWin = Stone::Empty;  // 投了したときの勝者を記録しておく
 
 	// 最初の盤面を表示する
@@ -42,7 +188,7 @@ inline int Main()
 		{
 			if (BlackAuto)
 			{
-				nextPos = Simulator::Think(turn, board, &winRate);
+				nextPos = cluster.Think(turn, board, &winRate, &ownership, &confidenceInterval);
 				winRates.push_back(winRate);  // 勝率を保存
 			}
 			else
@@ -60,7 +206,7 @@ inline int Main()
 		{
 			if (WhiteAuto)
 			{
-				nextPos = Simulator::Think(turn, board, &winRate);
+				nextPos = cluster.Think(turn, board, &winRate, &ownership, &confidenceInterval);
 				winRates.push_back(winRate);  // 勝率を保存
 			}
 			else
@@ -77,11 +223,36 @@ inline int Main()
 		else
 			return 1;  // ここに来ることはない
 
-		// 異常処理 : 有効手が見つからなかった場合、強制終局させる
-		if (nextPos == Pos(0, 0)) break;
+		// コンピュータの着手と、その勝率を、コンソールに出力する
+		if (turn == Stone::Black ? BlackAuto : WhiteAuto)
+		{
+			std::cout << (turn == Stone::Black ? "Black" : "White") << ": (" << +nextPos.x << ", " << +nextPos.y << ")"
+				<< " WinRate " << std::fixed << std::setprecision(3) << winRate
+				<< " [" << confidenceInterval.first << ", " << confidenceInterval.second << "]" << std::endl;
+		}
 
-		// 着手した際の、自分の勝率がかなり低かった
-		if (winRate < WinRateThreshold)
+		// 有効手が無い・パスするのが最善 (終盤の読み切りによる) なら、パスする
+		// 双方がパスしたら、終局する
+		if (nextPos == Pos(0, 0))
+		{
+			if (dontWannaPut) break;
+			dontWannaPut = true;
+			turn = ReverseStone(turn);
+			continue;
+		}
+
+		// 盤上のほぼ全ての点の帰属が決まっていて、これ以上打っても変わらない
+		bool isSettled = false;
+		if (!ownership.empty())
+		{
+			autosize settledCount = 0;
+			for (const double Value : ownership)
+				if (std::abs(Value) >= config.settledOwnershipThreshold) ++settledCount;
+			isSettled = settledCount >= ownership.size() * config.settledRateThreshold;
+		}
+
+		// 着手した際の、自分の勝率がかなり低かった、または、打つ必要がない
+		if (winRate < config.winRateThreshold || isSettled)
 		{
 			// 双方、これ以上打ちたくなくてパスしたので、終局する
 			if (dontWannaPut) break;
@@ -95,7 +266,7 @@ inline int Main()
 		}
 		// 相手の勝率がかなり低く、自分の勝率がかなり高いので、
 		// 相手が投了したものとみなし、終局する
-		else if (dontWannaPut && winRate > (1.0 - WinRateThreshold))
+		else if (dontWannaPut && winRate > (1.0 - config.winRateThreshold))
 		{
 			forcibleWin = turn;
 			break;
@@ -117,7 +288,10 @@ inline int Main()
 
 	// 勝敗を判定する
 	// 投了の場合は、その勝者の情報をそのまま使う
-	const Stone Win = forcibleWin != Stone::Empty ? forcibleWin : Simulator::Judge(board);
+	// 帰属が分かっているなら、死石を取り除いてから判定する
+	const Stone Win =
+		forcibleWin != Stone::Empty ? forcibleWin :
+		!ownership.empty() ? Simulator::Judge(board, ownership) : Simulator::Judge(board);
 
 	// 出力部
 	{
@@ -144,11 +318,28 @@ inline int Main()
 		// 棋譜を保存する
 		ImageWriter::WriteHistory(PathMaker::CreateWithDatetime("Kifu", Identifier), board.GetHistory());
 
+		// 終局時の帰属のヒートマップを保存する
+		if (!ownership.empty())
+			ImageWriter::WriteOwnership(PathMaker::CreateWithDatetime("Ownership", Identifier), board, ownership);
+
+		// 対局の動画を保存する
+		// 書き出しは別のスレッドで行われ、下で盤面などを表示している間に進む (このブロックを抜ける時に、書き出し終わるまで待つ)
+		VideoExporter videoExporter;
+		videoExporter.Export(PathMaker::CreateWithDatetime("Game", Identifier), board.GetBoardSize(), board.GetHistory(), winRates);
+
 		// 終局時の盤面を表示する
 		ImageWriter::Show(board);
 
 		// 勝率のグラフを表示する
 		ImageWriter::ShowGraph(winRates);
+
+		// 終局時の帰属のヒートマップを表示する
+		if (!ownership.empty())
+			ImageWriter::ShowOwnership(board, ownership);
+
+		// 処理の区間の記録を保存する (SHUSAKU_TRACE を定義してビルドした時のみ)
+		if constexpr (Trace::IsEnabled)
+			Trace::Write("../Outputs/" + PathMaker::CreateWithDatetime("Trace", Identifier) + ".json");
 	}
 
 	return 0;
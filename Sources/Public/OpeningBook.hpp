@@ -0,0 +1,99 @@
+﻿#pragma once
+
+#include <Core.hpp>
+
+#include <SimulatorOptions.hpp>
+
+// 自己対局の結果を集計した、定石ファイル
+// 局面は、手番と、対称変換で正規化した盤面のハッシュ値 (Board::GetCanonicalHash) をまとめたキーで表す
+// ファイルはキーの順に並べた固定長のエントリ (局面と、そこで打った手の成績) からなり、メモリにマップして二分探索で引く
+// 左上角が (1, 1), 右下角が (size, size) の座標系
+class OpeningBook final
+{
+public:
+
+	// ファイルの先頭に置くヘッダ
+	struct Header final
+	{
+		arr<char, 8> magic;  // MagicValue
+		uint32 version;  // Version
+		uint32 boardSize;  // 盤面の一辺
+		uint64 entryCount;  // エントリの数
+	};
+
+	// 1 つの局面で打った、1 つの手の成績
+	// 手は、正規形 (Board::GetCanonicalHash で得られる変換で移した盤面) の上での座標で持つ
+	// 盤面が対称なら、対称な手はまとめて、その代表 (Symmetry::GetCanonicalRepresentative) で持つ
+	struct Entry final
+	{
+		uint64 key;  // 局面のキー (GetKey を参照)
+		uint32 tryCount;  // この手を打った対局の数
+		uint32 winCount;  // そのうち、この手を打った側が勝った数
+		uint8 x;
+		uint8 y;
+		arr<uint8, 6> padding;
+	};
+
+	static constexpr arr<char, 8> MagicValue = { 'S', 'H', 'S', 'K', 'B', 'O', 'O', 'K' };
+	static constexpr uint32 Version = 1;
+
+	inline OpeningBook() = default;
+
+	OpeningBook(const OpeningBook&) = delete;
+	OpeningBook& operator=(const OpeningBook&) = delete;
+
+	// path の定石ファイルをメモリにマップする
+	// 読めなかった・形式が違った場合は false を返し、何も載っていないものとして扱う
+	bool Load(const str& path);
+
+	inline bool IsLoaded() const { return entries != nullptr; }
+	inline autosize GetEntryCount() const { return entryCount; }
+
+	// stone の手番で、board の局面を引く (O(log n))
+	// 載っていれば、最も勝率の高い手を outPos に、その勝率を outWinRate に、その手を打った対局の数と勝った数を outTryCount, outWinCount に格納して (nullptr なら行わない)、true を返す
+	// 盤面が対称なら、定石手と対称な手のうち、打てるものを返す
+	// 載っていない・盤面の大きさが違う・定石手が打てない (コウなど) 場合は、false を返す
+	bool Probe(Shusaku::Stone stone, const Shusaku::Board& board, Shusaku::Pos& outPos, double* outWinRate = nullptr, uint32* outTryCount = nullptr, uint32* outWinCount = nullptr) const;
+
+	// stone の手番での、board の局面のキーを返す
+	// outSymmetry が nullptr でないなら、board を正規形に移す変換を格納する
+	static uint64 GetKey(Shusaku::Stone stone, const Shusaku::Board& board, uint8* outSymmetry = nullptr);
+
+	// 自己対局を gameCount 局行い、その結果から定石ファイルを作って、path に書き出す
+	// 各対局は、最初の bookMoveCount 手を Simulator::Think で打ち、その後は終局まで試行 (Simulator::__Try) して勝敗を決める
+	// minTryCount 局以上で打たれた手だけを書き出す
+	// 書き出せなかった場合は false を返す
+	static bool Generate(const str& path, Shusaku::BoardSize boardSize, uint32 gameCount, uint16 bookMoveCount, uint32 minTryCount, const SimulatorOptions& options);
+
+private:
+
+	Shusaku::MappedFile file;
+	uint8 boardSize = 0;
+	const Entry* entries = nullptr;
+	autosize entryCount = 0;
+};
+
+// 対局の結果を集計して、定石ファイルを作る
+class OpeningBookBuilder final
+{
+public:
+
+	inline OpeningBookBuilder() = default;
+
+	// 1 局分の棋譜 history と勝者 winner を、最初の maxMoveCount 手まで集計する
+	// 盤面の大きさは、最初に加えた対局のものに揃える (違うものは無視する)
+	void AddGame(Shusaku::BoardSize boardSize, const vec<Shusaku::PosStone>& history, Shusaku::Stone winner, uint16 maxMoveCount);
+
+	// minTryCount 局以上で打たれた手だけを、キーの順に並べて、path に書き出す
+	// 書き出せなかった場合は false を返す
+	bool Write(const str& path, uint32 minTryCount) const;
+
+private:
+
+	Shusaku::BoardSize boardSize = Shusaku::BoardSize::_9x9;
+	bool hasBoardSize = false;
+
+	// (局面のキー, 正規形での対称な手の代表 (x, y)) ごとの、(打った対局の数, 勝った数)
+	// キーの順に並ぶので、そのまま書き出せる
+	std::map<std::pair<uint64, std::pair<uint8, uint8>>, std::pair<uint32, uint32>> results;
+};
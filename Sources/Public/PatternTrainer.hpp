@@ -0,0 +1,23 @@
+﻿#pragma once
+
+#include <Core.hpp>
+
+#include <PatternWeights.hpp>
+
+// 棋譜から、プレイアウト用の着手の重み (PatternWeights) を学習する
+// 各局面の合法手 (自分の眼を潰す手を除く) を、特徴 (3x3 パターン・直前の着手からの距離・石取り・アタリ・自らアタリ) の組で表し、
+// 実際に打たれた手が、それらの中から選ばれたとする Bradley-Terry モデルの強さを、MM 法 (Minorization-Maximization) で求める
+// 特徴の抽出と、MM 法の各反復での集計は、局面を分けて全てのコアで並列に行う
+class PatternTrainer final
+{
+public:
+
+	inline PatternTrainer() = delete;
+
+	// gamePaths の棋譜 (GameAnalyzer::LoadGame で読めるもの) から学習し、重みファイルを outputPath に書き出す
+	// 盤面のサイズが書かれていない棋譜は、boardSize の盤面として読む
+	// 読めない棋譜は読み飛ばす. 局面が 1 つも無かった・書き出せなかった場合は false を返す
+	// threadCount が 0 ならハードウェアのスレッド数で並列にする
+	// progress が nullptr でないなら、途中経過を出力する
+	static bool Train(const vec<str>& gamePaths, Shusaku::BoardSize boardSize, const str& outputPath, uint32 iterationCount, uint32 threadCount = 0, std::ostream* progress = nullptr);
+};
@@ -0,0 +1,71 @@
+﻿#pragma once
+
+#include <Core.hpp>
+
+// 棋譜から学習した、プレイアウト用の着手の重み (PatternTrainer で作る) のファイル
+// 着手の選ばれやすさを、特徴ごとの強さ (gamma) の積で表す (Bradley-Terry モデル)
+// 3x3 パターンの重みは、黒番から見た全てのコードの表 (uint16) として持ち、メモリにマップしてそのまま引く
+// 直前の着手からの距離・石取り・アタリ・自らアタリの強さは、ヘッダに持つ
+class PatternWeights final
+{
+public:
+
+	// 直前の着手からの距離の区分の数 (GetDistanceBucket を参照)
+	static constexpr uint8 DistanceBucketCount = 4;
+
+	// ファイルの先頭に置くヘッダ
+	struct Header final
+	{
+		arr<char, 8> magic;  // MagicValue
+		uint32 version;  // Version
+		uint32 codeCount;  // 重みの表の大きさ (Pattern3x3::CodeCount)
+		arr<float, DistanceBucketCount> distanceGammas;  // 直前の着手からの距離の区分ごとの強さ ([0] (遠い) は 1)
+		float captureGamma;  // 相手の石を取る手の強さ
+		float atariGamma;  // 相手の石をアタリにする手の強さ
+		float selfAtariGamma;  // 自分の石をアタリにする手の強さ
+		float reserved;
+	};
+
+	static constexpr arr<char, 8> MagicValue = { 'S', 'H', 'S', 'K', 'P', 'T', 'R', 'N' };
+	static constexpr uint32 Version = 1;
+
+	inline PatternWeights() = default;
+
+	PatternWeights(const PatternWeights&) = delete;
+	PatternWeights& operator=(const PatternWeights&) = delete;
+
+	// path の重みファイルをメモリにマップする
+	// 読めなかった・形式が違った場合は false を返し、何も読み込んでいないものとして扱う
+	bool Load(const str& path);
+
+	inline bool IsLoaded() const { return weights != nullptr; }
+	inline const Header& GetHeader() const { return header; }
+
+	// stone の手番で、コード code の中心に着手する手の重みを返す (Pattern3x3::GetWeight の代わり)
+	// 自分の眼 (1 目の真眼) を潰す手は 0
+	inline uint16 GetWeight(uint16 code, Shusaku::Stone stone) const
+	{
+		return weights[stone == Shusaku::Stone::White ? Shusaku::Pattern3x3::SwapColors(code) : code];
+	}
+
+	// 直前の着手 lastPos から見た、pos の距離の区分を返す
+	// 距離 d = |dx| + |dy| + max(|dx|, |dy|) が 2 (上下左右), 3 (斜め), 4 (一間) なら 1, 2, 3 で、それ以外・直前の着手が無い ((0, 0)) なら 0
+	static inline uint8 GetDistanceBucket(const Shusaku::Pos& pos, const Shusaku::Pos& lastPos)
+	{
+		if (lastPos == Shusaku::Pos(0, 0)) return 0;
+		const int32 Dx = std::abs(pos.x - lastPos.x), Dy = std::abs(pos.y - lastPos.y);
+		const int32 Distance = Dx + Dy + std::max(Dx, Dy);
+		return 2 <= Distance && Distance <= 4 ? static_cast<uint8>(Distance - 1) : 0;
+	}
+
+	// 正規形の 3x3 パターン (Pattern3x3::GetCanonical) ごとの強さ patternGammas と、ヘッダの強さから、重みファイルを作って path に書き出す
+	// パターンの強さは、最大のものが uint16 の最大値になるように丸め (0 にはしない)、自分の眼を潰す手は 0 にする
+	// 書き出せなかった場合は false を返す
+	static bool Write(const str& path, const vec<double>& patternGammas, const Header& gammas);
+
+private:
+
+	Shusaku::MappedFile file;
+	Header header{};
+	const uint16* weights = nullptr;
+};
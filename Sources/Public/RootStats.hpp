@@ -0,0 +1,44 @@
+﻿#pragma once
+
+#include <Core.hpp>
+
+// Think の根 (現在の盤面) での、各候補手の試行結果の集計
+// 複数のスレッド・プロセスで集計したものを足し合わせられるように、点ごとの回数で持つ
+// index = (x-1)+(y-1)*Size で計算する
+struct RootStats final
+{
+	vec<uint64> tryCounts;  // 各点に着手して試行した回数 (候補手でない点は 0)
+	vec<uint64> winCounts;  // そのうち、着手した側が勝った回数
+	vec<int64> ownershipCounts;  // 終局時に、黒のものとなった回数から、白のものとなった回数を引いたもの (帰属を集計しないなら空)
+	uint64 totalTryCount = 0;  // 全ての候補手の試行回数の合計
+
+	// 試行の中身の集計 (対称な候補手に写した分も含めて、totalTryCount に合わせて拡大したもの. LockstepPlayout の試行は数えない)
+	uint64 playoutMoveCount = 0;  // 試行で打った手の数の合計
+	uint64 mercyTryCount = 0;  // 石の数の差で打ち切った試行の回数 (SimulatorOptions::playoutMercyThreshold を参照)
+
+	// 点の数を positionsCount にして、全ての回数を 0 にする
+	inline void Reset(autosize positionsCount, bool withOwnership)
+	{
+		tryCounts.assign(positionsCount, 0);
+		winCounts.assign(positionsCount, 0);
+		ownershipCounts.assign(withOwnership ? positionsCount : 0, 0);
+		totalTryCount = 0;
+		playoutMoveCount = 0;
+		mercyTryCount = 0;
+	}
+
+	// other の回数を足し合わせる (点の数が同じであること)
+	inline void Merge(const RootStats& other)
+	{
+		for (autosize i = 0; i < tryCounts.size() && i < other.tryCounts.size(); ++i)
+		{
+			tryCounts[i] += other.tryCounts[i];
+			winCounts[i] += other.winCounts[i];
+		}
+		for (autosize i = 0; i < ownershipCounts.size() && i < other.ownershipCounts.size(); ++i)
+			ownershipCounts[i] += other.ownershipCounts[i];
+		totalTryCount += other.totalTryCount;
+		playoutMoveCount += other.playoutMoveCount;
+		mercyTryCount += other.mercyTryCount;
+	}
+};
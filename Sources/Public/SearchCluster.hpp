@@ -0,0 +1,60 @@
+﻿#pragma once
+
+#include <Core.hpp>
+
+#include <Simulator.hpp>
+
+// SearchCluster の動作設定
+struct SearchClusterOptions final
+{
+	// 立てるワーカープロセスの数 (0 ならワーカーを立てず、このプロセスで Simulator::Think を行う)
+	uint32 workerCount = 0;
+
+	// 1 回の Think で、各ワーカーが集計結果を送ってくる回数
+	// 1 回ごとの試行回数は、合計が Simulator::GetThinkCount になるように割り振る
+	uint32 roundCount = 4;
+
+	// ワーカーを、このプロセスが使える CPU (SimulatorOptions::cpus が指定されていれば、その CPU) を等分した範囲に、それぞれ固定するか (Linux のみ)
+	// CPU の番号は、通常ソケット (NUMA ノード) ごとに連続しているので、ワーカー数をソケット数に合わせると、ソケットごとに分かれる
+	bool pinWorkers = true;
+};
+
+// 複数のプロセスで、同じ盤面について Simulator::Search を行い (ルート並列)、その集計結果を合わせて着手を選ぶ
+// 各ワーカープロセスは、集計結果を一定の試行回数ごとに、Unix ドメインソケットでコーディネーター (このオブジェクトを作ったプロセス) に送る
+// やり取りするのは盤面 (棋譜) と集計結果だけなので、ソケットを TCP に置き換えれば、そのまま複数のマシンに広げられる
+// POSIX 環境でのみワーカーを立てられる. それ以外の環境・ワーカーが全て落ちた場合は、このプロセスで Simulator::Think を行う
+// ワーカーは fork で立てるので、他のスレッドを立てる前 (最初の Think の前) に作ること
+class SearchCluster final
+{
+public:
+
+	SearchCluster(const SearchClusterOptions& clusterOptions, const SimulatorOptions& simulatorOptions);
+	~SearchCluster();
+
+	SearchCluster(const SearchCluster&) = delete;
+	SearchCluster& operator=(const SearchCluster&) = delete;
+
+	// この環境で、ワーカープロセスを立てられるかどうか
+	static bool IsSupported();
+
+	// 動いているワーカープロセスの数
+	inline uint32 GetWorkerCount() const { return static_cast<uint32>(workerSockets.size()); }
+
+	// 与えられた盤面について、次の一手を考える (stone の手番)
+	// 戻り値・outWinRate・outOwnership・outConfidenceInterval は、Simulator::Think と同じ
+	Shusaku::Pos Think(Shusaku::Stone stone, const Shusaku::Board& board, double* outWinRate = nullptr, vec<double>* outOwnership = nullptr, std::pair<double, double>* outConfidenceInterval = nullptr);
+
+	// ワーカーとして、socketPath のコーディネーターに接続し、接続が切れるか、終了を指示されるまで、要求を処理し続ける
+	// 別に起動したプロセスから呼んでも良い
+	static void RunWorker(const str& socketPath, const SimulatorOptions& options);
+
+private:
+
+	void StopWorkers();
+
+	SearchClusterOptions clusterOptions;
+	SimulatorOptions simulatorOptions;
+
+	vec<int32> workerSockets;  // 各ワーカーと繋がったソケット
+	vec<int32> workerPids;  // 各ワーカーのプロセス ID
+};
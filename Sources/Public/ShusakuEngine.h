@@ -0,0 +1,87 @@
+﻿#pragma once
+
+// Engine (Engine.hpp) を C から使うための API
+// 画像の出力などを含まないので、OpenCV 無しでビルドした静的・共有ライブラリから使える
+// 座標は、左上角が (1, 1), 右下角が (size, size) の座標系
+// 石は 1 が黒、2 が白
+
+#include <stdint.h>
+
+#if defined(_WIN32) && defined(SHUSAKU_BUILD_SHARED)
+#define SHUSAKU_API __declspec(dllexport)
+#elif defined(_WIN32) && defined(SHUSAKU_USE_SHARED)
+#define SHUSAKU_API __declspec(dllimport)
+#elif defined(__GNUC__)
+#define SHUSAKU_API __attribute__((visibility("default")))
+#else
+#define SHUSAKU_API
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+	// エンジン (中身は隠す)
+	typedef struct ShusakuEngine ShusakuEngine;
+
+	// エンジンの設定 (ShusakuGetDefaultOptions で既定値を入れてから、変えたいものだけ変える)
+	typedef struct ShusakuEngineOptions
+	{
+		uint32_t workerCount;  // 局面を並列に評価するスレッドの数 (0 ならハードウェアのスレッド数)
+		uint64_t thinkCount;  // 各候補手について試行する回数の既定値 (0 なら、スレッドの数から決める)
+		int32_t playoutPolicy;  // 0 なら一様ランダム、1 なら 3x3 パターンの重み、2 なら自分の眼も潰す一様ランダム (PlayoutPolicy を参照)
+		int32_t playoutTactics;  // 0 でないなら、試行で戦術的な手を優先する
+		int32_t lastGoodReply;  // 0 でないなら、試行で、勝った試行から覚えた応手を優先する
+		int32_t playoutMercyThreshold;  // 試行で、石の数の差がこれ以上になったら打ち切る (0 なら打ち切らない)
+		const char* patternWeightsPath;  // 学習した重みのファイル (NULL・読めなければ使わない)
+		const char* openingBookPath;  // 定石ファイル (NULL・読めなければ使わない)
+		const char* evalCachePath;  // 評価キャッシュのファイル (NULL なら使わない. 無ければ作り、開けなければ使わない)
+	} ShusakuEngineOptions;
+
+	// 1 つの着手
+	typedef struct ShusakuMove
+	{
+		int32_t x;
+		int32_t y;
+		int32_t stone;
+	} ShusakuMove;
+
+	// 評価を頼む、1 局面分
+	typedef struct ShusakuPosition
+	{
+		int32_t boardSize;  // 盤面の一辺 (9, 13, 19)
+		const ShusakuMove* moves;  // 空の盤面から順に打った手
+		int32_t moveCount;
+		int32_t stone;  // 手番
+		uint64_t thinkCount;  // 予算 (各候補手について試行する回数. 0 ならエンジンの設定に従う)
+	} ShusakuPosition;
+
+	// 1 局面分の評価結果
+	typedef struct ShusakuResult
+	{
+		int32_t isValid;  // 局面を作れたなら 1 (盤面の一辺・手番が不正か、打てない手があったら 0 で、他は意味を持たない)
+		int32_t x;  // 最善手 (打てる手が無ければ (0, 0))
+		int32_t y;
+		double winRate;  // 最善手を打った場合の、手番側の勝率 (打てる手が無ければ -1)
+		double* ownership;  // 呼び出し側が用意する、帰属の格納先 (boardSize * boardSize 個. NULL なら求めない)
+	} ShusakuResult;
+
+	// 設定の既定値を、outOptions に格納する
+	SHUSAKU_API void ShusakuGetDefaultOptions(ShusakuEngineOptions* outOptions);
+
+	// エンジンを作り、スレッドを立てる (options が NULL なら既定値)
+	// 作れなかった場合は NULL を返す
+	SHUSAKU_API ShusakuEngine* ShusakuCreateEngine(const ShusakuEngineOptions* options);
+
+	// エンジンを破棄し、スレッドを止める (NULL なら何もしない)
+	SHUSAKU_API void ShusakuDestroyEngine(ShusakuEngine* engine);
+
+	// positions の count 個の局面を評価し、results の同じ位置に格納する
+	// 局面の間で並列に評価し、全て終わってから戻る. 複数のスレッドから同時に呼んでもよい
+	// 局面を作れた数を返す (引数が不正なら -1)
+	SHUSAKU_API int32_t ShusakuEvaluate(ShusakuEngine* engine, const ShusakuPosition* positions, ShusakuResult* results, int32_t count);
+
+#ifdef __cplusplus
+}
+#endif
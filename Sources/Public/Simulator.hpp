@@ -2,6 +2,9 @@
 
 #include <Core.hpp>
 
+#include <SimulatorOptions.hpp>
+#include <RootStats.hpp>
+
 // 地の判定は難しいので、勝敗判定はある程度妥協する
 class Simulator final
 {
@@ -10,21 +13,72 @@ public:
 	inline Simulator() = delete;
 
 	// 勝敗判定を行う
+	// 石の数と、一方の石だけに囲まれた空き点の数の合計で判定する (死石の判定は行わない)
 	static Shusaku::Stone Judge(const Shusaku::Board& board);
 
+	// Judge と同じ方法で数えた、黒から見た点数の差 (黒の点数 - 白の点数 - コミ) を返す
+	static int32 GetScore(const Shusaku::Board& board);
+
+	// 勝敗判定を行う
+	// Think で得た帰属 ownership を元に、相手の色に大きく寄っている石を死石として取り除いてから判定する
+	static Shusaku::Stone Judge(const Shusaku::Board& board, const vec<double>& ownership);
+
 	// 与えられた盤面について、次の一手を考える (stone の手番)
+	// 試行の方法などは options に従う
 	// 最善の着手を返し、その勝率を outWinRate に返す (nullptr なら行わない)
 	// 最善の着手を返すだけなので、それを元にパス・投了を判断するのは、メイン処理部分で行うこと
+	// 全ての試行の終局時に、各点が黒と白のどちらのものになったか (帰属) を平均し、outOwnership に返す (nullptr なら行わない)
+	// 帰属は -1.0 (必ず白のもの) から 1.0 (必ず黒のもの) の値で、index = (x-1)+(y-1)*Size で計算する
+	// 最善の着手の勝率の 95% 信頼区間 (下限, 上限) を、outConfidenceInterval に返す (nullptr なら行わない)
 	// 有効手が見つからなかった場合は、(0, 0) を返し、outWinRate は (nullptr でないなら) MIN_double になる (発生しないはず)
+	// 定石・終盤の読み切りで着手を決められるなら、探索せずにそれを返す (TryThinkWithoutSearch を参照)
 	// 単純なモンテカルロ木探索 (ランダムに最後まで着手し、最も勝率の高い手を選ぶ) に基づく
 	// 左上角が (1, 1), 右下角が (size, size) の座標系
-	static Shusaku::Pos Think(Shusaku::Stone stone, const Shusaku::Board& board, double* outWinRate = nullptr);
+	static Shusaku::Pos Think(Shusaku::Stone stone, const Shusaku::Board& board, const SimulatorOptions& options = {}, double* outWinRate = nullptr, vec<double>* outOwnership = nullptr, std::pair<double, double>* outConfidenceInterval = nullptr);
+
+	// 探索せずに着手を決められるなら、outPos に格納して true を返す (stone の手番)
+	// 1. options.openingBook に載っている局面なら、定石手とその勝率を返す
+	// 2. 空き点が options.endgameSolverEmptyCount 以下で、時間内に読み切れたなら、最善手と、勝ち負けに応じた勝率 (1, 0.5, 0) を返す ((0, 0) ならパスが最善)
+	// どちらの場合も、outOwnership は空になる. 読み切った場合の信頼区間は、勝率そのもの (幅 0) になる
+	static bool TryThinkWithoutSearch(Shusaku::Stone stone, const Shusaku::Board& board, const SimulatorOptions& options, Shusaku::Pos& outPos, double* outWinRate = nullptr, vec<double>* outOwnership = nullptr, std::pair<double, double>* outConfidenceInterval = nullptr);
+
+	// Think を Search と SelectBest に分けたもの
+	// 複数のプロセスで Search した結果を足し合わせてから、SelectBest で選ぶ、といった使い方をする
+
+	// 与えられた盤面の各候補手について、終局まで試行し、その結果を outStats に加算する (stone の手番)
+	// 全ての候補手に tryCount 回ずつ試行するのと同じ回数を、options.rootAllocation に従って候補手に割り振る
+	// outStats.ownershipCounts が空でないなら、帰属も集計する
+	// outStats の点の数が盤面と合わないなら、0 に戻してから集計する
+	// options.evalCache があれば、前回までの成績を outStats に足してから試行し (足りていれば試行しない)、足し合わせた結果を書き戻す
+	static void Search(Shusaku::Stone stone, const Shusaku::Board& board, const SimulatorOptions& options, uint64 tryCount, RootStats& outStats);
+
+	// Search の集計結果 stats から、最善の着手を選ぶ (stone の手番)
+	// 戦術的な事前評価 (options.rootPriors) は、ここで勝率に混ぜる
+	// 試行回数の少ない手を、たまたま高い勝率で選ばないように、勝率の信頼区間の下限が最大の手を選ぶ
+	// 戻り値・outWinRate・outOwnership・outConfidenceInterval は、Think と同じ
+	static Shusaku::Pos SelectBest(Shusaku::Stone stone, const Shusaku::Board& board, const SimulatorOptions& options, const RootStats& stats, double* outWinRate = nullptr, vec<double>* outOwnership = nullptr, std::pair<double, double>* outConfidenceInterval = nullptr);
+
+	// 試行を並列に行うスレッドの数 (options.threadCount が 0 ならハードウェアのスレッド数)
+	static uint32 GetThreadCount(const SimulatorOptions& options);
+
+	// Think で、各候補手について何回終局まで試行するか (options.thinkCount が 0 なら、スレッドの数を元に決める)
+	static uint64 GetThinkCount(const SimulatorOptions& options);
+
+	// Search で、board の局面を探索するのに使う領域の大きさ (バイト. withOwnership なら、帰属も集計する場合)
+	// 候補手の情報と、スレッドの数だけのワーカーの集計用バッファの分で、options.searchMemoryLimit がこれより小さければ、上限に達する
+	static autosize GetSearchMemorySize(const Shusaku::Board& board, const SimulatorOptions& options, bool withOwnership = false);
 
 	// 与えられた盤面から終局までランダムに試行を行う (stone の手番)
+	// 着手の選び方は options.playoutPolicy に従う
 	// 勝った方の石の種類を返し、終局時の盤面を outResultBoard にコピーする (nullptr なら行わない)
+	// outOwnershipCounts が nullptr でないなら、終局時に黒のものとなった点に +1、白のものとなった点に -1 を加算する (盤面のコピーは行わない)
 	// 勝敗が付かなかった場合は、Stone::Empty を返す
 	// 単純なモンテカルロ木探索 (ランダムに最後まで着手し、最も勝率の高い手を選ぶ) に基づく
-	// 投了はせず、盤面の空きマスが一定値以下になった段階で終局とする
+	// 投了はせず、打てる手がなくなったらパスし、双方がパスした段階で終局とする (最大手数に達したら、その盤面で判定する)
+	// 自分の眼 (1 目の真眼) に打つかどうかは、options.playoutPolicy による
+	//   EyeAware, Pattern : 自分の眼には打たない (Pattern では眼の重みが 0). 覚えた応手 (options.lastGoodReply) も眼には打たない
+	//   Random : 眼も他の空き点と同じく選ぶので、自分の眼を潰すことがあり、最大手数まで続くことが多い
+	// options.playoutMercyThreshold が 0 でないなら、石の数の差がそれ以上になった段階で打ち切り、その盤面で判定する
 	// 内部処理用
-	static Shusaku::Stone __Try(Shusaku::Stone stone, const Shusaku::Board& boardTemplate, Shusaku::Board* outResultBoard = nullptr);
+	static Shusaku::Stone __Try(Shusaku::Stone stone, const Shusaku::Board& boardTemplate, const SimulatorOptions& options = {}, Shusaku::Board* outResultBoard = nullptr, vec<int32>* outOwnershipCounts = nullptr);
 };
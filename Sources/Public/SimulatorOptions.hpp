@@ -0,0 +1,99 @@
+﻿#pragma once
+
+#include <Core.hpp>
+
+class OpeningBook;
+class PatternWeights;
+class EvalCache;
+
+// 終局までの試行 (プレイアウト) で、着手を選ぶ方法
+// 方策ごとに、試行の処理をテンプレートで別々に実体化してあり、試行を始める時に 1 回だけ選ぶ
+enum class PlayoutPolicy : uint8
+{
+	// 空き点から一様ランダムに選ぶ (自分の眼は潰さない)
+	EyeAware,
+	// 周囲 3x3 のパターンの重みに比例して選ぶ (自分の眼は潰さない)
+	// 1 手あたりのコストは少し上がるが、1 回の試行の質が上がる
+	Pattern,
+	// 空き点から一様ランダムに選ぶ (自分の眼も潰す)
+	// 最大手数まで打ち続けることが多く、比べるための基準として使う
+	Random,
+};
+
+// Think で、試行の予算を候補手に割り振る方法
+enum class RootAllocation : uint8
+{
+	// 全ての候補手に、同じ回数ずつ試行する
+	Uniform,
+	// 予算をラウンドに分け、ラウンドごとに勝率の低い半分の候補手を外していく (Successive Halving)
+	// 見込みのない手に使う試行を、順位がまだ決まらない上位の手に回すので、同じ予算でも最善手の見極めが確かになる
+	SuccessiveHalving,
+};
+
+// Simulator の動作設定
+struct SimulatorOptions final
+{
+	PlayoutPolicy playoutPolicy = PlayoutPolicy::EyeAware;
+
+	// Think で、試行の予算を候補手に割り振る方法
+	RootAllocation rootAllocation = RootAllocation::SuccessiveHalving;
+
+	// 終局までの試行で、直前の着手に応じた戦術的な手 (アタリの石を取る・アタリから逃げる) を優先するか
+	bool playoutTactics = true;
+
+	// 終局までの試行で、直前の着手への応手を、勝った試行から覚えて優先するか (Last-Good-Reply with Forgetting)
+	// 応手はスレッドごとに覚え、Search の間 (全てのラウンド) 使い続ける. 戦術的な手よりは後に試す
+	bool lastGoodReply = false;
+
+	// playoutPolicy が EyeAware で、playoutTactics と lastGoodReply が false で、playoutMercyThreshold が 0 のとき、Search の試行を LockstepPlayout で、LockstepPlayout::LaneCount 局ずつまとめて行うか
+	// 試行の結果 (の分布) は変わらず、AVX2 / AVX-512 を有効にしてビルドすれば、1 コアあたりの試行回数が増える
+	bool lockstepPlayouts = false;
+
+	// Think で、候補手の戦術的な事前評価 (石取り・アタリからの逃げ・シチョウ) を勝率に混ぜるか
+	bool rootPriors = true;
+
+	// Think で、終局までの試行を並列に行うスレッドの数 (0 ならハードウェアのスレッド数)
+	uint32 threadCount = 0;
+
+	// Think で、試行を並列に行う各スレッドを固定する CPU の番号 (空なら固定しない)
+	// i 番目のスレッドを、cpus[i % cpus.size()] に固定する
+	vec<uint32> cpus;
+
+	// Think で、各候補手について試行する回数 (0 なら、スレッドの数から決める. Simulator::GetThinkCount を参照)
+	uint64 thinkCount = 0;
+
+	// 終局までの試行の、最大手数 (盤面の交点数の何倍か)
+	// 自分の眼を潰さないので通常は自然に終局するが、長手数の同形反復 (Board ではチェックしない) による無限ループを避けるため、上限を設ける
+	uint16 playoutMaxTurnsRate = 3;
+
+	// 終局までの試行で、盤上の黒石と白石の数の差 (取った石の分も含まれる) がこれ以上になったら、勝負が付いたとして打ち切り、その盤面で判定するか (0 なら打ち切らない)
+	// 石の数の差は Board が差分で持っているので、確かめるのにコストはかからない. 大差の局面で、試行の手数が大きく減る
+	// コミより十分大きくすること (9x9 なら 20 程度)
+	uint16 playoutMercyThreshold = 0;
+
+	// Think で、盤面が対称なら、対称な候補手のうち 1 つだけを試行し、残りにはその結果を写すか
+	// 空の盤面では、9x9 で 81 点が 15 点に減る
+	bool symmetryReduction = true;
+
+	// Think 1 回で使うメモリの上限 (バイト)
+	// 探索では、使う分 (Simulator::GetSearchMemorySize) だけを確保し、それがこの上限を越えるなら、上限の分だけ確保する
+	// 上限に達したら、それ以上は候補手を展開せず、展開済みの候補手だけで考え、バッファを確保できた数のスレッドだけで試行する
+	autosize searchMemoryLimit = static_cast<autosize>(64) << 20;
+
+	// Think で、探索の前に引く定石ファイル (nullptr なら引かない)
+	// 載っている局面では、探索せずに定石手を返す
+	const OpeningBook* openingBook = nullptr;
+
+	// PlayoutPolicy::Pattern で使う、棋譜から学習した重み (nullptr・読み込まれていないなら、Pattern3x3 の手で決めた重みを使う)
+	const PatternWeights* patternWeights = nullptr;
+
+	// Search で、探索の前に引き、探索の後に結果を書き込む評価キャッシュ (nullptr なら使わない)
+	// 前回までの成績があれば、それに足し合わせるように探索する (warm start). 帰属を求めない探索で、打てる点ごとに予算以上の試行が集まっていれば、探索しない
+	EvalCache* evalCache = nullptr;
+
+	// 空き点がこの数以下になったら、Think は探索の代わりに、終局まで読み切って着手を選ぶ (0 なら読み切らない)
+	uint16 endgameSolverEmptyCount = 10;
+
+	// 終局までの読み切りにかける時間の上限 (ms). 越えたら、通常の探索に切り替える
+	uint32 endgameSolverTimeLimit = 1000;
+};
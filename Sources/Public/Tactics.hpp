@@ -0,0 +1,36 @@
+﻿#pragma once
+
+#include <Core.hpp>
+
+// アタリ・石取り・シチョウといった、局所的な戦術を軽く読む
+// 終局までの試行 (プレイアウト) の中と、Think での候補手の事前評価の両方で使う
+// 左上角が (1, 1), 右下角が (size, size) の座標系
+class Tactics final
+{
+public:
+
+	inline Tactics() = delete;
+
+	// シチョウを読む際の、盤面をコピーして読み進める回数の上限
+	// 上限に達したら、読み切れなかったものとして「逃げられる」と判断する
+	static constexpr int32 PlayoutLadderBudget = 8;  // プレイアウト用 (軽さ優先)
+	static constexpr int32 RootLadderBudget = 256;  // Think での事前評価用
+
+	// 直前の着手 lastPos に応じて、stone の手番で打つべき戦術的な手を outMoves に格納する (中身は上書きされる)
+	// 1. 直前の着手の石がアタリなら、取る手
+	// 2. 直前の着手でアタリになった自分の石について、周りの相手の石を取って逃げる手、伸びて逃げる手 (シチョウで取られるものは除く)
+	// 1. の手を先に格納する
+	static void GetTacticalMoves(Shusaku::Stone stone, const Shusaku::Board& board, const Shusaku::Pos& lastPos, vec<Shusaku::Pos>& outMoves, int32 ladderBudget = PlayoutLadderBudget);
+
+	// stone の手番で pos に打つ手を、戦術的に評価する (Think の事前評価用)
+	// 相手の石を取る手・アタリから逃げ切る手は 1、自分からアタリになる手・シチョウで取られる逃げ方は -1、それ以外は 0 を返す
+	static int8 EvaluateMove(Shusaku::Stone stone, const Shusaku::Board& board, const Shusaku::Pos& pos, int32 ladderBudget = RootLadderBudget);
+
+	// 攻める側の手番で、chainPos の連 (呼吸点 2 つ以下) をシチョウで取れるかどうかを読む
+	// budget は読み進める回数の上限で、読んだ分だけ減らされる
+	static bool CanCaptureByLadder(const Shusaku::Board& board, const Shusaku::Pos& chainPos, int32& budget);
+
+	// 守る側の手番で、chainPos の連 (アタリ) がシチョウから逃げられるかどうかを読む
+	// budget は読み進める回数の上限で、読んだ分だけ減らされる
+	static bool CanEscapeFromAtari(const Shusaku::Board& board, const Shusaku::Pos& chainPos, int32& budget);
+};
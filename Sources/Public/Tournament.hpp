@@ -0,0 +1,83 @@
+﻿#pragma once
+
+#include <Core.hpp>
+
+#include <SimulatorOptions.hpp>
+
+// Tournament の動作設定
+struct TournamentOptions final
+{
+	// 対局数の上限 (SPRT の結論が出なくても、ここで打ち切る)
+	uint32 maxGameCount = 1000;
+
+	// 同時に進める対局の数 (0 ならハードウェアのスレッド数). 各対局の探索は 1 スレッドで行う
+	uint32 parallelGameCount = 0;
+
+	// SPRT の仮説 (エンジン A の、B に対する Elo 差)
+	// H0: elo0 だけ強い (通常は 0) / H1: elo1 だけ強い. どちらかが採択されたら止める
+	double elo0 = 0.0;
+	double elo1 = 10.0;
+
+	// SPRT の、第 1 種・第 2 種の誤りの確率
+	double alpha = 0.05;
+	double beta = 0.05;
+
+	// 着手の勝率がこれを下回ったら、投了する
+	double resignThreshold = 0.1;
+
+	// 1 局の最大手数 (盤面の交点数の何倍か). 越えたら、その時点の盤面で勝敗を判定する
+	uint16 maxTurnsRate = 2;
+};
+
+// Tournament の結果 (全てエンジン A から見たもの)
+struct TournamentResult final
+{
+	// SPRT の結論
+	enum class Decision : uint8
+	{
+		None,  // 結論が出る前に、対局数の上限に達した
+		AcceptH0,  // A は elo1 ほど強くない
+		AcceptH1,  // A は elo0 より強い
+	};
+
+	uint32 winCount = 0;
+	uint32 lossCount = 0;
+	uint32 drawCount = 0;
+
+	double elo = 0.0;  // 推定した Elo 差
+	double eloMargin = 0.0;  // Elo 差の 95% 信頼区間の半幅
+
+	double llr = 0.0;  // 対数尤度比
+	double llrLower = 0.0;  // これを下回ったら H0 を採択する
+	double llrUpper = 0.0;  // これを上回ったら H1 を採択する
+	Decision decision = Decision::None;
+
+	// 各エンジンの、1 手あたりの思考時間 (秒) と、1 秒あたりの試行回数
+	double secondsPerMoveA = 0.0;
+	double secondsPerMoveB = 0.0;
+	double playoutsPerSecondA = 0.0;
+	double playoutsPerSecondB = 0.0;
+
+	// 各エンジンの、1 回の試行の平均の手数と、石の数の差で打ち切った試行の割合 (LockstepPlayout の試行は数えないので、0 になる)
+	double playoutLengthA = 0.0;
+	double playoutLengthB = 0.0;
+	double mercyRateA = 0.0;
+	double mercyRateB = 0.0;
+};
+
+// 2 つの設定 (エンジン A, B) を、画面に出さずに、並列に何局も対局させ、強さを比べる
+// 先後は 1 局ごとに入れ替え、1 局終わるごとに SPRT (逐次確率比検定) を行い、結論が出たら止める
+// 設定の変更 (試行回数・ポリシーなど) が、同じ CPU 時間あたりで強くなったかを確かめるために使う
+class Tournament final
+{
+public:
+
+	inline Tournament() = delete;
+
+	// optionsA と optionsB を対局させ、その結果を返す
+	// progress が nullptr でないなら、1 局終わるごとに途中経過を出力する
+	static TournamentResult Run(Shusaku::BoardSize boardSize, const SimulatorOptions& optionsA, const SimulatorOptions& optionsB, const TournamentOptions& tournamentOptions, std::ostream* progress = nullptr);
+
+	// 結果を、人が読む形で出力する
+	static void Print(std::ostream& output, const TournamentResult& result);
+};
@@ -0,0 +1,67 @@
+﻿#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#include <Core.hpp>
+
+// 終局した対局を、1 局ずつ動画ファイル (../Outputs/ 以下の .mp4) に書き出す
+// 各フレームは、左に盤面 (BoardRenderer)、右に勝率のグラフ (GraphRenderer) を並べたもので、1 手ずつ差分を描き足して作る
+// 符号化と書き出しは、別のスレッドで順に行うので、Export は書き出しを待たずに戻る (自己対局をまとめて書き出すのに使える)
+// 左上角が (1, 1), 右下角が (size, size) の座標系
+class VideoExporter final
+{
+public:
+
+	// 書き出しを待っているフレームがこの数に達したら、Export は書き出しが追いつくまで待つ (メモリを使い過ぎないように)
+	static constexpr autosize DefaultMaxQueuedFrames = 256;
+	// 最後の盤面を、何フレーム分表示するか
+	static constexpr uint32 LastFrameRepeatCount = 4;
+
+	explicit VideoExporter(double framesPerSecond = 2.0, autosize maxQueuedFrames = DefaultMaxQueuedFrames);
+	// 予約した全ての動画を書き出すまで待つ
+	~VideoExporter();
+
+	VideoExporter(const VideoExporter&) = delete;
+	VideoExporter& operator=(const VideoExporter&) = delete;
+
+	// 棋譜 history の対局を、path の動画に書き出すよう予約する
+	// フレームは、最初の (空の) 盤面・各着手の後の盤面の順に並ぶ
+	// winRates は、コンピュータが算出した各着手における勝率 (Main と同じく、1 手目は黒番、2 手目は白番、... が算出したもの) で、
+	// n 手目のフレームには、先頭から n 個 (最後のフレームには全て) をグラフに描く
+	// 棋譜の通りに着手できなかったら、そこまでのフレームだけを書き出し、false を返す
+	bool Export(const str& path, Shusaku::BoardSize boardSize, const vec<Shusaku::PosStone>& history, const vec<double>& winRates);
+
+	// 予約した全ての動画を書き出すまで待つ
+	// 前回 Wait を呼んでから、書き出せなかった (ファイルを開けなかった) 動画があれば、false を返す
+	bool Wait();
+
+private:
+
+	// 書き出しスレッドに渡す処理
+	struct Job final
+	{
+		enum class Type : uint8 { Open, Frame, Close };
+
+		Type type = Type::Frame;
+		str path;  // Open のみ
+		cv::Mat frame;  // Frame のみ
+	};
+
+	// 書き出しスレッドに、処理を渡す (待っているフレームが多ければ、減るまで待つ)
+	void Push(Job&& job);
+	// 書き出しスレッドの処理
+	void RunEncoder();
+
+	double framesPerSecond;
+	autosize maxQueuedFrames;
+
+	std::mutex mutex;
+	std::condition_variable queueChanged;
+	que<Job> jobs;
+	autosize queuedFrameCount = 0;
+	bool isEncoding = false;  // 書き出しスレッドが、処理を 1 つ取り出して行っている最中か
+	bool isStopping = false;
+	bool hasFailed = false;
+
+	std::thread encoder;
+};
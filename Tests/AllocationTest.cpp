@@ -0,0 +1,110 @@
+﻿#include <Simulator.hpp>
+
+#include "Check.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+using namespace Shusaku;
+
+// 動的確保の回数を数える (このプログラムの全ての new は、ここを通る)
+static std::atomic<uint64> allocationCount = 0;
+
+void* operator new(std::size_t size)
+{
+	++allocationCount;
+	if (void* ptr = std::malloc(size == 0 ? 1 : size)) return ptr;
+	throw std::bad_alloc();
+}
+// 呼び出し元に展開されると、GCC が、new の呼び出しと free の組を誤って警告する (-Wmismatched-new-delete) ので、展開させない
+[[gnu::noinline]] void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+// アラインメントを指定した確保は、揃える分だけ多めに確保し、揃えた領域の直前に、元のポインタを置く
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	const std::size_t Alignment = static_cast<std::size_t>(alignment);
+	void* const Raw = operator new(size + Alignment + sizeof(void*));
+	void* const Aligned = reinterpret_cast<void*>((reinterpret_cast<std::uintptr_t>(Raw) + sizeof(void*) + Alignment - 1) & ~(Alignment - 1));
+	static_cast<void**>(Aligned)[-1] = Raw;
+	return Aligned;
+}
+void operator delete(void* ptr, std::align_val_t) noexcept { if (ptr) operator delete(static_cast<void**>(ptr)[-1]); }
+
+void* operator new[](std::size_t size) { return operator new(size); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return operator new(size, alignment); }
+void operator delete(void* ptr, std::size_t) noexcept { operator delete(ptr); }
+void operator delete[](void* ptr) noexcept { operator delete(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { operator delete(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t alignment) noexcept { operator delete(ptr, alignment); }
+void operator delete[](void* ptr, std::align_val_t alignment) noexcept { operator delete(ptr, alignment); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t alignment) noexcept { operator delete(ptr, alignment); }
+
+// 試行 (Simulator::__Try)・着手 (Board::PutStone)・勝敗判定 (Simulator::Judge) が、
+// 各スレッドの最初の数回 (作業領域の容量が足りるまで) の後は、動的確保をしないことを確かめる
+// あわせて、差分で更新している、直前の着手の前の盤面 (Board::GetBoardBeforeLastMove) が正しいことも確かめる
+// 乱数のシードは固定する (作業領域の容量が最大になる試行が、準備の間に現れるように)
+int main()
+{
+	Rand::ChangeSeed(1);
+
+	constexpr uint32 WarmUpCount = 200;
+	constexpr uint32 TryCount = 500;
+
+	for (const BoardSize boardSize : { BoardSize::_9x9, BoardSize::_13x13 })
+	{
+		const Board Empty = Board::Create(boardSize);
+		Board played = Board::Create(boardSize);
+		Board board = Board::Create(boardSize);
+
+		// 方策・戦術的な手・覚えた応手・打ち切りの組み合わせごとに、試行する
+		for (const PlayoutPolicy policy : { PlayoutPolicy::EyeAware, PlayoutPolicy::Pattern, PlayoutPolicy::Random })
+			for (const bool UsesExtras : { false, true })
+			{
+				SimulatorOptions options;
+				options.playoutPolicy = policy;
+				options.playoutTactics = UsesExtras;
+				options.lastGoodReply = UsesExtras;
+				options.playoutMercyThreshold = UsesExtras ? 20 : 0;
+
+				for (uint32 i = 0; i < WarmUpCount; ++i)
+				{
+					Simulator::__Try(Stone::Black, Empty, options, &played);
+					Simulator::Judge(played);
+				}
+
+				const uint64 Before = allocationCount;
+				for (uint32 i = 0; i < TryCount; ++i)
+				{
+					Simulator::__Try(Stone::Black, Empty, options, &played);
+					Simulator::Judge(played);
+				}
+				CHECK(allocationCount == Before);
+			}
+
+		// 試行の棋譜を、盤面をコピー代入し直しながら並べ直す
+		Simulator::__Try(Stone::Black, Empty, {}, &played);
+		const vec<PosStone> History = played.GetHistory();
+		vec<Stone> previous = Empty.GetBoard();
+		for (uint32 i = 0; i < WarmUpCount + TryCount; ++i)
+		{
+			const uint64 Before = allocationCount;
+
+			board = Empty;
+			bool isConsistent = true;
+			for (const PosStone& move : History)
+			{
+				previous = board.GetBoard();
+				isConsistent &= board.PutStone(move.pos, move.stone);
+				isConsistent &= board.GetHistory().size() < 2 || board.GetBoardBeforeLastMove() == previous;
+			}
+			Simulator::Judge(board);
+
+			CHECK(isConsistent);
+			if (i >= WarmUpCount) CHECK(allocationCount == Before);
+		}
+	}
+
+	return Check::GetExitCode();
+}
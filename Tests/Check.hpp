@@ -0,0 +1,26 @@
+﻿#pragma once
+
+#include <cstdio>
+
+// テスト用の検査
+// 各テストは、Tests/ の 1 つのファイルと、ライブラリのソース (README を参照) から作る単独のプログラムで、
+// 検査に失敗したら、その場所と式を標準エラー出力に書き、最後に 0 以外の終了コードを返す
+namespace Check
+{
+	inline int failureCount = 0;
+
+	inline void Fail(const char* file, int line, const char* expression)
+	{
+		std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, expression);
+		++failureCount;
+	}
+
+	// main の最後に返す値
+	inline int GetExitCode()
+	{
+		if (failureCount == 0) std::printf("OK\n");
+		return failureCount == 0 ? 0 : 1;
+	}
+}
+
+#define CHECK(condition) ((condition) ? (void)0 : ::Check::Fail(__FILE__, __LINE__, #condition))
@@ -0,0 +1,96 @@
+﻿#include <Simulator.hpp>
+#include <EvalCache.hpp>
+
+#include "Check.hpp"
+
+using namespace Shusaku;
+
+// 対称な局面 (空の 9 路盤) を、評価キャッシュを使って繰り返し探索する
+// - 対称な手は、代表 1 つにまとめて記録される
+// - WarmStart は、記録した手と対称な全ての点に加算し、対称な手をまとめて 1 つと数える
+// - 2 回目の探索は、前回の成績から始めて、実際に試行する (予算が集まるまでは、探索を飛ばさない)
+int main()
+{
+	const str Path = (std::filesystem::temp_directory_path() / "ShusakuEvalCacheTest.bin").string();
+	std::filesystem::remove(Path);
+
+	EvalCache cache;
+	CHECK(cache.Open(Path, 1 << 10));
+
+	SimulatorOptions options;
+	options.threadCount = 1;
+	options.thinkCount = 8;
+	options.evalCache = &cache;
+
+	const Board board = Board::Create(BoardSize::_9x9);
+	const uint8 Size = board.GetSize();
+	const uint8 SymmetryMask = board.GetSymmetryMask();
+	const uint64 TryCount = Simulator::GetThinkCount(options);
+
+	// 探索の予算 (対称な手をまとめた候補手ごとに TryCount 回)
+	uint64 candidateCount = 0;
+	for (uint8 x = 1; x <= Size; ++x)
+		for (uint8 y = 1; y <= Size; ++y)
+			if (Symmetry::GetRepresentative({ x, y }, Size, SymmetryMask) == Pos(x, y)) ++candidateCount;
+	CHECK(candidateCount == 15);
+	const uint64 Budget = candidateCount * TryCount;
+
+	RootStats first;
+	Simulator::Search(Stone::Black, board, options, TryCount, first);
+	CHECK(first.totalTryCount > 0);
+
+	// 記録した手は、どれも対称な手の代表で、互いに異なる
+	EvalCache::Record record;
+	CHECK(cache.Probe(Stone::Black, board, record));
+	CHECK(record.moveCount > 0);
+	for (uint8 i = 0; i < record.moveCount; ++i)
+	{
+		const Pos Move = { record.moves[i].x, record.moves[i].y };
+		CHECK(Symmetry::GetRepresentative(Move, Size, SymmetryMask) == Move);
+		for (uint8 j = 0; j < i; ++j)
+			CHECK(record.moves[j].x != Move.x || record.moves[j].y != Move.y);
+	}
+	CHECK(record.GetTryCount() < Budget);
+
+	// 対称な点には、全て同じ成績が加算される
+	RootStats warm;
+	uint64 cachedTryCount = 0;
+	CHECK(cache.WarmStart(Stone::Black, board, warm, &cachedTryCount));
+	CHECK(cachedTryCount == record.GetTryCount());
+	for (uint8 i = 0; i < record.moveCount; ++i)
+	{
+		const Pos Move = { record.moves[i].x, record.moves[i].y };
+		for (uint8 s = 0; s < Symmetry::Count; ++s)
+		{
+			const Pos Mirrored = Symmetry::Transform(Move, Size, s);
+			const autosize Idx = (Mirrored.x - 1) + (Mirrored.y - 1) * Size;
+			CHECK(warm.tryCounts[Idx] == record.moves[i].tryCount);
+			CHECK(warm.winCounts[Idx] == record.moves[i].winCount);
+		}
+	}
+
+	// 2 回目の探索は、予算が集まっていないので、実際に試行し、記録の試行回数が増える
+	RootStats second;
+	Simulator::Search(Stone::Black, board, options, TryCount, second);
+	CHECK(second.totalTryCount > 0);
+	EvalCache::Record secondRecord;
+	CHECK(cache.Probe(Stone::Black, board, secondRecord));
+	CHECK(secondRecord.GetTryCount() > record.GetTryCount());
+
+	// 探索を飛ばすのは、記録に予算以上の試行が集まってからだけ
+	bool isSkipped = false;
+	for (uint32 i = 0; i < 16 && !isSkipped; ++i)
+	{
+		EvalCache::Record before;
+		CHECK(cache.Probe(Stone::Black, board, before));
+
+		RootStats stats;
+		Simulator::Search(Stone::Black, board, options, TryCount, stats);
+		isSkipped = stats.totalTryCount == 0;
+		CHECK(isSkipped == (before.GetTryCount() >= Budget));
+	}
+	CHECK(isSkipped);
+
+	std::filesystem::remove(Path);
+	return Check::GetExitCode();
+}
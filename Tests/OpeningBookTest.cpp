@@ -0,0 +1,56 @@
+﻿#include <OpeningBook.hpp>
+
+#include "Check.hpp"
+
+using namespace Shusaku;
+
+// 対称な手で始まる対局を集計した定石が、1 つの手にまとまり、どの向きの盤面からも引けることを確かめる
+int main()
+{
+	const str Path = (std::filesystem::temp_directory_path() / "ShusakuOpeningBookTest.bin").string();
+
+	// 空の盤面で (3, 3) と (7, 7) に打った対局は、同じ手として数える
+	{
+		OpeningBookBuilder builder;
+		builder.AddGame(BoardSize::_9x9, { { { 3, 3 }, Stone::Black } }, Stone::Black, 1);
+		builder.AddGame(BoardSize::_9x9, { { { 7, 7 }, Stone::Black } }, Stone::White, 1);
+		CHECK(builder.Write(Path, 2));
+
+		OpeningBook book;
+		CHECK(book.Load(Path));
+		CHECK(book.GetEntryCount() == 1);
+
+		Pos pos;
+		uint32 tryCount = 0, winCount = 0;
+		CHECK(book.Probe(Stone::Black, Board::Create(BoardSize::_9x9), pos, nullptr, &tryCount, &winCount));
+		CHECK(tryCount == 2);
+		CHECK(winCount == 1);
+		CHECK(Symmetry::GetRepresentative(pos, 9, 0xFF) == Pos(3, 3));
+	}
+
+	// (3, 3) の後、対角線について対称な (3, 7) と (7, 3) に打った対局も、同じ手として数え、
+	// 向きの違う盤面 ((7, 3) に打った後) から引くと、その盤面での対称な手を返す
+	{
+		OpeningBookBuilder builder;
+		builder.AddGame(BoardSize::_9x9, { { { 3, 3 }, Stone::Black }, { { 3, 7 }, Stone::White } }, Stone::White, 2);
+		builder.AddGame(BoardSize::_9x9, { { { 3, 3 }, Stone::Black }, { { 7, 3 }, Stone::White } }, Stone::White, 2);
+		CHECK(builder.Write(Path, 2));
+
+		OpeningBook book;
+		CHECK(book.Load(Path));
+		CHECK(book.GetEntryCount() == 2);
+
+		Board board = Board::Create(BoardSize::_9x9);
+		CHECK(board.PutStone({ 7, 3 }, Stone::Black));
+
+		Pos pos;
+		uint32 tryCount = 0, winCount = 0;
+		CHECK(book.Probe(Stone::White, board, pos, nullptr, &tryCount, &winCount));
+		CHECK(tryCount == 2);
+		CHECK(winCount == 2);
+		CHECK(pos == Pos(3, 3) || pos == Pos(7, 7));
+	}
+
+	std::filesystem::remove(Path);
+	return Check::GetExitCode();
+}
@@ -0,0 +1,56 @@
+﻿#include <Simulator.hpp>
+
+#include "Check.hpp"
+
+using namespace Shusaku;
+
+// 探索のメモリの上限 (SimulatorOptions::searchMemoryLimit) を確かめる
+// - 探索は、使う分 (Simulator::GetSearchMemorySize) だけを確保し、既定の上限より十分小さい
+// - 上限がそれより小さいと、確保できた数のワーカーだけで試行し (試行回数は変わらない)、ワーカーを 1 つも確保できなければ試行しない
+int main()
+{
+	const Board board = Board::Create(BoardSize::_9x9);
+
+	SimulatorOptions options;
+	options.threadCount = 4;
+	options.thinkCount = 4;
+	options.rootAllocation = RootAllocation::Uniform;  // 試行の割り振りが、試行の結果に依らないように
+	const uint64 TryCount = Simulator::GetThinkCount(options);
+
+	const autosize Required = Simulator::GetSearchMemorySize(board, options);
+	CHECK(Required > 0);
+	CHECK(Required < options.searchMemoryLimit);
+
+	// ワーカー (スレッド) が増えれば、その分だけ増える
+	SimulatorOptions singleThreadOptions = options;
+	singleThreadOptions.threadCount = 1;
+	CHECK(Simulator::GetSearchMemorySize(board, singleThreadOptions) < Required);
+	CHECK(Simulator::GetSearchMemorySize(board, options, true) >= Required);
+
+	// 上限いっぱい: 全ての点を試行する
+	options.searchMemoryLimit = Required;
+	RootStats full;
+	Simulator::Search(Stone::Black, board, options, TryCount, full);
+	CHECK(full.totalTryCount > 0);
+	CHECK(std::all_of(full.tryCounts.begin(), full.tryCounts.end(), [](uint64 tryCount) { return tryCount > 0; }));
+
+	// 候補手と、ワーカー 1 つ分だけ: 1 つのワーカーで、同じ回数だけ試行する
+	options.searchMemoryLimit = Simulator::GetSearchMemorySize(board, singleThreadOptions);
+	RootStats singleWorker;
+	Simulator::Search(Stone::Black, board, options, TryCount, singleWorker);
+	CHECK(singleWorker.totalTryCount == full.totalTryCount);
+	CHECK(singleWorker.tryCounts == full.tryCounts);
+
+	// ワーカーを 1 つも確保できない: 試行しない (試行していない回数を数えない)
+	for (const autosize Limit : { static_cast<autosize>(Arena::DefaultChunkSize), static_cast<autosize>(0) })
+	{
+		options.searchMemoryLimit = Limit;
+		RootStats none;
+		Simulator::Search(Stone::Black, board, options, TryCount, none);
+		CHECK(none.totalTryCount == 0);
+		CHECK(std::all_of(none.tryCounts.begin(), none.tryCounts.end(), [](uint64 tryCount) { return tryCount == 0; }));
+		CHECK(std::all_of(none.winCounts.begin(), none.winCounts.end(), [](uint64 winCount) { return winCount == 0; }));
+	}
+
+	return Check::GetExitCode();
+}